@@ -20,7 +20,7 @@ REM Compiler settings
 set CC=gcc
 set CFLAGS=-Wall -Wextra -O2 -std=c99 -D_CRT_SECURE_NO_WARNINGS
 set INCLUDES=-I%LIBRDKAFKA_DIR%
-set LIBS=-L%LIBRDKAFKA_DIR% -lrdkafka -lws2_32 -lsecur32 -lcrypt32
+set LIBS=-L%LIBRDKAFKA_DIR% -lrdkafka -lws2_32 -lsecur32 -lcrypt32 -lm
 
 REM Create build directory if it doesn't exist
 if not exist %BUILD_DIR% (
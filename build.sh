@@ -0,0 +1,59 @@
+#!/bin/sh
+# Build script for Kafka CLI Tool on Linux and macOS
+# Uses GCC (or $CC) and links dynamically to the system librdkafka
+
+set -e
+
+echo "=========================================="
+echo "Kafka CLI Tool - Build Script"
+echo "=========================================="
+echo
+
+# Configuration
+SRC_DIR=src
+BUILD_DIR=build
+LIBRDKAFKA_DIR=librdkafka
+SOURCE_FILE=$SRC_DIR/kafka_cli.c
+OUTPUT_FILE=$BUILD_DIR/kafka_cli
+
+# Compiler settings (LDFLAGS may add -L for a librdkafka outside the default paths,
+# EXTRA_CFLAGS e.g. -Werror)
+CC=${CC:-gcc}
+CFLAGS="-Wall -Wextra -O2 -std=c99 $EXTRA_CFLAGS"
+INCLUDES="-I$LIBRDKAFKA_DIR"
+LIBS="-lrdkafka -lpthread -lm -ldl"
+
+# Create build directory if it doesn't exist
+mkdir -p "$BUILD_DIR"
+
+# Check if source file exists
+if [ ! -f "$SOURCE_FILE" ]; then
+    echo "ERROR: Source file not found: $SOURCE_FILE"
+    exit 1
+fi
+
+echo "Source: $SOURCE_FILE"
+echo "Output: $OUTPUT_FILE"
+echo
+
+# Clean previous build
+rm -f "$OUTPUT_FILE"
+
+# Compile
+echo "Compiling..."
+echo "Command: $CC $CFLAGS $INCLUDES $SOURCE_FILE -o $OUTPUT_FILE $LDFLAGS $LIBS"
+echo
+
+if ! $CC $CFLAGS $INCLUDES "$SOURCE_FILE" -o "$OUTPUT_FILE" $LDFLAGS $LIBS; then
+    echo
+    echo "=========================================="
+    echo "BUILD FAILED"
+    echo "=========================================="
+    exit 1
+fi
+
+echo
+echo "=========================================="
+echo "Build complete! You can now run:"
+echo "  $OUTPUT_FILE"
+echo "=========================================="
@@ -37,6 +37,7 @@ typedef struct rd_kafka_queue_s rd_kafka_queue_t;
 typedef struct rd_kafka_op_s rd_kafka_event_t;
 typedef struct rd_kafka_topic_result_s rd_kafka_topic_result_t;
 typedef struct rd_kafka_consumer_group_metadata_s rd_kafka_consumer_group_metadata_t;
+typedef struct rd_kafka_error_s rd_kafka_error_t;
 
 typedef enum rd_kafka_type_t {
     RD_KAFKA_PRODUCER,
@@ -99,6 +100,13 @@ typedef enum rd_kafka_resp_err_t {
     RD_KAFKA_RESP_ERR__KEY_DESERIALIZATION = -160,
     RD_KAFKA_RESP_ERR__VALUE_DESERIALIZATION = -159,
     RD_KAFKA_RESP_ERR__PARTIAL = -158,
+    RD_KAFKA_RESP_ERR__READ_ONLY = -157,
+    RD_KAFKA_RESP_ERR__NOENT = -156,
+    RD_KAFKA_RESP_ERR__UNDERFLOW = -155,
+    RD_KAFKA_RESP_ERR__INVALID_TYPE = -154,
+    RD_KAFKA_RESP_ERR__RETRY = -153,
+    RD_KAFKA_RESP_ERR__PURGE_QUEUE = -152,
+    RD_KAFKA_RESP_ERR__PURGE_INFLIGHT = -151,
     RD_KAFKA_RESP_ERR__END = -100,
     RD_KAFKA_RESP_ERR_UNKNOWN = -1,
     RD_KAFKA_RESP_ERR_NO_ERROR = 0,
@@ -217,6 +225,38 @@ typedef struct rd_kafka_message_s {
     void *_private;
 } rd_kafka_message_t;
 
+typedef struct rd_kafka_metadata_broker {
+    int32_t id;
+    char *host;
+    int port;
+} rd_kafka_metadata_broker_t;
+
+typedef struct rd_kafka_metadata_partition {
+    int32_t id;
+    rd_kafka_resp_err_t err;
+    int32_t leader;
+    int replica_cnt;
+    int32_t *replicas;
+    int isr_cnt;
+    int32_t *isrs;
+} rd_kafka_metadata_partition_t;
+
+typedef struct rd_kafka_metadata_topic {
+    char *topic;
+    int partition_cnt;
+    struct rd_kafka_metadata_partition *partitions;
+    rd_kafka_resp_err_t err;
+} rd_kafka_metadata_topic_t;
+
+typedef struct rd_kafka_metadata {
+    int broker_cnt;
+    struct rd_kafka_metadata_broker *brokers;
+    int topic_cnt;
+    struct rd_kafka_metadata_topic *topics;
+    int32_t orig_broker_id;
+    char *orig_broker_name;
+} rd_kafka_metadata_t;
+
 typedef struct rd_kafka_topic_partition_s {
     char *topic;
     int32_t partition;
@@ -225,6 +265,7 @@ typedef struct rd_kafka_topic_partition_s {
     size_t metadata_size;
     void *opaque;
     rd_kafka_resp_err_t err;
+    void *_private;
 } rd_kafka_topic_partition_t;
 
 typedef struct rd_kafka_topic_partition_list_s {
@@ -252,19 +293,36 @@ RD_EXPORT void rd_kafka_conf_set_dr_msg_cb(rd_kafka_conf_t *conf,
                                             void (*dr_msg_cb)(rd_kafka_t *rk,
                                                               const rd_kafka_message_t *rkmessage,
                                                               void *opaque));
+RD_EXPORT void rd_kafka_conf_set_stats_cb(rd_kafka_conf_t *conf,
+                                           int (*stats_cb)(rd_kafka_t *rk,
+                                                           char *json,
+                                                           size_t json_len,
+                                                           void *opaque));
+RD_EXPORT void rd_kafka_mem_free(rd_kafka_t *rk, void *ptr);
+RD_EXPORT void rd_kafka_conf_set_rebalance_cb(rd_kafka_conf_t *conf,
+                                               void (*rebalance_cb)(rd_kafka_t *rk,
+                                                                    rd_kafka_resp_err_t err,
+                                                                    rd_kafka_topic_partition_list_t *partitions,
+                                                                    void *opaque));
+RD_EXPORT void rd_kafka_conf_set_offset_commit_cb(rd_kafka_conf_t *conf,
+                                                   void (*offset_commit_cb)(rd_kafka_t *rk,
+                                                                            rd_kafka_resp_err_t err,
+                                                                            rd_kafka_topic_partition_list_t *offsets,
+                                                                            void *opaque));
 
 RD_EXPORT rd_kafka_t *rd_kafka_new(rd_kafka_type_t type,
                                     rd_kafka_conf_t *conf,
                                     char *errstr,
                                     size_t errstr_size);
 RD_EXPORT void rd_kafka_destroy(rd_kafka_t *rk);
+RD_EXPORT void *rd_kafka_opaque(const rd_kafka_t *rk);
 RD_EXPORT const char *rd_kafka_name(const rd_kafka_t *rk);
 RD_EXPORT rd_kafka_type_t rd_kafka_type(const rd_kafka_t *rk);
 RD_EXPORT int rd_kafka_poll(rd_kafka_t *rk, int timeout_ms);
-RD_EXPORT void rd_kafka_pause_partitions(rd_kafka_t *rk,
-                                          rd_kafka_topic_partition_list_t *partitions);
-RD_EXPORT void rd_kafka_resume_partitions(rd_kafka_t *rk,
-                                           rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_pause_partitions(rd_kafka_t *rk,
+                                                         rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_resume_partitions(rd_kafka_t *rk,
+                                                          rd_kafka_topic_partition_list_t *partitions);
 
 RD_EXPORT rd_kafka_topic_t *rd_kafka_topic_new(rd_kafka_t *rk,
                                                 const char *topic,
@@ -284,6 +342,10 @@ RD_EXPORT int rd_kafka_produce(rd_kafka_topic_t *rkt,
 RD_EXPORT int rd_kafka_producev(rd_kafka_t *rk, ...);
 
 #define RD_KAFKA_PARTITION_UA -1
+#define RD_KAFKA_OFFSET_BEGINNING -2
+#define RD_KAFKA_OFFSET_END -1
+#define RD_KAFKA_OFFSET_STORED -1000
+#define RD_KAFKA_OFFSET_INVALID -1001
 #define RD_KAFKA_MSG_F_FREE 0x1
 #define RD_KAFKA_MSG_F_COPY 0x2
 #define RD_KAFKA_MSG_F_BLOCK 0x4
@@ -313,6 +375,13 @@ typedef enum {
 } rd_kafka_vtype_t;
 
 RD_EXPORT rd_kafka_resp_err_t rd_kafka_flush(rd_kafka_t *rk, int timeout_ms);
+RD_EXPORT int rd_kafka_outq_len(rd_kafka_t *rk);
+
+#define RD_KAFKA_PURGE_F_QUEUE 0x1
+#define RD_KAFKA_PURGE_F_INFLIGHT 0x2
+#define RD_KAFKA_PURGE_F_NON_BLOCKING 0x4
+
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_purge(rd_kafka_t *rk, int purge_flags);
 
 RD_EXPORT rd_kafka_topic_partition_list_t *rd_kafka_topic_partition_list_new(int size);
 RD_EXPORT void rd_kafka_topic_partition_list_destroy(rd_kafka_topic_partition_list_t *rkparlist);
@@ -344,15 +413,67 @@ RD_EXPORT rd_kafka_resp_err_t rd_kafka_subscribe(rd_kafka_t *rk,
                                                   rd_kafka_topic_partition_list_t *topics);
 RD_EXPORT rd_kafka_resp_err_t rd_kafka_unsubscribe(rd_kafka_t *rk);
 RD_EXPORT rd_kafka_topic_partition_list_t *rd_kafka_subscription(rd_kafka_t *rk);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_assign(rd_kafka_t *rk,
+                                               const rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT rd_kafka_error_t *rd_kafka_incremental_assign(rd_kafka_t *rk,
+                                                        const rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT rd_kafka_error_t *rd_kafka_incremental_unassign(rd_kafka_t *rk,
+                                                          const rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT const char *rd_kafka_rebalance_protocol(rd_kafka_t *rk);
+RD_EXPORT int rd_kafka_assignment_lost(rd_kafka_t *rk);
+RD_EXPORT const char *rd_kafka_error_string(const rd_kafka_error_t *error);
+RD_EXPORT void rd_kafka_error_destroy(rd_kafka_error_t *error);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_assignment(rd_kafka_t *rk,
+                                                   rd_kafka_topic_partition_list_t **partitions);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_position(rd_kafka_t *rk,
+                                                 rd_kafka_topic_partition_list_t *partitions);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_get_watermark_offsets(rd_kafka_t *rk,
+                                                              const char *topic,
+                                                              int32_t partition,
+                                                              int64_t *low,
+                                                              int64_t *high);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_query_watermark_offsets(rd_kafka_t *rk,
+                                                                const char *topic,
+                                                                int32_t partition,
+                                                                int64_t *low,
+                                                                int64_t *high,
+                                                                int timeout_ms);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_offsets_for_times(rd_kafka_t *rk,
+                                                          rd_kafka_topic_partition_list_t *offsets,
+                                                          int timeout_ms);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_metadata(rd_kafka_t *rk,
+                                                 int all_topics,
+                                                 rd_kafka_topic_t *only_rkt,
+                                                 const struct rd_kafka_metadata **metadatap,
+                                                 int timeout_ms);
+RD_EXPORT void rd_kafka_metadata_destroy(const struct rd_kafka_metadata *metadata);
+RD_EXPORT int64_t rd_kafka_message_timestamp(const rd_kafka_message_t *rkmessage,
+                                             rd_kafka_timestamp_type_t *tstype);
 RD_EXPORT rd_kafka_message_t *rd_kafka_consumer_poll(rd_kafka_t *rk, int timeout_ms);
+RD_EXPORT rd_kafka_queue_t *rd_kafka_queue_get_consumer(rd_kafka_t *rk);
+RD_EXPORT void rd_kafka_queue_destroy(rd_kafka_queue_t *rkqu);
+RD_EXPORT ssize_t rd_kafka_consume_batch_queue(rd_kafka_queue_t *rkqu,
+                                               int timeout_ms,
+                                               rd_kafka_message_t **rkmessages,
+                                               size_t rkmessages_size);
 RD_EXPORT rd_kafka_resp_err_t rd_kafka_consumer_close(rd_kafka_t *rk);
 RD_EXPORT void rd_kafka_message_destroy(rd_kafka_message_t *rkmessage);
 RD_EXPORT rd_kafka_resp_err_t rd_kafka_offset_store(rd_kafka_topic_t *rkt,
                                                      int32_t partition,
                                                      int64_t offset);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_offsets_store(rd_kafka_t *rk,
+                                                      rd_kafka_topic_partition_list_t *offsets);
 RD_EXPORT rd_kafka_resp_err_t rd_kafka_commit(rd_kafka_t *rk,
                                                const rd_kafka_topic_partition_list_t *offsets,
                                                int async);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_commit_queue(rd_kafka_t *rk,
+                                                     const rd_kafka_topic_partition_list_t *offsets,
+                                                     rd_kafka_queue_t *rkqu,
+                                                     void (*cb)(rd_kafka_t *rk,
+                                                                rd_kafka_resp_err_t err,
+                                                                rd_kafka_topic_partition_list_t *offsets,
+                                                                void *commit_opaque),
+                                                     void *commit_opaque);
 
 #ifdef __cplusplus
 }
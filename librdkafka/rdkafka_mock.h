@@ -0,0 +1,32 @@
+/*
+ * Minimal librdkafka mock cluster header for Kafka CLI Tool
+ * This is a subset of the full rdkafka_mock.h for compilation purposes.
+ * For production use, use the complete header from the librdkafka distribution.
+ */
+
+#ifndef _RDKAFKA_MOCK_H_
+#define _RDKAFKA_MOCK_H_
+
+#include "rdkafka.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rd_kafka_mock_cluster_s rd_kafka_mock_cluster_t;
+
+RD_EXPORT rd_kafka_mock_cluster_t *rd_kafka_mock_cluster_new(rd_kafka_t *rk, int broker_cnt);
+RD_EXPORT void rd_kafka_mock_cluster_destroy(rd_kafka_mock_cluster_t *mcluster);
+RD_EXPORT rd_kafka_t *rd_kafka_mock_cluster_handle(const rd_kafka_mock_cluster_t *mcluster);
+RD_EXPORT rd_kafka_mock_cluster_t *rd_kafka_handle_mock_cluster(const rd_kafka_t *rk);
+RD_EXPORT const char *rd_kafka_mock_cluster_bootstraps(const rd_kafka_mock_cluster_t *mcluster);
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_mock_topic_create(rd_kafka_mock_cluster_t *mcluster,
+                                                         const char *topic,
+                                                         int partition_cnt,
+                                                         int replication_factor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RDKAFKA_MOCK_H_ */
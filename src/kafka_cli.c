@@ -5,17 +5,35 @@
  * with mutual TLS (mTLS) authentication.
  */
 
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0602 /* GetSystemTimePreciseAsFileTime */
+#endif
+#else
+#define _DEFAULT_SOURCE /* usleep, clock_gettime with -std=c99 */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <limits.h>
 #include <signal.h>
 #include <time.h>
+#include <math.h>
+#include <stddef.h>
 #include <rdkafka.h>
+#include <rdkafka_mock.h>
 
 #ifdef _WIN32
+#include <winsock2.h> /* Before windows.h, which would pull in winsock 1 */
+#include <ws2tcpip.h>
 #include <windows.h>
+#include <psapi.h>
 #include <conio.h>
 #include <direct.h>
+#include <io.h>
 #define getcwd _getcwd
 #define mkdir(path, mode) _mkdir(path)
 #else
@@ -24,6 +42,13 @@
 #include <dirent.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <dlfcn.h>
 #endif
 
 #define VERSION "1.0.0"
@@ -34,6 +59,118 @@
 #define MAX_INI_FILES 20
 #define MAX_FILENAME_LENGTH 256
 #define LOGS_DIR "logs"
+#define MAX_BENCH_RUNS 32
+#define MAX_SWEEP_VALUES 16
+#define MAX_GROUP_MEMBERS 64
+#define MAX_GROUP_PHASES 32
+#define RESULTS_DIR "results"
+#define RESULT_METRIC_COUNT 8
+#define MAX_RESULT_RUNS 1024
+#define MOCK_BENCH_SCENARIOS 7
+#define METRICS_CLIENT_TIMEOUT_MS 2000  /* Whole request and response of one scrape */
+#define METRICS_DETACH_TIMEOUT_MS 5000  /* Longer than any exporter cycle */
+
+/* Statistics parser: pending reports handed from librdkafka to the parser thread */
+#define STATS_RING_SIZE 64
+#define STATS_MAX_DEPTH 8
+#define MAX_STATS_BROKERS 16
+
+/* Async logger ring buffer: power of two records of LOG_RECORD_LENGTH bytes */
+#define LOG_RING_SIZE 4096
+#define LOG_GATE_CLOSED 0x40000000 /* Added to AsyncLogger.gate by stop_logger() */
+#define LOG_RECORD_LENGTH 1024
+
+/*
+ * Latency histogram layout (HDR-style, log-linear): values below
+ * HIST_SUB_BUCKETS are exact, above that every power of two is split into
+ * HIST_SUB_BUCKETS/2 linear buckets, giving ~1.5% worst-case relative error.
+ * The top bucket covers values up to ~4.9 hours in nanoseconds.
+ */
+#define HIST_SUB_BUCKET_BITS 7
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_HALF_BUCKETS (HIST_SUB_BUCKETS / 2)
+#define HIST_MAX_SHIFT 37
+#define HIST_BUCKET_COUNT (HIST_SUB_BUCKETS + HIST_MAX_SHIFT * HIST_HALF_BUCKETS)
+
+/*
+ * Binary header written at the start of every produced payload so the
+ * consumer can measure end-to-end latency. Fields are little-endian:
+ * magic (4), producer id (4), sequence number (8), send time (8, wall
+ * clock nanoseconds since the Unix epoch).
+ */
+#define PAYLOAD_MAGIC 0x494C434BU /* "KCLI" */
+#define PAYLOAD_HEADER_SIZE 24
+
+/* Payload size distributions and content types (see generate_payload) */
+#define PAYLOAD_SIZE_FIXED 0
+#define PAYLOAD_SIZE_UNIFORM 1
+#define PAYLOAD_SIZE_NORMAL 2
+#define PAYLOAD_SIZE_BIMODAL 3
+#define PAYLOAD_SIZE_DISTRIBUTION_COUNT 4
+#define PAYLOAD_CONTENT_RANDOM 0
+#define PAYLOAD_CONTENT_TEXT 1
+#define PAYLOAD_CONTENT_JSON 2
+#define PAYLOAD_CONTENT_COUNT 3
+
+/* Message key distributions over key_space keys (see next_key_index) */
+#define KEY_DIST_NONE 0         /* No key, librdkafka spreads messages itself */
+#define KEY_DIST_UNIFORM 1
+#define KEY_DIST_SEQUENTIAL 2   /* Round-robin through the keyspace */
+#define KEY_DIST_ZIPF 3         /* Key k drawn with probability ~ 1/(k+1)^s */
+#define KEY_DIST_COUNT 4
+#define MAX_KEY_LENGTH_BYTES 24
+#define MAX_TRACKED_PARTITIONS 256
+
+/* How the consumer dispatcher picks a worker (see dispatch_message) */
+#define DISPATCH_PARTITION 0
+#define DISPATCH_KEY 1
+
+/* When the consumer commits offsets explicitly (see request_commit) */
+#define COMMIT_NONE 0           /* Leave it to enable.auto.commit */
+#define COMMIT_MESSAGES 1       /* Every consumer_commit_every_messages messages */
+#define COMMIT_INTERVAL 2       /* Every consumer_commit_interval_ms */
+#define COMMIT_REBALANCE 3      /* When partitions are revoked, and on close */
+#define COMMIT_POLICY_COUNT 4
+
+/* What the producer does when librdkafka's local queue is full */
+#define QUEUE_FULL_BLOCK 0      /* Poll until there is room */
+#define QUEUE_FULL_RETRY 1      /* Poll and retry a bounded number of times, then drop */
+#define QUEUE_FULL_DROP 2       /* Drop immediately */
+#define QUEUE_FULL_POLICY_COUNT 3
+
+/* Lock-free counter helpers (GCC builtins, available with MinGW and GCC) */
+#define ATOMIC_ADD(ptr, val) __atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define ATOMIC_ADD_RELEASE(ptr, val) __atomic_fetch_add((ptr), (val), __ATOMIC_RELEASE)
+#define ATOMIC_LOAD_SEQ_CST(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE_SEQ_CST(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define ATOMIC_CAS(ptr, expected, desired) \
+    __atomic_compare_exchange_n((ptr), (expected), (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+
+/* Portable threads: Win32 threads on Windows, pthreads elsewhere */
+#ifdef _WIN32
+typedef HANDLE thread_t;
+typedef DWORD thread_ret_t;
+#define THREAD_CALL WINAPI
+#else
+typedef pthread_t thread_t;
+typedef void *thread_ret_t;
+#define THREAD_CALL
+#endif
+typedef thread_ret_t (THREAD_CALL *thread_func_t)(void *arg);
+
+/* Portable sockets for the metrics endpoint */
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
 
 /* Configuration structure */
 typedef struct {
@@ -53,18 +190,667 @@ typedef struct {
     int producer_batch_size;
     int producer_linger_ms;
     int producer_ack;
+    int producer_id;             /* Written to payload headers, 0 = process id */
+    int producer_queue_max_messages; /* queue.buffering.max.messages, 0 = default */
+    int producer_queue_max_kbytes;   /* queue.buffering.max.kbytes, 0 = default */
+    int producer_queue_full_policy;  /* QUEUE_FULL_* */
+    int producer_queue_full_retries; /* Retry policy: attempts before dropping */
+    int producer_max_in_flight;  /* max.in.flight.requests.per.connection, 0 = default */
+    char producer_partitioner[MAX_VALUE_LENGTH]; /* librdkafka partitioner, empty = default */
+    int producer_duration_sec;   /* Stop after this many seconds, 0 = message_count only */
+    char compression_codec[MAX_VALUE_LENGTH]; /* none, gzip, snappy, lz4, zstd */
+    int compression_level;       /* -1 = codec default */
+    int producer_threads;        /* Number of producer threads */
+    int producer_shared_handle;  /* 1 = all threads share one rd_kafka_t */
+    int producer_message_size;   /* Payload size in bytes, including header */
+    int producer_payload_count;  /* Pre-generated payloads (and max in-flight) per thread */
+    
+    /* Payload generator settings */
+    int payload_size_distribution; /* PAYLOAD_SIZE_* */
+    int payload_size_min;
+    int payload_size_max;
+    int payload_size_stddev;     /* Normal distribution, 0 = message size / 4 */
+    int payload_bimodal_large_pct; /* Bimodal: percent of messages at payload_size_max */
+    int payload_content;         /* PAYLOAD_CONTENT_* */
+    int payload_compressibility; /* Percent of repetitive content, 0-100 */
+    int key_distribution;        /* KEY_DIST_* */
+    int key_space;               /* Number of distinct keys */
+    double key_zipf_exponent;    /* Zipf skew s, larger = hotter head keys */
+    int producer_rate_msgs;      /* Target messages/sec, 0 = unlimited */
+    double producer_rate_mb;     /* Target MB/s, 0 = unlimited */
     
     /* Consumer settings */
     char consumer_group_id[MAX_VALUE_LENGTH];
     char consumer_auto_offset_reset[MAX_VALUE_LENGTH];
     int consumer_session_timeout_ms;
     char consumer_enable_auto_commit[MAX_VALUE_LENGTH];
+    char consumer_assign[MAX_VALUE_LENGTH]; /* partition[:offset] list, empty = subscribe */
+    char consumer_assignment_strategy[MAX_VALUE_LENGTH]; /* partition.assignment.strategy, empty = default */
+    int consumer_rebalance_churn_sec; /* A second member joins/leaves this often, 0 = off */
+    int consumer_quiet;          /* 1 = aggregate counters only, no per-message output */
+    int consumer_batch_size;     /* Messages per rd_kafka_consume_batch_queue() call, 1 = poll */
+    int consumer_workers;        /* Worker threads, 0 = handle messages on the polling thread */
+    int consumer_dispatch;       /* DISPATCH_* */
+    int consumer_worker_queue_size; /* Bounded queue per worker */
+    int consumer_work_us;        /* Simulated CPU work per message in microseconds */
+    int consumer_commit_policy;  /* COMMIT_* */
+    int consumer_commit_every_messages;
+    int consumer_commit_interval_ms;
+    int consumer_sample_every;   /* Quiet mode: print every Nth message, 0 = off */
+    int consumer_sample_per_sec; /* Quiet mode: print at most N messages per second, 0 = off */
     
     /* General settings */
     int verbose;
     int message_count;
+    int report_interval_sec;     /* Periodic progress report, 0 = disabled */
+    int dashboard;               /* 1 = live in-place dashboard instead of console log lines */
+    int dashboard_refresh_ms;
+    int statistics_interval_ms;  /* librdkafka statistics.interval.ms, 0 = disabled */
+    char result_dir[MAX_VALUE_LENGTH]; /* JSON/CSV result per run, empty = none */
+    
+    /* Benchmark settings */
+    char codec_bench_codecs[MAX_VALUE_LENGTH]; /* codec[:level] list for codec-bench */
+    char sweep_batch_size[MAX_VALUE_LENGTH];   /* Value lists for sweep, empty = current value */
+    char sweep_linger_ms[MAX_VALUE_LENGTH];
+    char sweep_acks[MAX_VALUE_LENGTH];
+    char sweep_message_size[MAX_VALUE_LENGTH];
+    char sweep_max_in_flight[MAX_VALUE_LENGTH];
+    int sweep_duration_sec;      /* Run time per combination */
+    double sweep_latency_budget_ms; /* Best setting must stay under this ack latency */
+    double sweep_latency_percentile;
+    
+    /* Export settings */
+    char export_start_time[MAX_VALUE_LENGTH];  /* "YYYY-MM-DD HH:MM:SS" local time or epoch ms */
+    char export_end_time[MAX_VALUE_LENGTH];    /* Empty = up to the high watermark at start */
+    char export_output_dir[MAX_VALUE_LENGTH];
+    int export_threads;          /* Consumer handles reading partitions in parallel */
+    
+    /* Group scaling settings */
+    int group_members;           /* Consumers started at the beginning */
+    char group_scale_schedule[MAX_VALUE_LENGTH]; /* "sec:+N,sec:-N" membership changes */
+    int group_duration_sec;      /* 0 = until Ctrl+C */
+    
+    /* Metrics settings */
+    int metrics_port;            /* Prometheus endpoint on metrics_bind, 0 = off */
+    char metrics_bind[MAX_VALUE_LENGTH];
+    char metrics_textfile[MAX_VALUE_LENGTH]; /* Textfile collector output, empty = off */
+    int metrics_textfile_interval_ms;
+    
+    /* Mock cluster benchmark settings */
+    int mock_bench_brokers;      /* Brokers in the in-process mock cluster */
+    int mock_bench_duration_sec; /* Produce time per scenario */
+    char mock_bench_scenarios[MAX_VALUE_LENGTH]; /* Scenario names to run, empty = all */
 } Config;
 
+/*
+ * Latency histogram, recorded from librdkafka callback threads without locks
+ */
+typedef struct {
+    int64_t counts[HIST_BUCKET_COUNT];
+    int64_t total_count;
+    int64_t max_value;
+} LatencyHistogram;
+
+/*
+ * Per-message tracking slot, passed to librdkafka as the message opaque.
+ * Each slot owns one pre-generated payload buffer in its thread's arena;
+ * librdkafka references that buffer without copying it, so the slot and
+ * its buffer are recycled only once the delivery report has fired.
+ */
+typedef struct ProducerStats ProducerStats;
+typedef struct {
+    int64_t intended_ns;         /* Scheduled send time on the monotonic clock */
+    int64_t enqueue_ns;          /* Time rd_kafka_producev() was called */
+    int in_flight;
+    unsigned char *payload;
+    size_t payload_len;
+    char key[MAX_KEY_LENGTH_BYTES];
+    size_t key_len;              /* 0 = unkeyed */
+    ProducerStats *stats;
+} MsgSlot;
+
+/* Producer run statistics, updated from the delivery report callback */
+struct ProducerStats {
+    long long produced;
+    long long delivered;
+    long long failed;
+    long long bytes_delivered;
+    long long dropped;           /* Not enqueued because the local queue was full */
+    long long produce_errors;    /* Rejected by rd_kafka_producev() for other reasons */
+    long long queue_full_events;
+    int64_t queue_full_stall_ns; /* Time spent waiting for room in the local queue */
+    int64_t queue_full_max_stall_ns;
+    int64_t slot_wait_ns;        /* Time spent waiting for a free payload buffer */
+    int64_t max_schedule_lag_ns;
+    int64_t elapsed_ns;          /* Filled in at the end of the run */
+    int64_t cpu_ns;              /* Process CPU time used during the run */
+    long long wire_bytes;        /* Bytes sent to brokers, from librdkafka statistics */
+    LatencyHistogram ack_latency;      /* Enqueue -> delivery report */
+    LatencyHistogram intended_latency; /* Intended send time -> delivery report */
+    
+    /* Per-partition delivery counters; the last entry collects higher partitions */
+    long long partition_messages[MAX_TRACKED_PARTITIONS];
+    long long partition_bytes[MAX_TRACKED_PARTITIONS];
+    int64_t partition_latency_sum_ns[MAX_TRACKED_PARTITIONS];
+    int64_t partition_latency_max_ns[MAX_TRACKED_PARTITIONS];
+};
+
+/*
+ * Explicit offset commit state. Commits are requested and completed on the
+ * polling thread (callbacks are served from the poll call), so no locking.
+ * Only async commits get a callback, tagged with their generation, so a
+ * synchronous commit in between cannot be mistaken for their result.
+ */
+typedef struct {
+    int in_flight;               /* An async commit is outstanding */
+    int pending;                 /* Another commit was requested meanwhile */
+    uintptr_t generation;        /* Tag of the latest async commit */
+    rd_kafka_queue_t *queue;     /* Consumer queue, so results are served by the poll */
+    int64_t sent_ns;
+    int64_t last_commit_ns;      /* Last time the policy triggered a commit */
+    long long last_commit_consumed;
+    long long requested;         /* Commits the policy asked for */
+    long long sent;              /* rd_kafka_commit() calls */
+    long long coalesced;         /* Requests folded into an outstanding commit */
+    long long completed;
+    long long failed;
+    long long empty;             /* Nothing new to commit (_NO_OFFSET) */
+    long long partitions;        /* Partition offsets committed */
+    LatencyHistogram latency;    /* rd_kafka_commit() -> result */
+} CommitState;
+
+/*
+ * Rebalance events and the message-flow pauses around them. Updated by the
+ * rebalance callback and the polling thread, which are the same thread.
+ */
+typedef struct {
+    int64_t created_ns;          /* Event times are relative to this */
+    int assigned;                /* Partitions currently assigned */
+    long long assign_events;
+    long long revoke_events;
+    long long lost_events;       /* Revocations after the assignment was lost */
+    int64_t last_message_ns;     /* Last message seen by the polling thread */
+    int64_t window_start_ns;     /* Last message before an unfinished rebalance */
+    int window_open;
+    LatencyHistogram pause;      /* Last message before -> first message after */
+} RebalanceStats;
+
+/*
+ * One broker from the latest statistics report (librdkafka units: rtt in
+ * microseconds, throttle in milliseconds)
+ */
+typedef struct {
+    char name[64];               /* "host:port/id" */
+    int64_t nodeid;              /* -1 for bootstrap and internal entries */
+    int64_t rtt_avg_us;
+    int64_t rtt_p99_us;
+    int64_t throttle_avg_ms;
+    int64_t throttle_max_ms;
+    int64_t outbuf_cnt;          /* Requests waiting to be sent */
+    int64_t outbuf_msg_cnt;      /* Messages in those requests */
+    int64_t waitresp_cnt;        /* Requests in flight */
+} BrokerStatistics;
+
+/* One partition of the configured topic from the latest statistics report */
+typedef struct {
+    int64_t txmsgs;
+    int64_t rxmsgs;
+    int64_t fetchq_cnt;          /* Messages fetched but not yet consumed */
+    int64_t msgq_cnt;            /* Messages waiting to be sent */
+} PartitionStatistics;
+
+/*
+ * Key fields of the latest statistics report of one handle. Written by the
+ * statistics parser thread, read atomically by progress reports.
+ */
+typedef struct {
+    int64_t tx_bytes;            /* Cumulative bytes sent to brokers */
+    int64_t rx_bytes;
+    int64_t msg_cnt;             /* Messages in producer queues */
+    int64_t batch_size_avg;      /* Bytes per produced batch */
+    int64_t batch_cnt_avg;       /* Messages per produced batch */
+    int broker_count;
+    BrokerStatistics brokers[MAX_STATS_BROKERS];
+    int partition_count;         /* Highest partition id seen + 1 */
+    PartitionStatistics partitions[MAX_TRACKED_PARTITIONS];
+} ClientStatistics;
+
+/*
+ * Per-handle state reachable from librdkafka callbacks through the conf opaque
+ */
+typedef struct {
+    const Config *config;
+    char name[32];               /* Log prefix for extra group members, empty for the main one */
+    ClientStatistics statistics; /* Latest parsed statistics report */
+    int stats_reports;           /* Statistics reports parsed so far */
+    CommitState *commit;         /* Consumer with a commit policy, else NULL */
+    RebalanceStats *rebalance;   /* Consumer only */
+} ClientContext;
+
+/* One codec-bench run */
+typedef struct {
+    char label[48];              /* As listed, e.g. "zstd:3" */
+    char codec[32];
+    int level;
+    ProducerStats *stats;
+} CodecBenchResult;
+
+/* One sweep combination and its outcome */
+typedef struct {
+    int batch_size;
+    int linger_ms;
+    int acks;
+    int message_size;
+    int max_in_flight;
+    double msgs_per_sec;
+    double mb_per_sec;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    int64_t p999_ns;
+    int64_t budget_ns;           /* Latency at sweep_latency_percentile */
+    long long lost;              /* Failed + dropped + rejected */
+    int ok;
+} SweepResult;
+
+/* One mock-bench scenario, run against a fresh mock cluster */
+typedef struct {
+    const char *name;
+    int message_size;
+    int acks;                    /* -1 = all */
+    int partitions;
+    int message_count;           /* 0 = run for mock_bench_duration_sec */
+    int consume;                 /* Read every message back after producing */
+} MockBenchScenario;
+
+/*
+ * The mock cluster API, looked up at run time: a librdkafka built without
+ * it still runs every other command
+ */
+typedef struct {
+    rd_kafka_mock_cluster_t *(*handle_mock_cluster)(const rd_kafka_t *rk);
+    rd_kafka_resp_err_t (*topic_create)(rd_kafka_mock_cluster_t *mcluster, const char *topic,
+                                        int partition_cnt, int replication_factor);
+    const char *(*cluster_bootstraps)(const rd_kafka_mock_cluster_t *mcluster);
+} MockApi;
+
+/* Ends a mock-bench read back that does not get every message in time */
+typedef struct {
+    int64_t deadline_ns;
+    int done;
+    int fired;                   /* Stops this scenario's consume loop */
+} MockBenchWatchdog;
+
+/* Shared state for one producer run across all producer threads */
+typedef struct {
+    const Config *config;
+    uint32_t producer_id;
+    int paced;
+    int payload_count;
+    double msg_interval_ns;
+    double byte_interval_ns;
+    int64_t start_ns;
+    int64_t next_send_ns;        /* Shared open-loop schedule, claimed atomically */
+    long long next_sequence;     /* Shared message budget, claimed atomically */
+    long long message_limit;
+    int64_t deadline_ns;         /* producer_duration_sec, 0 = none */
+    double *key_cdf;             /* Zipf cumulative distribution, key_space entries */
+    int active_workers;
+} ProducerEngine;
+
+/* One producer thread and the client handle it drives */
+typedef struct {
+    ProducerEngine *engine;
+    int index;
+    rd_kafka_t *rk;
+    MsgSlot *slots;
+    unsigned char *arena;        /* Pre-generated payloads, one per slot */
+    ProducerStats *stats;
+    uint64_t key_rng;
+    thread_t thread;
+    int64_t finish_ns;           /* -1 if the thread failed to start */
+} ProducerWorker;
+
+/* Decoded payload header */
+typedef struct {
+    uint32_t producer_id;
+    uint64_t sequence;
+    int64_t send_time_ns;
+} PayloadHeader;
+
+/* Consumer run statistics */
+typedef struct {
+    long long consumed;
+    long long bytes;
+    long long headerless;        /* Messages without a kafka_cli payload header */
+    long long clock_skewed;      /* Send time in the future: producer clock ahead */
+    long long errors;            /* Consumer errors other than partition EOF */
+    long long poll_calls;        /* Non-blocking poll/batch calls that returned a message */
+    long long poll_messages;     /* Messages and events returned by those calls */
+    long long empty_polls;       /* Non-blocking calls that found nothing, then waited */
+    int64_t poll_ns;             /* Time spent inside the calls that returned messages */
+    int64_t first_message_ns;    /* From subscribe/assign to the first message, 0 = none */
+    LatencyHistogram e2e_latency;      /* Producer send time -> consumer receive */
+    /* Messages per partition; the last entry collects higher partitions */
+    long long partition_consumed[MAX_TRACKED_PARTITIONS];
+} ConsumerStats;
+
+/* Per-partition lag (high watermark - position), refreshed by the polling thread */
+typedef struct {
+    int64_t last_update_ns;
+    int64_t total_lag;           /* Sum over partitions with a known lag, -1 = none known */
+    int64_t previous_total_lag;
+    int64_t previous_update_ns;
+    int64_t max_total_lag;
+    int partitions;              /* Assigned partitions at the last update */
+    int assigned[MAX_TRACKED_PARTITIONS];
+    int64_t lag[MAX_TRACKED_PARTITIONS];        /* -1 = unknown */
+    int64_t max_lag[MAX_TRACKED_PARTITIONS];
+    int64_t position[MAX_TRACKED_PARTITIONS];
+    int64_t high_watermark[MAX_TRACKED_PARTITIONS];
+} ConsumerLag;
+
+/* Snapshot state for periodic consumer progress reports and sampled output */
+typedef struct {
+    int64_t start_ns;
+    int64_t last_report_ns;
+    long long last_consumed;
+    long long last_bytes;
+    LatencyHistogram last_e2e_latency;
+    LatencyHistogram interval_latency;
+    int64_t sample_window_ns;    /* Start of the current one-second sampling window */
+    int sample_window_count;     /* Messages printed in that window */
+} ConsumerProgress;
+
+/*
+ * Bounded single-producer/single-consumer message queue between the
+ * dispatcher (polling thread) and one worker
+ */
+typedef struct {
+    rd_kafka_message_t **ring;
+    int **done;                  /* Per slot: offset tracker flag to set once handled, or NULL */
+    int capacity;
+    uint64_t head;               /* Next slot to fill, written by the dispatcher */
+    uint64_t tail;               /* Next slot to take, written by the worker */
+} MessageQueue;
+
+/* One consumer worker thread */
+typedef struct {
+    const Config *config;
+    int index;
+    MessageQueue queue;
+    ConsumerStats *stats;        /* Shared by all workers, updated atomically */
+    ConsumerProgress *progress;  /* Per-worker sampling state for quiet mode */
+    int msg_count;
+    int64_t busy_ns;             /* Time spent handling messages */
+    int max_depth;               /* Deepest the queue got (dispatcher view) */
+    int stop;
+    thread_t thread;
+} ConsumerWorker;
+
+/*
+ * Key dispatch hands one partition's messages to several workers, which
+ * finish them out of order. The dispatcher records the partition's offsets
+ * in dispatch order; workers flag them done, and only the offset after the
+ * last message with every earlier one done is stored.
+ */
+typedef struct {
+    int64_t *offsets;
+    int *done;                   /* Set by the worker, cleared by the dispatcher */
+    int capacity;
+    uint64_t head;               /* Next slot to fill (dispatcher only) */
+    uint64_t tail;               /* Oldest offset not yet stored (dispatcher only) */
+} OffsetTracker;
+
+/* Dispatcher side of the worker pool, including backpressure state */
+typedef struct {
+    rd_kafka_t *rk;
+    const Config *config;
+    ConsumerWorker *workers;
+    int worker_count;
+    int high_watermark;          /* Pause the partition at this queue depth */
+    int low_watermark;           /* Resume once the queue drains to this depth */
+    int paused_by[MAX_TRACKED_PARTITIONS]; /* Worker index + 1 that paused it, 0 = running */
+    int64_t paused_since_ns[MAX_TRACKED_PARTITIONS];
+    long long pause_events;
+    int64_t paused_ns;           /* Total partition-time spent paused */
+    int64_t full_wait_ns;        /* Dispatcher blocked on a full worker queue */
+    OffsetTracker *trackers[MAX_TRACKED_PARTITIONS]; /* Key dispatch only, allocated on first use */
+} WorkerPool;
+
+/*
+ * Live dashboard for a producer or consumer run. Its thread only reads the
+ * run's atomic counters and thread-safe librdkafka calls into its own
+ * snapshot state, so redrawing never touches the produce or poll path.
+ */
+typedef struct {
+    const Config *config;
+    const char *mode;            /* "producer" or "consumer" */
+    int64_t start_ns;
+    
+    /* Producer sources */
+    ProducerWorker *workers;
+    int worker_count;
+    rd_kafka_t *shared_rk;
+    ProducerStats *producer_stats; /* Dashboard's own merge of the worker stats */
+    
+    /* Consumer sources */
+    rd_kafka_t *rk;
+    ConsumerStats *consumer_stats;
+    WorkerPool *pool;            /* NULL without consumer workers */
+    ConsumerLag *lag;            /* Dashboard's own lag snapshot */
+    
+    /* Interval state */
+    int64_t last_ns;
+    long long last_count;
+    long long last_bytes;
+    LatencyHistogram last_latency;
+    LatencyHistogram interval_latency;
+    
+    int running;
+    thread_t thread;
+} Dashboard;
+
+/*
+ * Prometheus metrics exporter. A run attaches its counters while it is
+ * active and the exporter thread renders them with atomic loads into its
+ * own buffers, so a scrape never takes anything the produce or poll path
+ * waits on. Only the exporter thread detaches a run, after the run asked.
+ */
+typedef struct {
+    const Config *config;
+    int64_t start_ns;
+    
+    /* Attached run; mode is published last and cleared by the exporter thread */
+    const char *mode;            /* "producer", "consumer" or NULL */
+    long long detach_requested;  /* Number of the run to withdraw, 0 = none */
+    int rendering;               /* The exporter is reading the run's counters */
+    int64_t attach_ns;
+    ProducerWorker *workers;
+    int worker_count;
+    rd_kafka_t *shared_rk;
+    rd_kafka_t *rk;
+    ConsumerStats *consumer_stats;
+    long long runs;              /* Runs attached so far */
+    
+    /* Exporter thread only */
+    ProducerStats *producer_stats; /* Own merge of the worker stats */
+    ConsumerLag *lag;            /* Own lag snapshot */
+    char *buffer;                /* Rendered exposition text */
+    size_t length;
+    size_t capacity;
+    socket_t listen_socket;      /* INVALID_SOCKET without an HTTP endpoint */
+    long long scrapes;
+    int64_t next_textfile_ns;
+    int textfile_failing;        /* Last rewrite failed, already warned */
+    
+    int running;
+    thread_t thread;
+} MetricsExporter;
+
+/* Offset range of one partition in an export and where it is written */
+typedef struct {
+    int partition;
+    int64_t start_offset;        /* First offset at or after the start time */
+    int64_t end_offset;          /* First offset at or after the end time (exclusive) */
+    FILE *file;
+    long long messages;
+    long long bytes;
+    int done;
+} ExportPartition;
+
+/* One export thread: its own consumer handle reading every Nth partition */
+typedef struct {
+    const Config *config;
+    int index;
+    int thread_count;
+    ExportPartition *partitions; /* Indexed by partition id, shared by all threads */
+    int partition_count;
+    int finished;
+    int failed;
+    thread_t thread;
+} ExportWorker;
+
+/*
+ * One consumer of the group-scale command. The member thread publishes its
+ * counters atomically; the coordinator only reads them and sets stop.
+ */
+typedef struct {
+    const Config *config;
+    int id;
+    int stop;                    /* Leave the group */
+    int finished;
+    int failed;
+    long long messages;
+    long long bytes;
+    int assigned;                /* Partitions owned after the last poll */
+    int64_t last_rebalance_ns;   /* Time of the last assign/revoke seen */
+    int64_t last_message_ns;
+    int64_t joined_ns;
+    int64_t left_ns;
+    thread_t thread;
+} GroupMember;
+
+/*
+ * Time between two membership changes of the group-scale command
+ */
+typedef struct {
+    int members;
+    int64_t start_ns;
+    int64_t steady_ns;           /* 0 = not reached yet */
+    long long steady_messages;   /* Group total when it became steady */
+    int64_t end_ns;
+    long long end_messages;
+} GroupPhase;
+
+/* Snapshot state for periodic producer progress reports */
+typedef struct {
+    int64_t start_ns;
+    int64_t last_report_ns;
+    long long last_delivered;
+    long long last_bytes;
+    LatencyHistogram last_ack_latency;
+    LatencyHistogram interval_latency;
+} ProducerProgress;
+
+/* One second of a run's result time series */
+typedef struct {
+    double elapsed_sec;
+    long long messages;          /* Delivered or consumed so far */
+    double msgs_per_sec;
+    double mb_per_sec;
+    double p99_ms;               /* Of the latency recorded during this second */
+    long long errors;            /* So far */
+    double cpu_pct;              /* Process CPU during this second, 100 = one core */
+    double rss_mb;
+} ResultSample;
+
+/*
+ * Machine-readable result of one produce or consume run: summary and
+ * per-second samples. Filled by the thread that reports progress.
+ */
+typedef struct {
+    char name[64];               /* Command, or scenario of a suite */
+    const char *mode;            /* "producer" or "consumer" */
+    time_t started;
+    int64_t start_ns;
+    int64_t start_cpu_ns;
+    
+    /* Sampling state */
+    int64_t last_ns;
+    int64_t last_cpu_ns;
+    long long last_messages;
+    long long last_bytes;
+    LatencyHistogram last_latency;
+    LatencyHistogram interval_latency;
+    ResultSample *samples;
+    int sample_count;
+    int sample_capacity;
+    
+    /* Summary, set by finish_run_result() */
+    int finished;
+    double elapsed_sec;
+    long long messages;
+    long long bytes;
+    long long errors;
+    double latency_ms[5];        /* p50, p90, p99, p99.9, max */
+    double cpu_sec;
+    double peak_rss_mb;
+} RunResult;
+
+/* Summary values of one run read back from a result file by compare */
+typedef struct {
+    char name[64];
+    double values[RESULT_METRIC_COUNT];
+    int present[RESULT_METRIC_COUNT];
+} ResultRunSummary;
+
+typedef struct {
+    int run_count;
+    ResultRunSummary runs[MAX_RESULT_RUNS];
+} ResultFile;
+
+static const char *payload_size_distribution_names[] = { "fixed", "uniform", "normal", "bimodal" };
+static const char *payload_content_names[] = { "random", "text", "json" };
+static const char *key_distribution_names[] = { "none", "uniform", "sequential", "zipf" };
+static const char *dispatch_names[] = { "partition", "key" };
+static const char *commit_policy_names[] = { "none", "messages", "interval", "rebalance" };
+static const char *queue_full_policy_names[] = { "block", "retry", "drop" };
+
+/* Summary fields the compare command checks, and which direction is better */
+static const struct {
+    const char *key;
+    const char *label;
+    int higher_is_better;
+} result_metrics[RESULT_METRIC_COUNT] = {
+    { "msgs_per_sec", "msg/s", 1 },
+    { "mb_per_sec", "MB/s", 1 },
+    { "latency_p50_ms", "latency p50 ms", 0 },
+    { "latency_p99_ms", "latency p99 ms", 0 },
+    { "latency_p999_ms", "latency p99.9 ms", 0 },
+    { "cpu_us_per_message", "CPU us/msg", 0 },
+    { "peak_rss_mb", "peak RSS MB", 0 },
+    { "errors", "errors", 0 }
+};
+
+/* Upper bounds of the exported latency histogram buckets, in seconds */
+static const double metrics_bucket_seconds[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+/*
+ * The mock-bench suite. The round trip is bounded by count: the mock
+ * cluster keeps only the last few MB of each partition.
+ */
+static const MockBenchScenario mock_bench_scenarios[MOCK_BENCH_SCENARIOS] = {
+    { "small-acks1-1p", 100, 1, 1, 0, 0 },
+    { "small-acks0-8p", 100, 0, 8, 0, 0 },
+    { "small-acks1-8p", 100, 1, 8, 0, 0 },
+    { "small-acksall-8p", 100, -1, 8, 0, 0 },
+    { "large-acks1-8p", 16384, 1, 8, 0, 0 },
+    { "large-acksall-8p", 16384, -1, 8, 0, 0 },
+    { "roundtrip-8p", 1024, 1, 8, 8000, 1 }
+};
+
 /* Global variables for signal handling */
 static volatile int run = 1;
 static rd_kafka_t *global_kafka_handle = NULL;
@@ -77,6 +863,67 @@ static WORD savedAttributes = 0;
 
 /* Global log file */
 static FILE *log_file = NULL;
+static char log_file_path[MAX_FILENAME_LENGTH * 2];
+
+/*
+ * One formatted log line waiting for the writer thread. The sequence number
+ * implements a bounded multi-producer queue (Vyukov): a cell is free for
+ * position p when sequence == p and holds a record when sequence == p + 1.
+ */
+typedef struct {
+    uint64_t sequence;
+    int64_t time_sec;            /* time() when logged; formatted by the writer */
+    const char *level;           /* Always a string literal */
+    char text[LOG_RECORD_LENGTH];
+} LogRecord;
+
+/*
+ * Asynchronous logger: any thread pushes records without locks, a background
+ * thread drains them in batches to the console and the log file
+ */
+typedef struct {
+    LogRecord records[LOG_RING_SIZE];
+    uint64_t enqueue_pos;
+    uint64_t dequeue_pos;        /* Writer thread only */
+    int running;                 /* Started: log_message() queues instead of writing */
+    int stopping;                /* Tells the writer thread to exit */
+    int gate;                    /* Threads inside log_enqueue(), plus LOG_GATE_CLOSED */
+    long long dropped;           /* Records lost to a full ring or to shutdown */
+    thread_t thread;
+    int64_t cached_sec;          /* Writer thread only: timestamp cache */
+    char cached_timestamp[32];
+    int console_muted;           /* Dashboard owns the screen: log file only */
+    long long muted_warnings;    /* WARNING/ERROR lines kept off the screen */
+} AsyncLogger;
+
+static AsyncLogger async_logger;
+
+/* A statistics report waiting for the parser, same sequence scheme as LogRecord */
+typedef struct {
+    uint64_t sequence;
+    ClientContext *context;
+    char *json;                  /* Owned until parsed, then rd_kafka_mem_free() */
+    size_t json_len;
+} StatsDocument;
+
+/*
+ * Statistics parser thread: stats_cb() only queues the JSON, so neither
+ * librdkafka nor the poll loop spends time on it
+ */
+typedef struct {
+    StatsDocument documents[STATS_RING_SIZE];
+    uint64_t enqueue_pos;
+    uint64_t dequeue_pos;        /* Parser thread only */
+    uint64_t parsed;             /* Documents finished, for drain_statistics() */
+    int started;
+    int running;
+    long long dropped;           /* Reports skipped because the ring was full */
+    thread_t thread;
+} StatsParser;
+
+static StatsParser stats_parser;
+static MetricsExporter metrics_exporter;
+static LatencyHistogram no_latency;  /* Stays empty: runs that measure no latency */
 
 /* Function prototypes */
 static void print_usage(const char *program);
@@ -86,14 +933,176 @@ static int parse_ini_file(const char *filename, Config *config);
 static char* trim_whitespace(char *str);
 static rd_kafka_t* create_producer(const Config *config);
 static rd_kafka_t* create_consumer(const Config *config);
-static int produce_messages(rd_kafka_t *rk, const Config *config);
-static int consume_messages(rd_kafka_t *rk, const Config *config);
+static int produce_messages(const Config *config, ProducerStats *totals, RunResult *run_result);
+static int consume_messages(rd_kafka_t *rk, const Config *config, const int *stop, RunResult *run_result);
+static ssize_t consume_call(rd_kafka_t *rk, rd_kafka_queue_t *queue, rd_kafka_message_t **batch,
+                            int batch_size, rd_kafka_message_t **rkmessage, int timeout_ms);
 static void stop_consumer(int sig);
 static void dr_msg_cb(rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque);
 static void print_config(const Config *config);
 static void init_log_file(const char *topic, const char *mode);
 static void close_log_file(void);
+static void start_logger(void);
+static void stop_logger(void);
+static int log_enqueue(const char *level, const char *format, va_list args);
+static int log_drain(void);
+static void log_write_line(int64_t time_sec, const char *level, const char *text);
+static thread_ret_t THREAD_CALL log_writer_main(void *arg);
 static void sanitize_filename(char *dst, const char *src, size_t size);
+static int64_t get_time_ns(void);
+static void sleep_ms(int ms);
+static int thread_create(thread_t *thread, thread_func_t func, void *arg);
+static void thread_join(thread_t thread);
+static void hist_merge(LatencyHistogram *dst, const LatencyHistogram *src);
+static void flush_producer(rd_kafka_t *rk);
+static void destroy_producer(rd_kafka_t *rk);
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque);
+static void start_stats_parser(void);
+static void stop_stats_parser(void);
+static void drain_statistics(void);
+static thread_ret_t THREAD_CALL stats_parser_main(void *arg);
+static void parse_statistics(const char *json, size_t len, const char *topic, ClientStatistics *stats);
+static void store_statistic(ClientStatistics *stats, const char *topic, const char **keys,
+                            const size_t *key_lengths, int depth, int64_t value);
+static int key_equals(const char *key, size_t len, const char *literal);
+static BrokerStatistics *find_broker_statistics(ClientStatistics *stats, const char *name, size_t len);
+static void log_client_statistics(const ClientStatistics *stats, const char *label, int per_partition);
+static void start_metrics_exporter(const Config *config);
+static void stop_metrics_exporter(void);
+static void attach_producer_metrics(ProducerWorker *workers, int worker_count, rd_kafka_t *shared_rk);
+static void attach_consumer_metrics(rd_kafka_t *rk, ConsumerStats *stats);
+static void detach_metrics(void);
+static thread_ret_t THREAD_CALL metrics_main(void *arg);
+static int open_metrics_socket(const char *address, int port, socket_t *listen_socket);
+static void serve_metrics_client(MetricsExporter *exporter, socket_t client);
+static void write_metrics_textfile(MetricsExporter *exporter);
+static void render_metrics(MetricsExporter *exporter, int64_t now_ns);
+static void render_producer_metrics(MetricsExporter *exporter);
+static void render_consumer_metrics(MetricsExporter *exporter, int64_t now_ns);
+static void render_client_metrics(MetricsExporter *exporter);
+static void render_histogram(MetricsExporter *exporter, const char *name, const char *help,
+                             const LatencyHistogram *hist);
+static void render_metric(MetricsExporter *exporter, const char *name, const char *type, const char *help,
+                          double value);
+static void metrics_family(MetricsExporter *exporter, const char *name, const char *type, const char *help);
+static void metrics_append(MetricsExporter *exporter, const char *format, ...);
+static void metrics_append_label(MetricsExporter *exporter, const char *value);
+static rd_kafka_t *metrics_handle(const MetricsExporter *exporter, int index);
+static void wait_for_statistics(rd_kafka_t *rk, int interval_ms);
+static int64_t get_process_cpu_ns(void);
+static int64_t get_process_rss_bytes(int peak);
+static int run_codec_benchmark(const Config *config);
+static int parse_int_list(const char *value, int fallback, int *values, int max_values);
+static int run_parameter_sweep(const Config *config);
+static int parse_timestamp_ms(const char *value, int64_t *timestamp_ms);
+static int resolve_export_ranges(rd_kafka_t *rk, const Config *config, int64_t start_ms,
+                                 int64_t end_ms, ExportPartition **partitions, int *partition_count);
+static void write_escaped(FILE *file, const char *data, size_t len);
+static void write_export_record(ExportPartition *export_partition, const rd_kafka_message_t *rkmessage);
+static int update_export_positions(rd_kafka_t *rk, ExportWorker *worker);
+static thread_ret_t THREAD_CALL export_worker_main(void *arg);
+static int run_export(const Config *config);
+static int get_partition_count(rd_kafka_t *rk, const char *topic);
+static thread_ret_t THREAD_CALL group_member_main(void *arg);
+static int start_group_member(GroupMember *members, int *member_count, const Config *config);
+static int group_is_steady(GroupMember *members, int member_count, int partition_count, int64_t since_ns);
+static int run_group_scale(const Config *config);
+static void start_run_result(RunResult *result, const char *mode, int64_t start_ns);
+static void sample_run_result(RunResult *result, int64_t now_ns, long long messages, long long bytes,
+                              long long errors, const LatencyHistogram *latency);
+static void finish_run_result(RunResult *result, int64_t elapsed_ns, long long messages, long long bytes,
+                              long long errors, const LatencyHistogram *latency);
+static void free_run_result(RunResult *result);
+static int write_result_files(const Config *config, const char *command, const RunResult *results,
+                              int result_count);
+static void write_result_json(FILE *file, const Config *config, const char *command,
+                              const RunResult *results, int result_count);
+static void write_config_snapshot(FILE *file, const Config *config);
+static void write_json_string(FILE *file, const char *value);
+static int load_result_file(const char *path, ResultFile *result_file);
+static int parse_result_document(const char *json, size_t len, ResultFile *result_file);
+static int run_compare(const char *baseline_path, const char *current_path, double threshold_pct);
+static int mock_bench_selected(const Config *config, const char *name);
+static void *find_librdkafka_symbol(const char *name);
+static int load_mock_api(MockApi *mock);
+static rd_kafka_t *create_mock_cluster(const Config *config, const MockApi *mock, const char *topic,
+                                       int partitions, const char **bootstraps);
+static thread_ret_t THREAD_CALL mock_bench_watchdog_main(void *arg);
+static int run_mock_bench_consumer(Config *run_config, RunResult *run_result, long long expected);
+static int run_mock_benchmark(const Config *config);
+static rd_kafka_resp_err_t produce_slot(rd_kafka_t *rk, const char *topic, MsgSlot *slot);
+static int parse_payload_size_distribution(const char *value);
+static int parse_payload_content(const char *value);
+static int parse_key_distribution(const char *value);
+static double *build_zipf_cdf(int key_space, double exponent);
+static long long next_key_index(ProducerWorker *worker, long long sequence);
+static size_t format_key(char *buf, long long index);
+static void print_partition_summary(const ProducerStats *stats);
+static uint64_t rng_next(uint64_t *state);
+static double rng_uniform(uint64_t *state);
+static int draw_payload_size(const Config *config, uint64_t *rng);
+static void fill_random(unsigned char *buf, size_t len, uint64_t *rng);
+static void fill_repeat(unsigned char *buf, size_t len, const char *pattern);
+static void generate_payload(unsigned char *buf, size_t len, const Config *config, uint64_t *rng);
+static size_t build_payload_arena(ProducerWorker *worker, const Config *config,
+                                  int payload_count, uint64_t seed);
+static thread_ret_t THREAD_CALL producer_thread_main(void *arg);
+static void collect_producer_stats(ProducerStats *merged, ProducerWorker *workers, int count);
+static int64_t get_wall_time_ns(void);
+static unsigned int get_process_id(void);
+static void encode_payload_header(unsigned char *buf, const PayloadHeader *header);
+static int decode_payload_header(const void *buf, size_t len, PayloadHeader *header);
+static int record_consumed_message(ConsumerStats *stats, const rd_kafka_message_t *rkmessage,
+                                   PayloadHeader *header, int64_t *e2e_latency_ns);
+static void print_consumer_summary(const ConsumerStats *stats, int64_t elapsed_ns);
+static void report_consumer_progress(ConsumerStats *stats, ConsumerProgress *progress,
+                                     int64_t now_ns);
+static int should_print_message(const Config *config, ConsumerProgress *progress,
+                                long long count, int64_t now_ns);
+static void handle_consumed_message(const Config *config, ConsumerStats *stats,
+                                    ConsumerProgress *progress, rd_kafka_message_t *rkmessage,
+                                    int *msg_count, int store_offset);
+static void burn_cpu_us(int microseconds);
+static thread_ret_t THREAD_CALL consumer_worker_main(void *arg);
+static int start_worker_pool(WorkerPool *pool, rd_kafka_t *rk, const Config *config,
+                             ConsumerStats *stats);
+static void stop_worker_pool(WorkerPool *pool);
+static void print_worker_pool_summary(const WorkerPool *pool, int64_t elapsed_ns);
+static OffsetTracker *get_offset_tracker(WorkerPool *pool, int partition);
+static void store_completed_offsets(WorkerPool *pool);
+static void dispatch_message(WorkerPool *pool, rd_kafka_message_t *rkmessage);
+static void set_partition_paused(rd_kafka_t *rk, const char *topic, int partition, int paused);
+static void resume_drained_partitions(WorkerPool *pool);
+static void destroy_consumer(rd_kafka_t *rk);
+static void send_commit(rd_kafka_t *rk, CommitState *commit);
+static void request_commit(rd_kafka_t *rk, CommitState *commit);
+static void commit_offsets_sync(rd_kafka_t *rk, CommitState *commit);
+static void maybe_commit(rd_kafka_t *rk, const Config *config, CommitState *commit,
+                         long long consumed, int64_t now_ns);
+static void offset_commit_cb(rd_kafka_t *rk, rd_kafka_resp_err_t err,
+                             rd_kafka_topic_partition_list_t *offsets, void *commit_opaque);
+static void rebalance_cb(rd_kafka_t *rk, rd_kafka_resp_err_t err,
+                         rd_kafka_topic_partition_list_t *partitions, void *opaque);
+static void print_commit_summary(const CommitState *commit, int64_t elapsed_ns);
+static void format_partition_list(const rd_kafka_topic_partition_list_t *list, char *buffer, size_t size);
+static void note_message_flow(ClientContext *context, int64_t now_ns);
+static void print_rebalance_summary(const RebalanceStats *rebalance);
+static thread_ret_t THREAD_CALL churn_member_main(void *arg);
+static rd_kafka_topic_partition_list_t *parse_partition_offsets(const char *value, const char *topic);
+static int update_consumer_lag(rd_kafka_t *rk, ConsumerLag *lag, int64_t now_ns);
+static void report_consumer_lag(const ConsumerLag *lag);
+static void print_lag_summary(const ConsumerLag *lag, const ConsumerStats *stats);
+static void wait_until_ns(rd_kafka_t *rk, int64_t deadline_ns);
+static void print_producer_summary(const ProducerStats *stats, int64_t elapsed_ns);
+static void report_producer_progress(ProducerStats *stats, ProducerProgress *progress,
+                                     int64_t now_ns);
+static void atomic_max_i64(int64_t *ptr, int64_t value);
+static int64_t hist_bucket_value(int index);
+static void hist_record(LatencyHistogram *hist, int64_t value);
+static int64_t hist_percentile(const LatencyHistogram *hist, double percentile);
+static void hist_delta(const LatencyHistogram *current, LatencyHistogram *previous,
+                       LatencyHistogram *delta);
+static void log_latency_percentiles(const char *label, const LatencyHistogram *hist);
 
 /* TUI Function prototypes */
 static void init_console(void);
@@ -108,6 +1117,15 @@ static int show_main_menu(void);
 static int show_ini_selector(char ini_files[MAX_INI_FILES][MAX_FILENAME_LENGTH], int file_count);
 static int find_ini_files(char ini_files[MAX_INI_FILES][MAX_FILENAME_LENGTH]);
 static int run_tui(char *selected_ini_file, int *selected_mode);
+static void show_cursor(int visible);
+static int start_dashboard(Dashboard *dashboard);
+static void stop_dashboard(Dashboard *dashboard);
+static thread_ret_t THREAD_CALL dashboard_main(void *arg);
+static void draw_dashboard(Dashboard *dashboard, int64_t now_ns);
+static void draw_dashboard_producer(Dashboard *dashboard, int64_t now_ns, double interval_sec, int *row);
+static void draw_dashboard_consumer(Dashboard *dashboard, int64_t now_ns, double interval_sec, int *row);
+static void draw_dashboard_brokers(const ClientStatistics *stats, int *row);
+static void dashboard_row(int row, int color, const char *format, ...);
 
 /*
  * Console color codes
@@ -120,6 +1138,11 @@ static int run_tui(char *selected_ini_file, int *selected_mode);
 #define COLOR_WHITE     15
 #define COLOR_GRAY      8
 
+/* Live dashboard layout: a fixed box redrawn in place */
+#define DASHBOARD_WIDTH 80
+#define DASHBOARD_HEIGHT 28
+#define DASHBOARD_BROKER_ROWS 3
+
 /*
  * Initialize console for TUI
  */
@@ -155,7 +1178,18 @@ static void restore_console(void) {
  */
 static void clear_screen(void) {
 #ifdef _WIN32
-    system("cls");
+    /* Fill the buffer through the console API instead of spawning "cls" */
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    COORD home = { 0, 0 };
+    DWORD cells, written;
+    
+    if (hConsole == NULL || !GetConsoleScreenBufferInfo(hConsole, &csbi)) {
+        return;
+    }
+    cells = (DWORD)csbi.dwSize.X * (DWORD)csbi.dwSize.Y;
+    FillConsoleOutputCharacter(hConsole, ' ', cells, home, &written);
+    FillConsoleOutputAttribute(hConsole, csbi.wAttributes, cells, home, &written);
+    SetConsoleCursorPosition(hConsole, home);
 #else
     printf("\033[2J\033[H");
 #endif
@@ -170,18 +1204,14 @@ static void set_color(int color) {
         SetConsoleTextAttribute(hConsole, color);
     }
 #else
-    const char *colors[] = {
-        "\033[0m",      /* 0 - reset */
-        "\033[31m",     /* 1 - red */
-        "\033[32m",     /* 2 - green */
-        "\033[33m",     /* 3 - yellow */
-        "\033[34m",     /* 4 - blue */
-        "\033[35m",     /* 5 - magenta */
-        "\033[36m",     /* 6 - cyan */
-        "\033[37m",     /* 7 - white */
-    };
-    if (color >= 0 && color < 8) {
-        printf("%s", colors[color]);
+    /* COLOR_* are console attributes (blue 1, green 2, red 4, bright 8);
+     * ANSI numbers the same colors red 1, green 2, blue 4 */
+    int ansi = ((color & 4) ? 1 : 0) | (color & 2) | ((color & 1) ? 4 : 0);
+    
+    if (color == COLOR_DEFAULT) {
+        printf("\033[0m");
+    } else if (color >= 0 && color < 16) {
+        printf("\033[%dm", ((color & 8) ? 90 : 30) + ansi);
     }
 #endif
 }
@@ -278,9 +1308,9 @@ static int find_ini_files(char ini_files[MAX_INI_FILES][MAX_FILENAME_LENGTH]) {
     dir = opendir(".");
     if (dir != NULL) {
         while ((entry = readdir(dir)) != NULL && count < MAX_INI_FILES) {
-            if (strstr(entry->d_name, ".ini") != NULL) {
-                strncpy(ini_files[count], entry->d_name, MAX_FILENAME_LENGTH - 1);
-                ini_files[count][MAX_FILENAME_LENGTH - 1] = '\0';
+            /* A truncated name would not open, so names that do not fit are skipped */
+            if (strstr(entry->d_name, ".ini") != NULL &&
+                snprintf(ini_files[count], MAX_FILENAME_LENGTH, "%s", entry->d_name) < MAX_FILENAME_LENGTH) {
                 count++;
             }
         }
@@ -546,714 +1576,7280 @@ static int run_tui(char *selected_ini_file, int *selected_mode) {
 }
 
 /*
- * Sanitize topic name for use in filename
- * Replaces special characters with underscores
+ * Show or hide the text cursor
  */
-static void sanitize_filename(char *dst, const char *src, size_t size) {
-    size_t i, j;
-    for (i = 0, j = 0; src[i] != '\0' && j < size - 1; i++) {
-        char c = src[i];
-        /* Allow alphanumeric, hyphen, underscore */
-        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || 
-            (c >= '0' && c <= '9') || c == '-' || c == '_') {
-            dst[j++] = c;
-        } else {
-            dst[j++] = '_';
-        }
+static void show_cursor(int visible) {
+#ifdef _WIN32
+    CONSOLE_CURSOR_INFO info;
+    
+    if (hConsole != NULL && GetConsoleCursorInfo(hConsole, &info)) {
+        info.bVisible = visible ? TRUE : FALSE;
+        SetConsoleCursorInfo(hConsole, &info);
     }
-    dst[j] = '\0';
+#else
+    printf(visible ? "\033[?25h" : "\033[?25l");
+#endif
 }
 
 /*
- * Initialize log file
- * Creates logs directory and opens file with naming: topic-name_mode_datetime.log
+ * Take over the screen for a live dashboard of a producer or consumer run.
+ * Log lines keep going to the log file; the console only shows the box.
+ * Returns 0 if the dashboard runs
  */
-static void init_log_file(const char *topic, const char *mode) {
-    time_t now;
-    struct tm *timeinfo;
-    char datetime[64];
-    char sanitized_topic[256];
-    char filename[MAX_FILENAME_LENGTH];
-    char filepath[MAX_FILENAME_LENGTH * 2];
-    
-    /* Create logs directory if it doesn't exist */
+static int start_dashboard(Dashboard *dashboard) {
 #ifdef _WIN32
-    CreateDirectory(LOGS_DIR, NULL);
+    if (!_isatty(_fileno(stdout))) {
 #else
-    mkdir(LOGS_DIR, 0755);
+    if (!isatty(STDOUT_FILENO)) {
 #endif
+        log_message(1, "WARNING", "Dashboard needs a terminal, using log output instead");
+        return -1;
+    }
     
-    /* Get current datetime */
-    time(&now);
-    timeinfo = localtime(&now);
-    strftime(datetime, sizeof(datetime), "%Y%m%d_%H%M%S", timeinfo);
-    
-    /* Sanitize topic name for filename */
-    sanitize_filename(sanitized_topic, topic, sizeof(sanitized_topic));
+    if (dashboard->workers) {
+        dashboard->producer_stats = (ProducerStats *)calloc(1, sizeof(ProducerStats));
+    } else {
+        dashboard->lag = (ConsumerLag *)calloc(1, sizeof(ConsumerLag));
+    }
+    if (!dashboard->producer_stats && !dashboard->lag) {
+        log_message(1, "WARNING", "Failed to allocate dashboard state, using log output instead");
+        return -1;
+    }
     
-    /* Create filename: topic-name_mode_datetime.log */
-    snprintf(filename, sizeof(filename), "%s_%s_%s.log", sanitized_topic, mode, datetime);
+    log_message(1, "INFO", "Dashboard started, log output continues in %s", log_file_path);
+    ATOMIC_STORE_RELEASE(&async_logger.console_muted, 1);
+    ATOMIC_STORE(&async_logger.muted_warnings, 0);
     
-    /* Full path */
-#ifdef _WIN32
-    snprintf(filepath, sizeof(filepath), "%s\\%s", LOGS_DIR, filename);
-#else
-    snprintf(filepath, sizeof(filepath), "%s/%s", LOGS_DIR, filename);
-#endif
+    init_console();
+    clear_screen();
+    show_cursor(0);
+    set_color(COLOR_GRAY);
+    draw_box(1, 1, DASHBOARD_WIDTH, DASHBOARD_HEIGHT);
+    reset_color();
+    fflush(stdout);
     
-    /* Open log file */
-    log_file = fopen(filepath, "w");
-    if (log_file) {
-        fprintf(log_file, "Kafka CLI Tool Log\n");
-        fprintf(log_file, "==================\n");
-        fprintf(log_file, "Topic: %s\n", topic);
-        fprintf(log_file, "Mode: %s\n", mode);
-        fprintf(log_file, "Started: %s\n", datetime);
-        fprintf(log_file, "==================\n\n");
-        fflush(log_file);
+    dashboard->start_ns = get_time_ns();
+    dashboard->last_ns = dashboard->start_ns;
+    ATOMIC_STORE_RELEASE(&dashboard->running, 1);
+    if (thread_create(&dashboard->thread, dashboard_main, dashboard) != 0) {
+        ATOMIC_STORE_RELEASE(&dashboard->running, 0);
+        show_cursor(1);
+        restore_console();
+        ATOMIC_STORE_RELEASE(&async_logger.console_muted, 0);
+        free(dashboard->producer_stats);
+        free(dashboard->lag);
+        log_message(1, "WARNING", "Failed to start the dashboard thread, using log output instead");
+        return -1;
     }
+    return 0;
 }
 
 /*
- * Close log file
+ * Draw a last frame with the final numbers and hand the console back to
+ * the log
  */
-static void close_log_file(void) {
-    if (log_file) {
-        time_t now;
-        struct tm *timeinfo;
-        char datetime[64];
-        
-        time(&now);
-        timeinfo = localtime(&now);
-        strftime(datetime, sizeof(datetime), "%Y-%m-%d %H:%M:%S", timeinfo);
-        
-        fprintf(log_file, "\n==================\n");
-        fprintf(log_file, "Finished: %s\n", datetime);
-        fprintf(log_file, "==================\n");
-        
-        fclose(log_file);
-        log_file = NULL;
+static void stop_dashboard(Dashboard *dashboard) {
+    if (!ATOMIC_LOAD(&dashboard->running)) {
+        return;
     }
+    ATOMIC_STORE_RELEASE(&dashboard->running, 0);
+    thread_join(dashboard->thread);
+    
+    draw_dashboard(dashboard, get_time_ns());
+    move_cursor(1, DASHBOARD_HEIGHT + 1);
+    show_cursor(1);
+    restore_console();
+    printf("\n");
+    fflush(stdout);
+    ATOMIC_STORE_RELEASE(&async_logger.console_muted, 0);
+    
+    free(dashboard->producer_stats);
+    free(dashboard->lag);
+    dashboard->producer_stats = NULL;
+    dashboard->lag = NULL;
 }
 
 /*
- * Print usage information
- */
-static void print_usage(const char *program) {
-    printf("Usage: %s [options] <command>\n\n", program);
-    printf("Commands:\n");
-    printf("  produce    Run as producer\n");
-    printf("  consume    Run as consumer\n");
-    printf("\nOptions:\n");
-    printf("  -c <file>  Configuration file (default: %s)\n", DEFAULT_INI_FILE);
-    printf("  -m <num>   Number of messages to produce/consume (default: from config)\n");
-    printf("  -v         Enable verbose logging\n");
-    printf("  -V         Show version\n");
-    printf("  -h         Show this help\n");
-    printf("\nTUI Mode:\n");
-    printf("  Run without arguments to launch interactive menu\n");
-    printf("\nExamples:\n");
-    printf("  %s                    # Launch TUI menu\n", program);
-    printf("  %s -c config.ini produce\n", program);
-    printf("  %s -v -m 100 consume\n", program);
-}
-
-/*
- * Print version information
+ * Dashboard thread: redraws every dashboard_refresh_ms
  */
-static void print_version(void) {
-    printf("Kafka CLI Tool v%s\n", VERSION);
-    printf("Built with librdkafka %s\n", rd_kafka_version_str());
+static thread_ret_t THREAD_CALL dashboard_main(void *arg) {
+    Dashboard *dashboard = (Dashboard *)arg;
+    int refresh_ms = dashboard->config->dashboard_refresh_ms > 0 ? dashboard->config->dashboard_refresh_ms : 500;
+    int64_t next_ns = get_time_ns();
+    
+    while (ATOMIC_LOAD_ACQUIRE(&dashboard->running)) {
+        if (get_time_ns() >= next_ns) {
+            draw_dashboard(dashboard, get_time_ns());
+            next_ns += (int64_t)refresh_ms * 1000000LL;
+        }
+        sleep_ms(refresh_ms < 50 ? refresh_ms : 50);
+    }
+    return 0;
 }
 
 /*
- * Logging function with timestamp and verbosity control
- * Also writes to log file if initialized
+ * One dashboard frame: every row is rewritten at its full width, so the
+ * screen is never cleared and does not flicker
  */
-static void log_message(int verbose, const char *level, const char *format, ...) {
-    va_list args;
-    time_t now;
-    struct tm *timeinfo;
-    char timestamp[64];
+static void draw_dashboard(Dashboard *dashboard, int64_t now_ns) {
+    double interval_sec = (double)(now_ns - dashboard->last_ns) / 1e9;
+    long long warnings = ATOMIC_LOAD(&async_logger.muted_warnings);
+    int row = 2;
     
-    if (!verbose && strcmp(level, "DEBUG") == 0) {
-        return;
+    if (interval_sec <= 0.0) {
+        interval_sec = 1e-9;
     }
     
-    time(&now);
-    timeinfo = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-    
-    /* Print to console */
-    printf("[%s] [%s] ", timestamp, level);
-    
-    va_start(args, format);
-    vprintf(format, args);
-    va_end(args);
-    
-    printf("\n");
+    dashboard_row(row++, COLOR_CYAN, "kafka_cli %s   topic %s   %.1f s%s", dashboard->mode,
+                  dashboard->config->topic, (double)(now_ns - dashboard->start_ns) / 1e9,
+                  ATOMIC_LOAD(&dashboard->running) ? "" : "   (finished)");
+    dashboard_row(row++, COLOR_DEFAULT, "");
+    if (dashboard->workers) {
+        draw_dashboard_producer(dashboard, now_ns, interval_sec, &row);
+    } else {
+        draw_dashboard_consumer(dashboard, now_ns, interval_sec, &row);
+    }
+    while (row < DASHBOARD_HEIGHT - 1) {
+        dashboard_row(row++, COLOR_DEFAULT, "");
+    }
     
-    /* Write to log file if open */
-    if (log_file) {
-        fprintf(log_file, "[%s] [%s] ", timestamp, level);
-        va_start(args, format);
-        vfprintf(log_file, format, args);
-        va_end(args);
-        fprintf(log_file, "\n");
-        fflush(log_file);
+    if (warnings > 0) {
+        dashboard_row(DASHBOARD_HEIGHT - 1, COLOR_YELLOW, "%lld warnings/errors, see %s", warnings, log_file_path);
+    } else {
+        dashboard_row(DASHBOARD_HEIGHT - 1, COLOR_GRAY, "Log: %s", log_file_path);
     }
+    fflush(stdout);
+    dashboard->last_ns = now_ns;
 }
 
 /*
- * Trim whitespace from string
+ * Producer rows: throughput, ack latency of the last interval, errors,
+ * queues, brokers and per-partition deliveries
  */
-static char* trim_whitespace(char *str) {
-    char *end;
+static void draw_dashboard_producer(Dashboard *dashboard, int64_t now_ns, double interval_sec, int *row) {
+    ProducerStats *stats = dashboard->producer_stats;
+    const LatencyHistogram *latency = &dashboard->interval_latency;
+    long long outq = 0, problems;
+    int i, shown = 0;
     
-    while (isspace((unsigned char)*str)) str++;
+    (void)now_ns;
     
-    if (*str == 0) return str;
+    collect_producer_stats(stats, dashboard->workers, dashboard->worker_count);
+    hist_delta(&stats->ack_latency, &dashboard->last_latency, &dashboard->interval_latency);
+    for (i = 0; i < dashboard->worker_count; i++) {
+        if (dashboard->workers[i].rk && (i == 0 || dashboard->workers[i].rk != dashboard->shared_rk)) {
+            outq += rd_kafka_outq_len(dashboard->workers[i].rk);
+        }
+    }
+    problems = stats->failed + stats->dropped + stats->produce_errors;
     
-    end = str + strlen(str) - 1;
-    while (end > str && isspace((unsigned char)*end)) end--;
+    dashboard_row((*row)++, COLOR_WHITE, "Throughput   %11.1f msg/s  %9.3f MB/s   delivered %lld",
+                  (double)(stats->delivered - dashboard->last_count) / interval_sec,
+                  (double)(stats->bytes_delivered - dashboard->last_bytes) / (1024.0 * 1024.0) / interval_sec,
+                  stats->delivered);
+    if (latency->total_count > 0) {
+        dashboard_row((*row)++, COLOR_DEFAULT, "Ack latency  p50 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms",
+                      (double)hist_percentile(latency, 50.0) / 1e6, (double)hist_percentile(latency, 99.0) / 1e6,
+                      (double)hist_percentile(latency, 99.9) / 1e6, (double)latency->max_value / 1e6);
+    } else {
+        dashboard_row((*row)++, COLOR_DEFAULT, "Ack latency  no deliveries in the last interval");
+    }
+    dashboard_row((*row)++, problems > 0 ? COLOR_RED : COLOR_DEFAULT,
+                  "Errors       failed %lld  dropped %lld  rejected %lld  queue full stall %.3f s",
+                  stats->failed, stats->dropped, stats->produce_errors, (double)stats->queue_full_stall_ns / 1e9);
+    dashboard_row((*row)++, COLOR_DEFAULT, "Queue        %lld awaiting delivery, %lld in librdkafka queues",
+                  stats->produced - stats->delivered - stats->failed, outq);
+    if (dashboard->config->statistics_interval_ms > 0) {
+        draw_dashboard_brokers(&((ClientContext *)rd_kafka_opaque(dashboard->workers[0].rk))->statistics, row);
+    }
     
-    end[1] = '\0';
-    return str;
+    dashboard_row((*row)++, COLOR_DEFAULT, "");
+    dashboard_row((*row)++, COLOR_CYAN, "Partition        Messages     Share       Ack avg       Ack max");
+    for (i = 0; i < MAX_TRACKED_PARTITIONS && *row < DASHBOARD_HEIGHT - 2; i++) {
+        if (stats->partition_messages[i] == 0) {
+            continue;
+        }
+        dashboard_row((*row)++, COLOR_DEFAULT, "%9d  %14lld  %7.1f%%  %9.3f ms  %9.3f ms", i,
+                      stats->partition_messages[i],
+                      stats->delivered > 0 ? 100.0 * (double)stats->partition_messages[i] / (double)stats->delivered : 0.0,
+                      (double)stats->partition_latency_sum_ns[i] / (double)stats->partition_messages[i] / 1e6,
+                      (double)stats->partition_latency_max_ns[i] / 1e6);
+        shown++;
+    }
+    if (shown == 0) {
+        dashboard_row((*row)++, COLOR_GRAY, "%9s  waiting for the first delivery", "");
+    }
+    
+    dashboard->last_count = stats->delivered;
+    dashboard->last_bytes = stats->bytes_delivered;
 }
 
 /*
- * Parse INI configuration file
+ * Consumer rows: throughput, end-to-end latency of the last interval,
+ * errors, worker queues, brokers and per-partition lag
  */
-static int parse_ini_file(const char *filename, Config *config) {
-    FILE *file;
-    char line[MAX_LINE_LENGTH];
-    char *key, *value;
-    char *delimiter;
+static void draw_dashboard_consumer(Dashboard *dashboard, int64_t now_ns, double interval_sec, int *row) {
+    ConsumerStats *stats = dashboard->consumer_stats;
+    ConsumerLag *lag = dashboard->lag;
+    const LatencyHistogram *latency = &dashboard->interval_latency;
+    long long consumed = ATOMIC_LOAD(&stats->consumed);
+    long long bytes = ATOMIC_LOAD(&stats->bytes);
+    long long errors = ATOMIC_LOAD(&stats->errors);
+    long long depth = 0;
+    int i, shown = 0;
     
-    /* Set defaults */
-    strcpy(config->brokers, "localhost:9092");
-    strcpy(config->topic, "test-topic");
-    strcpy(config->security_protocol, "SSL");
-    strcpy(config->ssl_ca_location, "");
-    strcpy(config->ssl_certificate_location, "");
-    strcpy(config->ssl_key_location, "");
-    strcpy(config->ssl_key_password, "");
-    config->ssl_skip_certificate_verify = 0;
-    config->producer_batch_size = 16384;
-    config->producer_linger_ms = 5;
-    config->producer_ack = 1;
-    strcpy(config->consumer_group_id, "kafka-cli-consumer");
-    strcpy(config->consumer_auto_offset_reset, "earliest");
-    config->consumer_session_timeout_ms = 45000;
-    strcpy(config->consumer_enable_auto_commit, "true");
-    config->verbose = 0;
-    config->message_count = 10;
+    hist_delta(&stats->e2e_latency, &dashboard->last_latency, &dashboard->interval_latency);
     
-    file = fopen(filename, "r");
-    if (!file) {
-        log_message(1, "WARNING", "Cannot open config file '%s', using defaults", filename);
-        return 0;
+    dashboard_row((*row)++, COLOR_WHITE, "Throughput   %11.1f msg/s  %9.3f MB/s   consumed %lld",
+                  (double)(consumed - dashboard->last_count) / interval_sec,
+                  (double)(bytes - dashboard->last_bytes) / (1024.0 * 1024.0) / interval_sec, consumed);
+    if (latency->total_count > 0) {
+        dashboard_row((*row)++, COLOR_DEFAULT, "E2E latency  p50 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms",
+                      (double)hist_percentile(latency, 50.0) / 1e6, (double)hist_percentile(latency, 99.0) / 1e6,
+                      (double)hist_percentile(latency, 99.9) / 1e6, (double)latency->max_value / 1e6);
+    } else {
+        dashboard_row((*row)++, COLOR_DEFAULT, "E2E latency  no kafka_cli messages in the last interval");
+    }
+    dashboard_row((*row)++, errors > 0 ? COLOR_RED : COLOR_DEFAULT,
+                  "Errors       %lld consumer errors, %lld without header, %lld clock skewed",
+                  errors, ATOMIC_LOAD(&stats->headerless), ATOMIC_LOAD(&stats->clock_skewed));
+    if (dashboard->pool) {
+        for (i = 0; i < dashboard->pool->worker_count; i++) {
+            depth += (long long)(ATOMIC_LOAD(&dashboard->pool->workers[i].queue.head) -
+                                 ATOMIC_LOAD(&dashboard->pool->workers[i].queue.tail));
+        }
+        dashboard_row((*row)++, COLOR_DEFAULT, "Queue        %lld of %lld messages waiting for %d workers",
+                      depth, (long long)dashboard->pool->workers[0].queue.capacity * dashboard->pool->worker_count,
+                      dashboard->pool->worker_count);
+    } else {
+        dashboard_row((*row)++, COLOR_DEFAULT, "Queue        messages handled on the polling thread");
+    }
+    if (dashboard->config->statistics_interval_ms > 0) {
+        draw_dashboard_brokers(&((ClientContext *)rd_kafka_opaque(dashboard->rk))->statistics, row);
     }
     
-    log_message(1, "INFO", "Loading configuration from: %s", filename);
-    
-    while (fgets(line, sizeof(line), file)) {
-        /* Remove comments */
-        char *comment = strchr(line, ';');
-        if (comment) *comment = '\0';
-        comment = strchr(line, '#');
-        if (comment) *comment = '\0';
-        
-        /* Trim whitespace */
-        char *trimmed = trim_whitespace(line);
-        if (strlen(trimmed) == 0) continue;
-        
-        /* Skip section headers */
-        if (trimmed[0] == '[') continue;
-        
-        /* Find key-value delimiter */
-        delimiter = strchr(trimmed, '=');
-        if (!delimiter) continue;
-        
-        *delimiter = '\0';
-        key = trim_whitespace(trimmed);
-        value = trim_whitespace(delimiter + 1);
-        
-        /* Parse configuration values */
-        if (strcmp(key, "brokers") == 0) {
-            strncpy(config->brokers, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "topic") == 0) {
-            strncpy(config->topic, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "security_protocol") == 0) {
-            strncpy(config->security_protocol, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "ssl_ca_location") == 0) {
-            strncpy(config->ssl_ca_location, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "ssl_certificate_location") == 0) {
-            strncpy(config->ssl_certificate_location, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "ssl_key_location") == 0) {
-            strncpy(config->ssl_key_location, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "ssl_key_password") == 0) {
-            strncpy(config->ssl_key_password, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "ssl_skip_certificate_verify") == 0) {
-            config->ssl_skip_certificate_verify = atoi(value);
-        } else if (strcmp(key, "producer_batch_size") == 0) {
-            config->producer_batch_size = atoi(value);
-        } else if (strcmp(key, "producer_linger_ms") == 0) {
-            config->producer_linger_ms = atoi(value);
-        } else if (strcmp(key, "producer_ack") == 0) {
-            config->producer_ack = atoi(value);
-        } else if (strcmp(key, "consumer_group_id") == 0) {
-            strncpy(config->consumer_group_id, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "consumer_auto_offset_reset") == 0) {
-            strncpy(config->consumer_auto_offset_reset, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "consumer_session_timeout_ms") == 0) {
-            config->consumer_session_timeout_ms = atoi(value);
-        } else if (strcmp(key, "consumer_enable_auto_commit") == 0) {
-            strncpy(config->consumer_enable_auto_commit, value, MAX_VALUE_LENGTH - 1);
-        } else if (strcmp(key, "verbose") == 0) {
-            config->verbose = atoi(value);
-        } else if (strcmp(key, "message_count") == 0) {
-            config->message_count = atoi(value);
+    /* Lag from this thread's own snapshot: assignment and positions are thread-safe */
+    update_consumer_lag(dashboard->rk, lag, now_ns);
+    dashboard_row((*row)++, COLOR_DEFAULT, "");
+    dashboard_row((*row)++, COLOR_CYAN, "Partition        Consumed        Position    High watermark           Lag");
+    for (i = 0; i < MAX_TRACKED_PARTITIONS && *row < DASHBOARD_HEIGHT - 2; i++) {
+        if (!lag->assigned[i]) {
+            continue;
         }
+        if (lag->lag[i] < 0) {
+            dashboard_row((*row)++, COLOR_DEFAULT, "%9d  %14lld  %14s  %16s  %12s", i,
+                          ATOMIC_LOAD(&stats->partition_consumed[i]), "-", "-", "unknown");
+        } else {
+            dashboard_row((*row)++, lag->lag[i] > 0 ? COLOR_YELLOW : COLOR_DEFAULT,
+                          "%9d  %14lld  %14lld  %16lld  %12lld", i,
+                          ATOMIC_LOAD(&stats->partition_consumed[i]), (long long)lag->position[i],
+                          (long long)lag->high_watermark[i], (long long)lag->lag[i]);
+        }
+        shown++;
+    }
+    if (shown == 0) {
+        dashboard_row((*row)++, COLOR_GRAY, "%9s  no partitions assigned yet", "");
     }
     
-    fclose(file);
-    return 0;
+    dashboard->last_count = consumed;
+    dashboard->last_bytes = bytes;
 }
 
 /*
- * Print configuration (with sensitive data masked)
+ * Broker rows from the latest parsed statistics report
  */
-static void print_config(const Config *config) {
-    log_message(1, "CONFIG", "=== Configuration ===");
-    log_message(1, "CONFIG", "Brokers: %s", config->brokers);
-    log_message(1, "CONFIG", "Topic: %s", config->topic);
-    log_message(1, "CONFIG", "Security Protocol: %s", config->security_protocol);
-    log_message(1, "CONFIG", "CA Location: %s", 
-                strlen(config->ssl_ca_location) > 0 ? config->ssl_ca_location : "(not set)");
-    log_message(1, "CONFIG", "Certificate Location: %s",
-                strlen(config->ssl_certificate_location) > 0 ? config->ssl_certificate_location : "(not set)");
-    log_message(1, "CONFIG", "Key Location: %s",
-                strlen(config->ssl_key_location) > 0 ? config->ssl_key_location : "(not set)");
-    log_message(1, "CONFIG", "Key Password: %s",
-                strlen(config->ssl_key_password) > 0 ? "***" : "(not set)");
-    log_message(1, "CONFIG", "Message Count: %d", config->message_count);
-    log_message(1, "CONFIG", "Verbose: %d", config->verbose);
-    log_message(1, "CONFIG", "Auto Commit: %s", config->consumer_enable_auto_commit);
-    log_message(1, "CONFIG", "Skip Certificate Verify: %s", 
-                config->ssl_skip_certificate_verify ? "true" : "false");
-    log_message(1, "CONFIG", "=====================");
+static void draw_dashboard_brokers(const ClientStatistics *stats, int *row) {
+    const BrokerStatistics *broker;
+    int broker_count = ATOMIC_LOAD_ACQUIRE(&stats->broker_count);
+    int i, shown = 0;
+    
+    for (i = 0; i < broker_count && shown < DASHBOARD_BROKER_ROWS; i++) {
+        broker = &stats->brokers[i];
+        if (ATOMIC_LOAD(&broker->nodeid) < 0) {
+            continue;
+        }
+        dashboard_row((*row)++, ATOMIC_LOAD(&broker->throttle_max_ms) > 0 ? COLOR_YELLOW : COLOR_DEFAULT,
+                      "%-12.12s rtt %.2f ms (p99 %.2f)  in flight %lld  outbuf %lld  throttle %lld ms",
+                      broker->name, (double)ATOMIC_LOAD(&broker->rtt_avg_us) / 1000.0,
+                      (double)ATOMIC_LOAD(&broker->rtt_p99_us) / 1000.0, (long long)ATOMIC_LOAD(&broker->waitresp_cnt),
+                      (long long)ATOMIC_LOAD(&broker->outbuf_cnt), (long long)ATOMIC_LOAD(&broker->throttle_avg_ms));
+        shown++;
+    }
+    if (shown == 0) {
+        dashboard_row((*row)++, COLOR_GRAY, "Brokers      waiting for the first statistics report");
+    }
 }
 
 /*
- * Delivery report callback for producer
+ * Write one dashboard row inside the box, padded to the full width so the
+ * previous frame's text is overwritten
  */
-static void dr_msg_cb(rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque) {
-    Config *config = (Config *)opaque;
+static void dashboard_row(int row, int color, const char *format, ...) {
+    char text[DASHBOARD_WIDTH];
+    va_list args;
     
-    if (rkmessage->err) {
-        log_message(config->verbose, "ERROR", "Message delivery failed: %s",
-                    rd_kafka_err2str(rkmessage->err));
-    } else {
-        log_message(config->verbose, "DEBUG", "Message delivered to partition %d at offset %lld",
-                    (int)rkmessage->partition, (long long)rkmessage->offset);
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    
+    move_cursor(3, row);
+    if (color != COLOR_DEFAULT) {
+        set_color(color);
+    }
+    printf("%-*.*s", DASHBOARD_WIDTH - 4, DASHBOARD_WIDTH - 4, text);
+    if (color != COLOR_DEFAULT) {
+        reset_color();
     }
 }
 
 /*
- * Create Kafka producer with mTLS configuration
+ * Start the metrics exporter if an HTTP port or a textfile is configured.
+ * Failures are warnings: the run itself does not depend on metrics.
  */
-static rd_kafka_t* create_producer(const Config *config) {
-    rd_kafka_t *rk;
-    rd_kafka_conf_t *conf;
-    char errstr[512];
+static void start_metrics_exporter(const Config *config) {
+    MetricsExporter *exporter = &metrics_exporter;
+#ifdef _WIN32
+    WSADATA wsa_data;
+#endif
     
-    conf = rd_kafka_conf_new();
+    if (config->metrics_port <= 0 && config->metrics_textfile[0] == '\0') {
+        return;
+    }
+    exporter->config = config;
+    exporter->listen_socket = INVALID_SOCKET;
+    exporter->capacity = 16384;
+    exporter->buffer = (char *)malloc(exporter->capacity);
+    exporter->producer_stats = (ProducerStats *)calloc(1, sizeof(ProducerStats));
+    exporter->lag = (ConsumerLag *)calloc(1, sizeof(ConsumerLag));
+    if (!exporter->buffer || !exporter->producer_stats || !exporter->lag) {
+        log_message(1, "WARNING", "Failed to allocate metrics exporter state, metrics disabled");
+        free(exporter->buffer);
+        free(exporter->producer_stats);
+        free(exporter->lag);
+        memset(exporter, 0, sizeof(*exporter));
+        return;
+    }
     
-    /* Enable librdkafka debug logging if verbose mode */
-    if (config->verbose) {
-        if (rd_kafka_conf_set(conf, "debug", "all",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "WARNING", "Failed to set debug: %s", errstr);
-        }
-        if (rd_kafka_conf_set(conf, "log_level", "7",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "WARNING", "Failed to set log_level: %s", errstr);
+    if (config->metrics_port > 0) {
+#ifdef _WIN32
+        if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+            log_message(1, "WARNING", "Failed to initialize Winsock, metrics endpoint disabled");
+        } else if (open_metrics_socket(config->metrics_bind, config->metrics_port,
+                                       &exporter->listen_socket) != 0) {
+            WSACleanup();
         }
+#else
+        /* A scraper hanging up mid-response must not end the run */
+        signal(SIGPIPE, SIG_IGN);
+        open_metrics_socket(config->metrics_bind, config->metrics_port, &exporter->listen_socket);
+#endif
+    }
+    if (config->metrics_textfile[0] != '\0') {
+        log_message(1, "INFO", "Metrics written to %s every %d ms", config->metrics_textfile,
+                    config->metrics_textfile_interval_ms);
+    } else if (exporter->listen_socket == INVALID_SOCKET) {
+        stop_metrics_exporter();
+        return;
     }
     
-    /* Set bootstrap servers */
-    if (rd_kafka_conf_set(conf, "bootstrap.servers", config->brokers,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set bootstrap.servers: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    exporter->start_ns = get_time_ns();
+    ATOMIC_STORE_RELEASE(&exporter->running, 1);
+    if (thread_create(&exporter->thread, metrics_main, exporter) != 0) {
+        log_message(1, "WARNING", "Failed to start the metrics thread, metrics disabled");
+        ATOMIC_STORE_RELEASE(&exporter->running, 0);
+        stop_metrics_exporter();
     }
+}
+
+/*
+ * Stop the exporter thread (it writes the textfile one last time) and
+ * release the endpoint
+ */
+static void stop_metrics_exporter(void) {
+    MetricsExporter *exporter = &metrics_exporter;
     
-    /* Configure mTLS authentication */
-    if (strcmp(config->security_protocol, "SSL") == 0) {
-        log_message(1, "INFO", "Configuring mTLS authentication...");
-        
-        if (rd_kafka_conf_set(conf, "security.protocol", "SSL",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "ERROR", "Failed to set security.protocol: %s", errstr);
-            rd_kafka_conf_destroy(conf);
+    if (ATOMIC_LOAD(&exporter->running)) {
+        ATOMIC_STORE_RELEASE(&exporter->running, 0);
+        thread_join(exporter->thread);
+    }
+    if (exporter->listen_socket != INVALID_SOCKET) {
+        close_socket(exporter->listen_socket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+    free(exporter->buffer);
+    free(exporter->producer_stats);
+    free(exporter->lag);
+    memset(exporter, 0, sizeof(*exporter));
+}
+
+/*
+ * Publish a producer run's counters to the exporter until detach_metrics()
+ */
+static void attach_producer_metrics(ProducerWorker *workers, int worker_count, rd_kafka_t *shared_rk) {
+    MetricsExporter *exporter = &metrics_exporter;
+    
+    if (!ATOMIC_LOAD_ACQUIRE(&exporter->running)) {
+        return;
+    }
+    exporter->workers = workers;
+    exporter->worker_count = worker_count;
+    exporter->shared_rk = shared_rk;
+    exporter->rk = NULL;
+    exporter->consumer_stats = NULL;
+    exporter->attach_ns = get_time_ns();
+    ATOMIC_ADD(&exporter->runs, 1);
+    ATOMIC_STORE_RELEASE(&exporter->mode, "producer");
+}
+
+/*
+ * Publish a consumer run's counters to the exporter until detach_metrics()
+ */
+static void attach_consumer_metrics(rd_kafka_t *rk, ConsumerStats *stats) {
+    MetricsExporter *exporter = &metrics_exporter;
+    
+    if (!ATOMIC_LOAD_ACQUIRE(&exporter->running)) {
+        return;
+    }
+    exporter->workers = NULL;
+    exporter->worker_count = 0;
+    exporter->shared_rk = NULL;
+    exporter->rk = rk;
+    exporter->consumer_stats = stats;
+    exporter->attach_ns = get_time_ns();
+    ATOMIC_ADD(&exporter->runs, 1);
+    ATOMIC_STORE_RELEASE(&exporter->mode, "consumer");
+}
+
+/*
+ * Withdraw the attached run before its counters are freed. The exporter
+ * thread finishes any scrape in progress, writes the textfile with the final
+ * values and then lets go; this waits one exporter cycle. A scrape is
+ * bounded by METRICS_CLIENT_TIMEOUT_MS, so only blocked textfile I/O can
+ * hold the exporter longer; then the run is withdrawn without its help,
+ * once the exporter is not reading its counters.
+ */
+static void detach_metrics(void) {
+    MetricsExporter *exporter = &metrics_exporter;
+    int64_t deadline_ns;
+    long long request;
+    
+    if (!ATOMIC_LOAD_ACQUIRE(&exporter->running) || !ATOMIC_LOAD_ACQUIRE(&exporter->mode)) {
+        return;
+    }
+    deadline_ns = get_time_ns() + (int64_t)METRICS_DETACH_TIMEOUT_MS * 1000000LL;
+    request = ATOMIC_LOAD(&exporter->runs);
+    ATOMIC_STORE_RELEASE(&exporter->detach_requested, request);
+    while (ATOMIC_LOAD_ACQUIRE(&exporter->mode)) {
+        if (get_time_ns() >= deadline_ns) {
+            log_message(1, "WARNING", "Metrics exporter did not respond, detaching the run without it");
+            /* Withdraw the request too, or the exporter would detach the next run at once */
+            ATOMIC_CAS(&exporter->detach_requested, &request, 0);
+            ATOMIC_STORE_SEQ_CST(&exporter->mode, (const char *)NULL);
+            while (ATOMIC_LOAD_SEQ_CST(&exporter->rendering)) {
+                sleep_ms(1);
+            }
+            break;
+        }
+        sleep_ms(10);
+    }
+}
+
+/*
+ * Exporter thread: answers scrapes and rewrites the textfile
+ */
+static thread_ret_t THREAD_CALL metrics_main(void *arg) {
+    MetricsExporter *exporter = (MetricsExporter *)arg;
+    const Config *config = exporter->config;
+    int interval_ms = config->metrics_textfile_interval_ms > 0 ? config->metrics_textfile_interval_ms : 5000;
+    fd_set readable;
+    struct timeval timeout;
+    socket_t client;
+    int64_t now_ns;
+    long long detach;
+    
+    exporter->next_textfile_ns = get_time_ns();
+    while (ATOMIC_LOAD_ACQUIRE(&exporter->running)) {
+        detach = ATOMIC_LOAD_ACQUIRE(&exporter->detach_requested);
+        if (exporter->listen_socket != INVALID_SOCKET) {
+            FD_ZERO(&readable);
+            FD_SET(exporter->listen_socket, &readable);
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 100000;
+            if (select((int)exporter->listen_socket + 1, &readable, NULL, NULL, &timeout) > 0) {
+                client = accept(exporter->listen_socket, NULL, NULL);
+                if (client != INVALID_SOCKET) {
+                    serve_metrics_client(exporter, client);
+                    close_socket(client);
+                }
+            }
+        } else {
+            sleep_ms(interval_ms < 100 ? interval_ms : 100);
+        }
+        
+        now_ns = get_time_ns();
+        if (config->metrics_textfile[0] != '\0' && (detach || now_ns >= exporter->next_textfile_ns)) {
+            write_metrics_textfile(exporter);
+            exporter->next_textfile_ns = now_ns + (int64_t)interval_ms * 1000000LL;
+        }
+        /* Unless detach_metrics() gave up on this request meanwhile */
+        if (detach && ATOMIC_CAS(&exporter->detach_requested, &detach, 0)) {
+            ATOMIC_STORE_RELEASE(&exporter->mode, (const char *)NULL);
+        }
+    }
+    
+    /* Leave a file that says the tool is no longer running a workload */
+    if (config->metrics_textfile[0] != '\0') {
+        write_metrics_textfile(exporter);
+    }
+    return 0;
+}
+
+/*
+ * Listen on address:port for scrapes
+ * Returns 0 on success
+ */
+static int open_metrics_socket(const char *address, int port, socket_t *listen_socket) {
+    struct sockaddr_in addr;
+    socket_t fd;
+    int reuse = 1;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        log_message(1, "WARNING", "Invalid metrics_bind address '%s', metrics endpoint disabled", address);
+        return -1;
+    }
+    
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == INVALID_SOCKET) {
+        log_message(1, "WARNING", "Failed to create the metrics socket, metrics endpoint disabled");
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        log_message(1, "WARNING", "Failed to listen on %s:%d, metrics endpoint disabled", address, port);
+        close_socket(fd);
+        return -1;
+    }
+    *listen_socket = fd;
+    log_message(1, "INFO", "Metrics served on http://%s:%d/metrics", address, port);
+    return 0;
+}
+
+/*
+ * Answer one HTTP request: the exposition text for GET /metrics, 404 for
+ * anything else. A client gets METRICS_CLIENT_TIMEOUT_MS for the whole
+ * exchange, so one that stops reading cannot hold the exporter.
+ */
+static void serve_metrics_client(MetricsExporter *exporter, socket_t client) {
+    char request[2048];
+    char header[256];
+    const char *status = "404 Not Found";
+    const char *body = "Metrics are served on /metrics\n";
+    size_t used = 0, body_len, sent;
+    int64_t deadline_ns = get_time_ns() + (int64_t)METRICS_CLIENT_TIMEOUT_MS * 1000000LL;
+    int64_t remaining_ns;
+    fd_set readable;
+    struct timeval timeout;
+    int result;
+#ifdef _WIN32
+    DWORD send_timeout = METRICS_CLIENT_TIMEOUT_MS;
+#else
+    struct timeval send_timeout;
+    
+    send_timeout.tv_sec = METRICS_CLIENT_TIMEOUT_MS / 1000;
+    send_timeout.tv_usec = (METRICS_CLIENT_TIMEOUT_MS % 1000) * 1000;
+#endif
+    
+    /* A send() that cannot make progress returns an error instead of blocking */
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char *)&send_timeout, sizeof(send_timeout));
+    
+    while (used < sizeof(request) - 1) {
+        remaining_ns = deadline_ns - get_time_ns();
+        if (remaining_ns <= 0) {
+            return;
+        }
+        FD_ZERO(&readable);
+        FD_SET(client, &readable);
+        timeout.tv_sec = (long)(remaining_ns / 1000000000LL);
+        timeout.tv_usec = (long)(remaining_ns % 1000000000LL / 1000);
+        if (select((int)client + 1, &readable, NULL, NULL, &timeout) <= 0) {
+            return;
+        }
+        result = (int)recv(client, request + used, (int)(sizeof(request) - 1 - used), 0);
+        if (result <= 0) {
+            return;
+        }
+        used += (size_t)result;
+        request[used] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            break;
+        }
+    }
+    request[used] = '\0';
+    
+    body_len = strlen(body);
+    if (strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?')) {
+        exporter->scrapes++;
+        render_metrics(exporter, get_time_ns());
+        status = "200 OK";
+        body = exporter->buffer;
+        body_len = exporter->length;
+    }
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             "Content-Length: %lu\r\nConnection: close\r\n\r\n", status, (unsigned long)body_len);
+    
+    if (send(client, header, (int)strlen(header), 0) != (int)strlen(header)) {
+        return;
+    }
+    for (sent = 0; sent < body_len; sent += (size_t)result) {
+        if (get_time_ns() >= deadline_ns) {
+            return;
+        }
+        result = (int)send(client, body + sent, (int)(body_len - sent), 0);
+        if (result <= 0) {
+            return;
+        }
+    }
+}
+
+/*
+ * Rewrite the textfile collector file: write a temporary file next to it
+ * and rename it over the old one, so a reader never sees a partial file
+ */
+static void write_metrics_textfile(MetricsExporter *exporter) {
+    const char *path = exporter->config->metrics_textfile;
+    char temp_path[MAX_VALUE_LENGTH + 8];
+    FILE *file;
+    int failed;
+    
+    render_metrics(exporter, get_time_ns());
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    file = fopen(temp_path, "wb");
+    failed = !file;
+    if (file) {
+        failed = fwrite(exporter->buffer, 1, exporter->length, file) != exporter->length;
+        failed = fclose(file) != 0 || failed;
+    }
+#ifdef _WIN32
+    failed = failed || !MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    failed = failed || rename(temp_path, path) != 0;
+#endif
+    
+    /* Warn once per failure streak, not on every rewrite */
+    if (failed && !exporter->textfile_failing) {
+        log_message(1, "WARNING", "Failed to write metrics to %s", path);
+    }
+    exporter->textfile_failing = failed;
+}
+
+/*
+ * Render the full exposition text into the exporter's buffer
+ */
+static void render_metrics(MetricsExporter *exporter, int64_t now_ns) {
+    const char *mode;
+    
+    /* Either detach_metrics() waits for this flag or the run is seen withdrawn */
+    ATOMIC_STORE_SEQ_CST(&exporter->rendering, 1);
+    mode = ATOMIC_LOAD_SEQ_CST(&exporter->mode);
+    exporter->length = 0;
+    metrics_family(exporter, "kafka_cli_info", "gauge", "Tool and librdkafka version, configured topic");
+    metrics_append(exporter, "kafka_cli_info{version=\"%s\",librdkafka=\"%s\",topic=\"",
+                   VERSION, rd_kafka_version_str());
+    metrics_append_label(exporter, exporter->config->topic);
+    metrics_append(exporter, "\"} 1\n");
+    render_metric(exporter, "kafka_cli_uptime_seconds", "gauge", "Time since the exporter started",
+                  (double)(now_ns - exporter->start_ns) / 1e9);
+    render_metric(exporter, "kafka_cli_runs_total", "counter", "Producer and consumer runs started",
+                  (double)ATOMIC_LOAD(&exporter->runs));
+    render_metric(exporter, "kafka_cli_run_active", "gauge", "1 while a producer or consumer run is attached",
+                  mode ? 1.0 : 0.0);
+    render_metric(exporter, "kafka_cli_metrics_scrapes_total", "counter", "HTTP scrapes answered",
+                  (double)exporter->scrapes);
+    if (mode) {
+        /* Counters restart with every run, which Prometheus treats as a reset */
+        render_metric(exporter, "kafka_cli_run_seconds", "gauge", "Time since the current run started",
+                      (double)(now_ns - exporter->attach_ns) / 1e9);
+        if (exporter->workers) {
+            render_producer_metrics(exporter);
+        } else {
+            render_consumer_metrics(exporter, now_ns);
+        }
+        if (exporter->config->statistics_interval_ms > 0) {
+            render_client_metrics(exporter);
+        }
+    }
+    ATOMIC_STORE_RELEASE(&exporter->rendering, 0);
+}
+
+/*
+ * Producer counters, ack latency and per-partition deliveries
+ */
+static void render_producer_metrics(MetricsExporter *exporter) {
+    ProducerStats *stats = exporter->producer_stats;
+    rd_kafka_t *rk;
+    long long queued = 0;
+    int i;
+    
+    collect_producer_stats(stats, exporter->workers, exporter->worker_count);
+    for (i = 0; i < exporter->worker_count; i++) {
+        if ((rk = metrics_handle(exporter, i)) != NULL) {
+            queued += rd_kafka_outq_len(rk);
+        }
+    }
+    
+    render_metric(exporter, "kafka_cli_produced_messages_total", "counter",
+                  "Messages handed to librdkafka", (double)stats->produced);
+    render_metric(exporter, "kafka_cli_delivered_messages_total", "counter",
+                  "Messages acknowledged by the broker", (double)stats->delivered);
+    render_metric(exporter, "kafka_cli_delivered_bytes_total", "counter",
+                  "Payload bytes acknowledged by the broker", (double)stats->bytes_delivered);
+    render_metric(exporter, "kafka_cli_delivery_failures_total", "counter",
+                  "Messages whose delivery report carried an error", (double)stats->failed);
+    render_metric(exporter, "kafka_cli_dropped_messages_total", "counter",
+                  "Messages dropped by the queue full policy", (double)stats->dropped);
+    render_metric(exporter, "kafka_cli_produce_errors_total", "counter",
+                  "Messages rejected by rd_kafka_produce()", (double)stats->produce_errors);
+    render_metric(exporter, "kafka_cli_queue_full_stall_seconds_total", "counter",
+                  "Time producer threads waited on a full librdkafka queue",
+                  (double)stats->queue_full_stall_ns / 1e9);
+    render_metric(exporter, "kafka_cli_producer_queue_messages", "gauge",
+                  "Messages and requests waiting in librdkafka queues", (double)queued);
+    render_histogram(exporter, "kafka_cli_ack_latency_seconds", "Produce call to delivery report",
+                     &stats->ack_latency);
+    if (exporter->config->producer_rate_msgs > 0 || exporter->config->producer_rate_mb > 0.0) {
+        render_histogram(exporter, "kafka_cli_intended_latency_seconds",
+                         "Scheduled send time to delivery report (paced runs)", &stats->intended_latency);
+    }
+    
+    metrics_family(exporter, "kafka_cli_partition_delivered_messages_total", "counter",
+                   "Messages acknowledged per partition");
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (stats->partition_messages[i] > 0) {
+            metrics_append(exporter, "kafka_cli_partition_delivered_messages_total{partition=\"%d\"} %lld\n",
+                           i, stats->partition_messages[i]);
+        }
+    }
+}
+
+/*
+ * Consumer counters, end-to-end latency and lag of the assigned partitions
+ */
+static void render_consumer_metrics(MetricsExporter *exporter, int64_t now_ns) {
+    ConsumerStats *stats = exporter->consumer_stats;
+    ConsumerLag *lag = exporter->lag;
+    long long consumed;
+    int i;
+    
+    render_metric(exporter, "kafka_cli_consumed_messages_total", "counter", "Messages consumed",
+                  (double)ATOMIC_LOAD(&stats->consumed));
+    render_metric(exporter, "kafka_cli_consumed_bytes_total", "counter", "Payload bytes consumed",
+                  (double)ATOMIC_LOAD(&stats->bytes));
+    render_metric(exporter, "kafka_cli_consumer_errors_total", "counter",
+                  "Consumer errors other than partition EOF", (double)ATOMIC_LOAD(&stats->errors));
+    render_histogram(exporter, "kafka_cli_e2e_latency_seconds", "Producer send time to consumer receive",
+                     &stats->e2e_latency);
+    
+    metrics_family(exporter, "kafka_cli_partition_consumed_messages_total", "counter",
+                   "Messages consumed per partition");
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        consumed = ATOMIC_LOAD(&stats->partition_consumed[i]);
+        if (consumed > 0) {
+            metrics_append(exporter, "kafka_cli_partition_consumed_messages_total{partition=\"%d\"} %lld\n",
+                           i, consumed);
+        }
+    }
+    
+    /* Positions and cached watermarks only: no broker round trip per scrape */
+    if (update_consumer_lag(exporter->rk, lag, now_ns) != 0) {
+        return;
+    }
+    render_metric(exporter, "kafka_cli_consumer_assigned_partitions", "gauge", "Partitions currently assigned",
+                  (double)lag->partitions);
+    metrics_family(exporter, "kafka_cli_consumer_lag_messages", "gauge",
+                   "High watermark minus consumer position per assigned partition");
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (lag->assigned[i] && lag->lag[i] >= 0) {
+            metrics_append(exporter, "kafka_cli_consumer_lag_messages{partition=\"%d\"} %lld\n",
+                           i, (long long)lag->lag[i]);
+        }
+    }
+}
+
+/*
+ * Key fields of the latest librdkafka statistics report of every handle
+ */
+static void render_client_metrics(MetricsExporter *exporter) {
+    static const struct {
+        const char *name;
+        const char *help;
+        size_t offset;
+        double scale;
+    } broker_metrics[] = {
+        { "kafka_cli_rdkafka_broker_rtt_avg_seconds", "Average request round trip time",
+          offsetof(BrokerStatistics, rtt_avg_us), 1e-6 },
+        { "kafka_cli_rdkafka_broker_rtt_p99_seconds", "99th percentile request round trip time",
+          offsetof(BrokerStatistics, rtt_p99_us), 1e-6 },
+        { "kafka_cli_rdkafka_broker_throttle_avg_seconds", "Average broker throttle time",
+          offsetof(BrokerStatistics, throttle_avg_ms), 1e-3 },
+        { "kafka_cli_rdkafka_broker_outbuf_requests", "Requests waiting to be sent",
+          offsetof(BrokerStatistics, outbuf_cnt), 1.0 },
+        { "kafka_cli_rdkafka_broker_inflight_requests", "Requests sent and awaiting a response",
+          offsetof(BrokerStatistics, waitresp_cnt), 1.0 }
+    };
+    int producer = exporter->workers != NULL;
+    int handle_count = producer ? exporter->worker_count : 1;
+    const ClientStatistics *stats;
+    const BrokerStatistics *broker;
+    rd_kafka_t *rk;
+    int metric, handle, i, count;
+    
+    /* Every family's samples must follow its own HELP and TYPE lines */
+    metrics_family(exporter, "kafka_cli_rdkafka_tx_bytes_total", "counter", "Bytes sent to brokers");
+    for (handle = 0; handle < handle_count; handle++) {
+        if ((rk = metrics_handle(exporter, handle)) != NULL) {
+            stats = &((ClientContext *)rd_kafka_opaque(rk))->statistics;
+            metrics_append(exporter, "kafka_cli_rdkafka_tx_bytes_total{handle=\"%d\"} %lld\n",
+                           handle, (long long)ATOMIC_LOAD(&stats->tx_bytes));
+        }
+    }
+    metrics_family(exporter, "kafka_cli_rdkafka_rx_bytes_total", "counter", "Bytes received from brokers");
+    for (handle = 0; handle < handle_count; handle++) {
+        if ((rk = metrics_handle(exporter, handle)) != NULL) {
+            stats = &((ClientContext *)rd_kafka_opaque(rk))->statistics;
+            metrics_append(exporter, "kafka_cli_rdkafka_rx_bytes_total{handle=\"%d\"} %lld\n",
+                           handle, (long long)ATOMIC_LOAD(&stats->rx_bytes));
+        }
+    }
+    
+    for (metric = 0; metric < (int)(sizeof(broker_metrics) / sizeof(broker_metrics[0])); metric++) {
+        metrics_family(exporter, broker_metrics[metric].name, "gauge", broker_metrics[metric].help);
+        for (handle = 0; handle < handle_count; handle++) {
+            if ((rk = metrics_handle(exporter, handle)) == NULL) {
+                continue;
+            }
+            stats = &((ClientContext *)rd_kafka_opaque(rk))->statistics;
+            count = ATOMIC_LOAD_ACQUIRE(&stats->broker_count);
+            for (i = 0; i < count; i++) {
+                broker = &stats->brokers[i];
+                if (ATOMIC_LOAD(&broker->nodeid) < 0) {
+                    continue;
+                }
+                metrics_append(exporter, "%s{handle=\"%d\",broker=\"", broker_metrics[metric].name, handle);
+                metrics_append_label(exporter, broker->name);
+                metrics_append(exporter, "\"} %.15g\n", broker_metrics[metric].scale *
+                               (double)ATOMIC_LOAD((const int64_t *)((const char *)broker +
+                                                                      broker_metrics[metric].offset)));
+            }
+        }
+    }
+    
+    /* Producer: messages not yet sent; consumer: fetched but not yet consumed */
+    metrics_family(exporter, "kafka_cli_rdkafka_partition_queued_messages", "gauge",
+                   producer ? "Messages waiting to be sent per partition" :
+                   "Messages fetched but not yet consumed per partition");
+    for (handle = 0; handle < handle_count; handle++) {
+        if ((rk = metrics_handle(exporter, handle)) == NULL) {
+            continue;
+        }
+        stats = &((ClientContext *)rd_kafka_opaque(rk))->statistics;
+        count = ATOMIC_LOAD_ACQUIRE(&stats->partition_count);
+        for (i = 0; i < count && i < MAX_TRACKED_PARTITIONS; i++) {
+            metrics_append(exporter, "kafka_cli_rdkafka_partition_queued_messages{handle=\"%d\",partition=\"%d\"} %lld\n",
+                           handle, i, (long long)(producer ? ATOMIC_LOAD(&stats->partitions[i].msgq_cnt) :
+                                                  ATOMIC_LOAD(&stats->partitions[i].fetchq_cnt)));
+        }
+    }
+}
+
+/*
+ * Histogram with cumulative buckets at metrics_bucket_seconds. Bucket edges
+ * and the sum come from the recording histogram, so both carry its ~1.5%
+ * resolution.
+ */
+static void render_histogram(MetricsExporter *exporter, const char *name, const char *help,
+                             const LatencyHistogram *hist) {
+    int bound_count = (int)(sizeof(metrics_bucket_seconds) / sizeof(metrics_bucket_seconds[0]));
+    int64_t cumulative = 0, count, value;
+    double sum = 0.0;
+    int i, bound = 0;
+    
+    metrics_family(exporter, name, "histogram", help);
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        count = ATOMIC_LOAD(&hist->counts[i]);
+        if (count == 0) {
+            continue;
+        }
+        value = hist_bucket_value(i);
+        while (bound < bound_count && (double)value > metrics_bucket_seconds[bound] * 1e9) {
+            metrics_append(exporter, "%s_bucket{le=\"%g\"} %lld\n", name, metrics_bucket_seconds[bound],
+                           (long long)cumulative);
+            bound++;
+        }
+        cumulative += count;
+        sum += (double)count * (double)value;
+    }
+    for (; bound < bound_count; bound++) {
+        metrics_append(exporter, "%s_bucket{le=\"%g\"} %lld\n", name, metrics_bucket_seconds[bound],
+                       (long long)cumulative);
+    }
+    metrics_append(exporter, "%s_bucket{le=\"+Inf\"} %lld\n", name, (long long)cumulative);
+    metrics_append(exporter, "%s_sum %.9f\n", name, sum / 1e9);
+    metrics_append(exporter, "%s_count %lld\n", name, (long long)cumulative);
+}
+
+/*
+ * One unlabelled sample with its HELP and TYPE lines
+ */
+static void render_metric(MetricsExporter *exporter, const char *name, const char *type, const char *help,
+                          double value) {
+    metrics_family(exporter, name, type, help);
+    metrics_append(exporter, "%s %.15g\n", name, value);
+}
+
+/*
+ * HELP and TYPE lines that open a metric family
+ */
+static void metrics_family(MetricsExporter *exporter, const char *name, const char *type, const char *help) {
+    metrics_append(exporter, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/*
+ * Append formatted text to the exporter buffer, growing it as needed. If
+ * memory runs out the text is cut short rather than failing the scrape.
+ */
+static void metrics_append(MetricsExporter *exporter, const char *format, ...) {
+    va_list args;
+    size_t capacity;
+    char *buffer;
+    int written;
+    
+    for (;;) {
+        va_start(args, format);
+        written = vsnprintf(exporter->buffer + exporter->length, exporter->capacity - exporter->length,
+                            format, args);
+        va_end(args);
+        if (written < 0) {
+            return;
+        }
+        if ((size_t)written < exporter->capacity - exporter->length) {
+            exporter->length += (size_t)written;
+            return;
+        }
+        
+        capacity = exporter->capacity * 2;
+        while (capacity <= exporter->length + (size_t)written) {
+            capacity *= 2;
+        }
+        buffer = (char *)realloc(exporter->buffer, capacity);
+        if (!buffer) {
+            exporter->buffer[exporter->length] = '\0';
+            return;
+        }
+        exporter->buffer = buffer;
+        exporter->capacity = capacity;
+    }
+}
+
+/*
+ * Append a label value with backslash, quote and newline escaped
+ */
+static void metrics_append_label(MetricsExporter *exporter, const char *value) {
+    char escaped[MAX_VALUE_LENGTH * 2];
+    size_t used = 0;
+    
+    for (; *value && used < sizeof(escaped) - 2; value++) {
+        if (*value == '\\' || *value == '"') {
+            escaped[used++] = '\\';
+            escaped[used++] = *value;
+        } else if (*value == '\n') {
+            escaped[used++] = '\\';
+            escaped[used++] = 'n';
+        } else {
+            escaped[used++] = *value;
+        }
+    }
+    escaped[used] = '\0';
+    metrics_append(exporter, "%s", escaped);
+}
+
+/*
+ * Producer handle of worker index, NULL if it is shared and was already
+ * reported under a lower index; the consumer handle for index 0
+ */
+static rd_kafka_t *metrics_handle(const MetricsExporter *exporter, int index) {
+    if (!exporter->workers) {
+        return index == 0 ? exporter->rk : NULL;
+    }
+    if (!exporter->workers[index].rk || (index > 0 && exporter->workers[index].rk == exporter->shared_rk)) {
+        return NULL;
+    }
+    return exporter->workers[index].rk;
+}
+
+/*
+ * Sanitize topic name for use in filename
+ * Replaces special characters with underscores
+ */
+static void sanitize_filename(char *dst, const char *src, size_t size) {
+    size_t i, j;
+    for (i = 0, j = 0; src[i] != '\0' && j < size - 1; i++) {
+        char c = src[i];
+        /* Allow alphanumeric, hyphen, underscore */
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || 
+            (c >= '0' && c <= '9') || c == '-' || c == '_') {
+            dst[j++] = c;
+        } else {
+            dst[j++] = '_';
+        }
+    }
+    dst[j] = '\0';
+}
+
+/*
+ * Initialize log file
+ * Creates logs directory and opens file with naming: topic-name_mode_datetime.log
+ */
+static void init_log_file(const char *topic, const char *mode) {
+    time_t now;
+    struct tm *timeinfo;
+    char datetime[64];
+    char sanitized_topic[256];
+    char filename[sizeof(sanitized_topic) + 32 + sizeof(datetime) + 8]; /* Topic, command, datetime */
+    char filepath[sizeof(LOGS_DIR) + sizeof(filename)];
+    
+    /* Create logs directory if it doesn't exist */
+#ifdef _WIN32
+    CreateDirectory(LOGS_DIR, NULL);
+#else
+    mkdir(LOGS_DIR, 0755);
+#endif
+    
+    /* Get current datetime */
+    time(&now);
+    timeinfo = localtime(&now);
+    strftime(datetime, sizeof(datetime), "%Y%m%d_%H%M%S", timeinfo);
+    
+    /* Sanitize topic name for filename */
+    sanitize_filename(sanitized_topic, topic, sizeof(sanitized_topic));
+    
+    /* Create filename: topic-name_mode_datetime.log */
+    snprintf(filename, sizeof(filename), "%s_%s_%s.log", sanitized_topic, mode, datetime);
+    
+    /* Full path */
+#ifdef _WIN32
+    snprintf(filepath, sizeof(filepath), "%s\\%s", LOGS_DIR, filename);
+#else
+    snprintf(filepath, sizeof(filepath), "%s/%s", LOGS_DIR, filename);
+#endif
+    
+    /* Open log file */
+    strcpy(log_file_path, filepath);
+    log_file = fopen(filepath, "w");
+    if (log_file) {
+        fprintf(log_file, "Kafka CLI Tool Log\n");
+        fprintf(log_file, "==================\n");
+        fprintf(log_file, "Topic: %s\n", topic);
+        fprintf(log_file, "Mode: %s\n", mode);
+        fprintf(log_file, "Started: %s\n", datetime);
+        fprintf(log_file, "==================\n\n");
+        fflush(log_file);
+    }
+    
+    start_logger();
+}
+
+/*
+ * Close log file
+ */
+static void close_log_file(void) {
+    stop_metrics_exporter();
+    stop_stats_parser();
+    stop_logger();
+    
+    if (log_file) {
+        time_t now;
+        struct tm *timeinfo;
+        char datetime[64];
+        
+        time(&now);
+        timeinfo = localtime(&now);
+        strftime(datetime, sizeof(datetime), "%Y-%m-%d %H:%M:%S", timeinfo);
+        
+        fprintf(log_file, "\n==================\n");
+        fprintf(log_file, "Finished: %s\n", datetime);
+        fprintf(log_file, "==================\n");
+        
+        fclose(log_file);
+        log_file = NULL;
+    }
+}
+
+/*
+ * Print usage information
+ */
+static void print_usage(const char *program) {
+    printf("Usage: %s [options] <command>\n\n", program);
+    printf("Commands:\n");
+    printf("  produce      Run as producer\n");
+    printf("  consume      Run as consumer\n");
+    printf("  codec-bench  Run the producer workload once per compression codec\n");
+    printf("  sweep        Run the producer over a grid of batch/linger/acks settings\n");
+    printf("  export       Write all messages between two timestamps to one file per partition\n");
+    printf("  group-scale  Run several consumers of one group in this process and measure scaling\n");
+    printf("  mock-bench   Run fixed benchmark scenarios against an in-process mock cluster\n");
+    printf("  compare <baseline.json> <current.json> [threshold%%]\n");
+    printf("               Compare two result files, exit code 1 on regressions (default 5%%)\n");
+    printf("\nOptions:\n");
+    printf("  -c <file>  Configuration file (default: %s)\n", DEFAULT_INI_FILE);
+    printf("  -m <num>   Number of messages to produce/consume (default: from config)\n");
+    printf("  -r <rate>  Target producer rate in messages/sec, 0 = unlimited (default: from config)\n");
+    printf("  -q         Quiet consumer: counters and progress only, no per-message output\n");
+    printf("  -d         Live dashboard redrawn in place (log lines go to the log file)\n");
+    printf("  -v         Enable verbose logging\n");
+    printf("  -V         Show version\n");
+    printf("  -h         Show this help\n");
+    printf("\nTUI Mode:\n");
+    printf("  Run without arguments to launch interactive menu\n");
+    printf("\nExamples:\n");
+    printf("  %s                    # Launch TUI menu\n", program);
+    printf("  %s -c config.ini produce\n", program);
+    printf("  %s -v -m 100 consume\n", program);
+    printf("  %s -q consume\n", program);
+    printf("  %s -d -q consume\n", program);
+    printf("  %s -m 100000 -r 5000 produce\n", program);
+    printf("  %s -m 200000 codec-bench\n", program);
+    printf("  %s -r 50000 sweep\n", program);
+    printf("  %s -c export.ini export\n", program);
+    printf("  %s -c group.ini group-scale\n", program);
+    printf("  %s mock-bench\n", program);
+    printf("  %s compare results/baseline.json results/current.json 10\n", program);
+}
+
+/*
+ * Print version information
+ */
+static void print_version(void) {
+    printf("Kafka CLI Tool v%s\n", VERSION);
+    printf("Built with librdkafka %s\n", rd_kafka_version_str());
+}
+
+/*
+ * Logging function with timestamp and verbosity control
+ * Also writes to log file if initialized
+ */
+static void log_message(int verbose, const char *level, const char *format, ...) {
+    va_list args;
+    char text[LOG_RECORD_LENGTH];
+    
+    if (!verbose && strcmp(level, "DEBUG") == 0) {
+        return;
+    }
+    
+    /* Hand off to the writer thread when it runs; once stop_logger() has closed the gate, drop */
+    if (ATOMIC_LOAD_ACQUIRE(&async_logger.running)) {
+        if (ATOMIC_ADD(&async_logger.gate, 1) & LOG_GATE_CLOSED) {
+            ATOMIC_ADD(&async_logger.gate, -1);
+            ATOMIC_ADD(&async_logger.dropped, 1);
+            return;
+        }
+        va_start(args, format);
+        log_enqueue(level, format, args);
+        va_end(args);
+        /* Release: the record is published before stop_logger() sees the gate empty */
+        ATOMIC_ADD_RELEASE(&async_logger.gate, -1);
+        return;
+    }
+    
+    /* Before start_logger() and after stop_logger(): write synchronously */
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    log_write_line((int64_t)time(NULL), level, text);
+    fflush(stdout);
+    if (log_file) {
+        fflush(log_file);
+    }
+}
+
+/*
+ * Format a record into the next free ring cell
+ * Records are dropped (and counted) when the ring is full: the caller may
+ * be a produce path or a delivery report callback, which must not wait
+ * Returns 1 if the record was queued
+ */
+static int log_enqueue(const char *level, const char *format, va_list args) {
+    LogRecord *record;
+    uint64_t pos = ATOMIC_LOAD(&async_logger.enqueue_pos);
+    int64_t diff;
+    int len;
+    
+    for (;;) {
+        record = &async_logger.records[pos & (LOG_RING_SIZE - 1)];
+        diff = (int64_t)ATOMIC_LOAD_ACQUIRE(&record->sequence) - (int64_t)pos;
+        if (diff == 0) {
+            if (ATOMIC_CAS(&async_logger.enqueue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            ATOMIC_ADD(&async_logger.dropped, 1);
+            return 0;
+        } else {
+            pos = ATOMIC_LOAD(&async_logger.enqueue_pos);
+        }
+    }
+    
+    record->time_sec = (int64_t)time(NULL);
+    record->level = level;
+    len = vsnprintf(record->text, sizeof(record->text), format, args);
+    if (len >= (int)sizeof(record->text)) {
+        memcpy(record->text + sizeof(record->text) - 4, "...", 4);
+    }
+    ATOMIC_STORE_RELEASE(&record->sequence, pos + 1);
+    return 1;
+}
+
+/*
+ * Write one line to the console and the log file (buffered, no flush);
+ * the timestamp string is rebuilt only when the second changes
+ */
+static void log_write_line(int64_t time_sec, const char *level, const char *text) {
+    if (time_sec != async_logger.cached_sec) {
+        time_t now = (time_t)time_sec;
+        strftime(async_logger.cached_timestamp, sizeof(async_logger.cached_timestamp),
+                 "%Y-%m-%d %H:%M:%S", localtime(&now));
+        async_logger.cached_sec = time_sec;
+    }
+    
+    if (!ATOMIC_LOAD_ACQUIRE(&async_logger.console_muted)) {
+        printf("[%s] [%s] %s\n", async_logger.cached_timestamp, level, text);
+    } else if (strcmp(level, "WARNING") == 0 || strcmp(level, "ERROR") == 0) {
+        ATOMIC_ADD(&async_logger.muted_warnings, 1);
+    }
+    if (log_file) {
+        fprintf(log_file, "[%s] [%s] %s\n", async_logger.cached_timestamp, level, text);
+    }
+}
+
+/*
+ * Write out every queued record, then flush once
+ * Returns the number of records written
+ */
+static int log_drain(void) {
+    LogRecord *record;
+    int count = 0;
+    
+    for (;;) {
+        record = &async_logger.records[async_logger.dequeue_pos & (LOG_RING_SIZE - 1)];
+        if (ATOMIC_LOAD_ACQUIRE(&record->sequence) != async_logger.dequeue_pos + 1) {
+            break;
+        }
+        log_write_line(record->time_sec, record->level, record->text);
+        ATOMIC_STORE_RELEASE(&record->sequence, async_logger.dequeue_pos + LOG_RING_SIZE);
+        async_logger.dequeue_pos++;
+        count++;
+    }
+    
+    if (count > 0) {
+        fflush(stdout);
+        if (log_file) {
+            fflush(log_file);
+        }
+    }
+    return count;
+}
+
+/*
+ * Logger thread: drains the ring until stop_logger() sets the stopping flag
+ */
+static thread_ret_t THREAD_CALL log_writer_main(void *arg) {
+    long long reported_dropped = 0, dropped;
+    int64_t reported_sec = 0, now_sec;
+    
+    (void)arg;
+    
+    while (!ATOMIC_LOAD_ACQUIRE(&async_logger.stopping)) {
+        if (log_drain() == 0) {
+            sleep_ms(2);
+        }
+        
+        /* At most one drop warning per second */
+        dropped = ATOMIC_LOAD(&async_logger.dropped);
+        now_sec = (int64_t)time(NULL);
+        if (dropped != reported_dropped && now_sec != reported_sec) {
+            char text[128];
+            snprintf(text, sizeof(text), "Logger dropped %lld records (ring buffer full)",
+                     dropped - reported_dropped);
+            log_write_line(now_sec, "WARNING", text);
+            reported_dropped = dropped;
+            reported_sec = now_sec;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Start the background log writer; until then log_message() writes directly
+ */
+static void start_logger(void) {
+    uint64_t i;
+    
+    if (ATOMIC_LOAD(&async_logger.running)) {
+        return;
+    }
+    for (i = 0; i < LOG_RING_SIZE; i++) {
+        async_logger.records[i].sequence = i;
+    }
+    async_logger.enqueue_pos = 0;
+    async_logger.dequeue_pos = 0;
+    async_logger.cached_sec = -1;
+    async_logger.stopping = 0;
+    async_logger.gate = 0;
+    ATOMIC_STORE_RELEASE(&async_logger.running, 1);
+    if (thread_create(&async_logger.thread, log_writer_main, NULL) != 0) {
+        ATOMIC_STORE_RELEASE(&async_logger.running, 0);
+    }
+}
+
+/*
+ * Stop the log writer after it has written everything queued so far.
+ * Records logged by other threads from now until the writer is gone are
+ * dropped and counted, so nothing writes to the console beside it.
+ */
+static void stop_logger(void) {
+    if (!ATOMIC_LOAD(&async_logger.running)) {
+        return;
+    }
+    
+    /* Accept no new records, and let records already claimed be published */
+    ATOMIC_ADD(&async_logger.gate, LOG_GATE_CLOSED);
+    while (ATOMIC_LOAD_ACQUIRE(&async_logger.gate) != LOG_GATE_CLOSED) {
+        sleep_ms(1);
+    }
+    
+    ATOMIC_STORE_RELEASE(&async_logger.stopping, 1);
+    thread_join(async_logger.thread);
+    log_drain();
+    ATOMIC_STORE_RELEASE(&async_logger.running, 0);
+    if (async_logger.dropped > 0) {
+        log_message(1, "INFO", "Logger dropped %lld records in total", async_logger.dropped);
+    }
+}
+
+/*
+ * Trim whitespace from string
+ */
+static char* trim_whitespace(char *str) {
+    char *end;
+    
+    while (isspace((unsigned char)*str)) str++;
+    
+    if (*str == 0) return str;
+    
+    end = str + strlen(str) - 1;
+    while (end > str && isspace((unsigned char)*end)) end--;
+    
+    end[1] = '\0';
+    return str;
+}
+
+/*
+ * Parse INI configuration file
+ */
+static int parse_ini_file(const char *filename, Config *config) {
+    FILE *file;
+    char line[MAX_LINE_LENGTH];
+    char *key, *value;
+    char *delimiter;
+    
+    /* Set defaults */
+    strcpy(config->brokers, "localhost:9092");
+    strcpy(config->topic, "test-topic");
+    strcpy(config->security_protocol, "SSL");
+    strcpy(config->ssl_ca_location, "");
+    strcpy(config->ssl_certificate_location, "");
+    strcpy(config->ssl_key_location, "");
+    strcpy(config->ssl_key_password, "");
+    config->ssl_skip_certificate_verify = 0;
+    config->producer_batch_size = 16384;
+    config->producer_linger_ms = 5;
+    config->producer_ack = 1;
+    config->producer_id = 0;
+    config->producer_queue_max_messages = 0;
+    config->producer_queue_max_kbytes = 0;
+    config->producer_queue_full_policy = QUEUE_FULL_BLOCK;
+    config->producer_queue_full_retries = 100;
+    strcpy(config->compression_codec, "none");
+    config->compression_level = -1;
+    config->statistics_interval_ms = 0;
+    strcpy(config->codec_bench_codecs, "none,gzip,snappy,lz4,zstd");
+    config->producer_max_in_flight = 0;
+    config->producer_duration_sec = 0;
+    config->sweep_batch_size[0] = '\0';
+    config->sweep_linger_ms[0] = '\0';
+    config->sweep_acks[0] = '\0';
+    config->sweep_message_size[0] = '\0';
+    config->sweep_max_in_flight[0] = '\0';
+    config->sweep_duration_sec = 10;
+    config->sweep_latency_budget_ms = 100.0;
+    config->sweep_latency_percentile = 99.0;
+    config->export_start_time[0] = '\0';
+    config->export_end_time[0] = '\0';
+    strcpy(config->export_output_dir, "export");
+    config->export_threads = 4;
+    config->group_members = 4;
+    config->group_scale_schedule[0] = '\0';
+    config->group_duration_sec = 60;
+    config->mock_bench_brokers = 3;
+    config->mock_bench_duration_sec = 5;
+    config->mock_bench_scenarios[0] = '\0';
+    config->producer_threads = 1;
+    config->producer_shared_handle = 0;
+    config->producer_message_size = 100;
+    config->producer_payload_count = 10000;
+    config->payload_size_distribution = PAYLOAD_SIZE_FIXED;
+    config->payload_size_min = 64;
+    config->payload_size_max = 4096;
+    config->payload_size_stddev = 0;
+    config->payload_bimodal_large_pct = 10;
+    config->payload_content = PAYLOAD_CONTENT_TEXT;
+    config->payload_compressibility = 50;
+    config->key_distribution = KEY_DIST_NONE;
+    config->key_space = 1000;
+    config->key_zipf_exponent = 1.0;
+    config->producer_partitioner[0] = '\0';
+    config->producer_rate_msgs = 0;
+    config->producer_rate_mb = 0.0;
+    strcpy(config->consumer_group_id, "kafka-cli-consumer");
+    strcpy(config->consumer_auto_offset_reset, "earliest");
+    config->consumer_session_timeout_ms = 45000;
+    strcpy(config->consumer_enable_auto_commit, "true");
+    config->consumer_assign[0] = '\0';
+    config->consumer_assignment_strategy[0] = '\0';
+    config->consumer_rebalance_churn_sec = 0;
+    config->consumer_quiet = 0;
+    config->consumer_batch_size = 1;
+    config->consumer_workers = 0;
+    config->consumer_dispatch = DISPATCH_PARTITION;
+    config->consumer_worker_queue_size = 10000;
+    config->consumer_work_us = 0;
+    config->consumer_commit_policy = COMMIT_NONE;
+    config->consumer_commit_every_messages = 1000;
+    config->consumer_commit_interval_ms = 5000;
+    config->consumer_sample_every = 0;
+    config->consumer_sample_per_sec = 0;
+    config->verbose = 0;
+    config->message_count = 10;
+    config->report_interval_sec = 5;
+    config->dashboard = 0;
+    config->dashboard_refresh_ms = 500;
+    strcpy(config->result_dir, RESULTS_DIR);
+    config->metrics_port = 0;
+    strcpy(config->metrics_bind, "127.0.0.1");
+    config->metrics_textfile[0] = '\0';
+    config->metrics_textfile_interval_ms = 5000;
+    
+    file = fopen(filename, "r");
+    if (!file) {
+        log_message(1, "WARNING", "Cannot open config file '%s', using defaults", filename);
+        return 0;
+    }
+    
+    log_message(1, "INFO", "Loading configuration from: %s", filename);
+    
+    while (fgets(line, sizeof(line), file)) {
+        /* Remove comments */
+        char *comment = strchr(line, ';');
+        if (comment) *comment = '\0';
+        comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        
+        /* Trim whitespace */
+        char *trimmed = trim_whitespace(line);
+        if (strlen(trimmed) == 0) continue;
+        
+        /* Skip section headers */
+        if (trimmed[0] == '[') continue;
+        
+        /* Find key-value delimiter */
+        delimiter = strchr(trimmed, '=');
+        if (!delimiter) continue;
+        
+        *delimiter = '\0';
+        key = trim_whitespace(trimmed);
+        value = trim_whitespace(delimiter + 1);
+        
+        /* Parse configuration values */
+        if (strcmp(key, "brokers") == 0) {
+            strncpy(config->brokers, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "topic") == 0) {
+            strncpy(config->topic, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "security_protocol") == 0) {
+            strncpy(config->security_protocol, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "ssl_ca_location") == 0) {
+            strncpy(config->ssl_ca_location, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "ssl_certificate_location") == 0) {
+            strncpy(config->ssl_certificate_location, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "ssl_key_location") == 0) {
+            strncpy(config->ssl_key_location, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "ssl_key_password") == 0) {
+            strncpy(config->ssl_key_password, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "ssl_skip_certificate_verify") == 0) {
+            config->ssl_skip_certificate_verify = atoi(value);
+        } else if (strcmp(key, "producer_batch_size") == 0) {
+            config->producer_batch_size = atoi(value);
+        } else if (strcmp(key, "producer_linger_ms") == 0) {
+            config->producer_linger_ms = atoi(value);
+        } else if (strcmp(key, "producer_ack") == 0) {
+            config->producer_ack = atoi(value);
+        } else if (strcmp(key, "producer_id") == 0) {
+            config->producer_id = atoi(value);
+        } else if (strcmp(key, "producer_queue_max_messages") == 0) {
+            config->producer_queue_max_messages = atoi(value);
+        } else if (strcmp(key, "producer_queue_max_kbytes") == 0) {
+            config->producer_queue_max_kbytes = atoi(value);
+        } else if (strcmp(key, "producer_queue_full_policy") == 0) {
+            int policy;
+            for (policy = 0; policy < QUEUE_FULL_POLICY_COUNT; policy++) {
+                if (strcmp(value, queue_full_policy_names[policy]) == 0) break;
+            }
+            if (policy == QUEUE_FULL_POLICY_COUNT) {
+                log_message(1, "WARNING", "Unknown producer_queue_full_policy '%s', using block", value);
+                policy = QUEUE_FULL_BLOCK;
+            }
+            config->producer_queue_full_policy = policy;
+        } else if (strcmp(key, "producer_queue_full_retries") == 0) {
+            config->producer_queue_full_retries = atoi(value);
+        } else if (strcmp(key, "compression_codec") == 0) {
+            strncpy(config->compression_codec, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "compression_level") == 0) {
+            config->compression_level = atoi(value);
+        } else if (strcmp(key, "statistics_interval_ms") == 0) {
+            config->statistics_interval_ms = atoi(value);
+        } else if (strcmp(key, "codec_bench_codecs") == 0) {
+            strncpy(config->codec_bench_codecs, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "producer_max_in_flight") == 0) {
+            config->producer_max_in_flight = atoi(value);
+        } else if (strcmp(key, "producer_duration_sec") == 0) {
+            config->producer_duration_sec = atoi(value);
+        } else if (strcmp(key, "sweep_batch_size") == 0) {
+            strncpy(config->sweep_batch_size, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "sweep_linger_ms") == 0) {
+            strncpy(config->sweep_linger_ms, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "sweep_acks") == 0) {
+            strncpy(config->sweep_acks, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "sweep_message_size") == 0) {
+            strncpy(config->sweep_message_size, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "sweep_max_in_flight") == 0) {
+            strncpy(config->sweep_max_in_flight, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "sweep_duration_sec") == 0) {
+            config->sweep_duration_sec = atoi(value);
+        } else if (strcmp(key, "sweep_latency_budget_ms") == 0) {
+            config->sweep_latency_budget_ms = atof(value);
+        } else if (strcmp(key, "sweep_latency_percentile") == 0) {
+            config->sweep_latency_percentile = atof(value);
+        } else if (strcmp(key, "export_start_time") == 0) {
+            strncpy(config->export_start_time, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "export_end_time") == 0) {
+            strncpy(config->export_end_time, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "export_output_dir") == 0) {
+            strncpy(config->export_output_dir, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "export_threads") == 0) {
+            config->export_threads = atoi(value);
+        } else if (strcmp(key, "group_members") == 0) {
+            config->group_members = atoi(value);
+        } else if (strcmp(key, "group_scale_schedule") == 0) {
+            strncpy(config->group_scale_schedule, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "group_duration_sec") == 0) {
+            config->group_duration_sec = atoi(value);
+        } else if (strcmp(key, "mock_bench_brokers") == 0) {
+            config->mock_bench_brokers = atoi(value);
+        } else if (strcmp(key, "mock_bench_duration_sec") == 0) {
+            config->mock_bench_duration_sec = atoi(value);
+        } else if (strcmp(key, "mock_bench_scenarios") == 0) {
+            strncpy(config->mock_bench_scenarios, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "producer_threads") == 0) {
+            config->producer_threads = atoi(value);
+        } else if (strcmp(key, "producer_shared_handle") == 0) {
+            config->producer_shared_handle = atoi(value);
+        } else if (strcmp(key, "producer_message_size") == 0) {
+            config->producer_message_size = atoi(value);
+        } else if (strcmp(key, "producer_payload_count") == 0) {
+            config->producer_payload_count = atoi(value);
+        } else if (strcmp(key, "payload_size_distribution") == 0) {
+            int distribution = parse_payload_size_distribution(value);
+            if (distribution < 0) {
+                log_message(1, "WARNING", "Unknown payload_size_distribution '%s', using fixed", value);
+                distribution = PAYLOAD_SIZE_FIXED;
+            }
+            config->payload_size_distribution = distribution;
+        } else if (strcmp(key, "payload_size_min") == 0) {
+            config->payload_size_min = atoi(value);
+        } else if (strcmp(key, "payload_size_max") == 0) {
+            config->payload_size_max = atoi(value);
+        } else if (strcmp(key, "payload_size_stddev") == 0) {
+            config->payload_size_stddev = atoi(value);
+        } else if (strcmp(key, "payload_bimodal_large_pct") == 0) {
+            config->payload_bimodal_large_pct = atoi(value);
+        } else if (strcmp(key, "payload_content") == 0) {
+            int content = parse_payload_content(value);
+            if (content < 0) {
+                log_message(1, "WARNING", "Unknown payload_content '%s', using text", value);
+                content = PAYLOAD_CONTENT_TEXT;
+            }
+            config->payload_content = content;
+        } else if (strcmp(key, "payload_compressibility") == 0) {
+            int compressibility = atoi(value);
+            if (compressibility < 0 || compressibility > 100) {
+                compressibility = compressibility < 0 ? 0 : 100;
+                log_message(1, "WARNING", "payload_compressibility '%s' is not 0-100, using %d",
+                            value, compressibility);
+            }
+            config->payload_compressibility = compressibility;
+        } else if (strcmp(key, "key_distribution") == 0) {
+            int distribution = parse_key_distribution(value);
+            if (distribution < 0) {
+                log_message(1, "WARNING", "Unknown key_distribution '%s', using none", value);
+                distribution = KEY_DIST_NONE;
+            }
+            config->key_distribution = distribution;
+        } else if (strcmp(key, "key_space") == 0) {
+            config->key_space = atoi(value);
+        } else if (strcmp(key, "key_zipf_exponent") == 0) {
+            config->key_zipf_exponent = atof(value);
+        } else if (strcmp(key, "producer_partitioner") == 0) {
+            strncpy(config->producer_partitioner, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "producer_rate_msgs") == 0) {
+            config->producer_rate_msgs = atoi(value);
+        } else if (strcmp(key, "producer_rate_mb") == 0) {
+            config->producer_rate_mb = atof(value);
+        } else if (strcmp(key, "consumer_group_id") == 0) {
+            strncpy(config->consumer_group_id, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "consumer_assign") == 0) {
+            strncpy(config->consumer_assign, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "consumer_assignment_strategy") == 0) {
+            strncpy(config->consumer_assignment_strategy, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "consumer_rebalance_churn_sec") == 0) {
+            config->consumer_rebalance_churn_sec = atoi(value);
+        } else if (strcmp(key, "consumer_auto_offset_reset") == 0) {
+            strncpy(config->consumer_auto_offset_reset, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "consumer_session_timeout_ms") == 0) {
+            config->consumer_session_timeout_ms = atoi(value);
+        } else if (strcmp(key, "consumer_enable_auto_commit") == 0) {
+            strncpy(config->consumer_enable_auto_commit, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "consumer_workers") == 0) {
+            config->consumer_workers = atoi(value);
+        } else if (strcmp(key, "consumer_dispatch") == 0) {
+            if (strcmp(value, "key") == 0) {
+                config->consumer_dispatch = DISPATCH_KEY;
+            } else {
+                if (strcmp(value, "partition") != 0) {
+                    log_message(1, "WARNING", "Unknown consumer_dispatch '%s', using partition", value);
+                }
+                config->consumer_dispatch = DISPATCH_PARTITION;
+            }
+        } else if (strcmp(key, "consumer_worker_queue_size") == 0) {
+            config->consumer_worker_queue_size = atoi(value);
+        } else if (strcmp(key, "consumer_work_us") == 0) {
+            config->consumer_work_us = atoi(value);
+        } else if (strcmp(key, "consumer_commit_policy") == 0) {
+            int policy;
+            for (policy = 0; policy < COMMIT_POLICY_COUNT; policy++) {
+                if (strcmp(value, commit_policy_names[policy]) == 0) break;
+            }
+            if (policy == COMMIT_POLICY_COUNT) {
+                log_message(1, "WARNING", "Unknown consumer_commit_policy '%s', using none", value);
+                policy = COMMIT_NONE;
+            }
+            config->consumer_commit_policy = policy;
+        } else if (strcmp(key, "consumer_commit_every_messages") == 0) {
+            config->consumer_commit_every_messages = atoi(value);
+        } else if (strcmp(key, "consumer_commit_interval_ms") == 0) {
+            config->consumer_commit_interval_ms = atoi(value);
+        } else if (strcmp(key, "consumer_batch_size") == 0) {
+            config->consumer_batch_size = atoi(value);
+        } else if (strcmp(key, "consumer_quiet") == 0) {
+            config->consumer_quiet = atoi(value);
+        } else if (strcmp(key, "consumer_sample_every") == 0) {
+            config->consumer_sample_every = atoi(value);
+        } else if (strcmp(key, "consumer_sample_per_sec") == 0) {
+            config->consumer_sample_per_sec = atoi(value);
+        } else if (strcmp(key, "verbose") == 0) {
+            config->verbose = atoi(value);
+        } else if (strcmp(key, "message_count") == 0) {
+            config->message_count = atoi(value);
+        } else if (strcmp(key, "report_interval_sec") == 0) {
+            config->report_interval_sec = atoi(value);
+        } else if (strcmp(key, "dashboard") == 0) {
+            config->dashboard = atoi(value);
+        } else if (strcmp(key, "dashboard_refresh_ms") == 0) {
+            config->dashboard_refresh_ms = atoi(value);
+        } else if (strcmp(key, "result_dir") == 0) {
+            strncpy(config->result_dir, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "metrics_port") == 0) {
+            config->metrics_port = atoi(value);
+        } else if (strcmp(key, "metrics_bind") == 0) {
+            strncpy(config->metrics_bind, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "metrics_textfile") == 0) {
+            strncpy(config->metrics_textfile, value, MAX_VALUE_LENGTH - 1);
+        } else if (strcmp(key, "metrics_textfile_interval_ms") == 0) {
+            config->metrics_textfile_interval_ms = atoi(value);
+        }
+    }
+    
+    fclose(file);
+    return 0;
+}
+
+/*
+ * Print configuration (with sensitive data masked)
+ */
+static void print_config(const Config *config) {
+    log_message(1, "CONFIG", "=== Configuration ===");
+    log_message(1, "CONFIG", "Brokers: %s", config->brokers);
+    log_message(1, "CONFIG", "Topic: %s", config->topic);
+    log_message(1, "CONFIG", "Security Protocol: %s", config->security_protocol);
+    log_message(1, "CONFIG", "CA Location: %s", 
+                strlen(config->ssl_ca_location) > 0 ? config->ssl_ca_location : "(not set)");
+    log_message(1, "CONFIG", "Certificate Location: %s",
+                strlen(config->ssl_certificate_location) > 0 ? config->ssl_certificate_location : "(not set)");
+    log_message(1, "CONFIG", "Key Location: %s",
+                strlen(config->ssl_key_location) > 0 ? config->ssl_key_location : "(not set)");
+    log_message(1, "CONFIG", "Key Password: %s",
+                strlen(config->ssl_key_password) > 0 ? "***" : "(not set)");
+    log_message(1, "CONFIG", "Message Count: %d", config->message_count);
+    if (config->producer_duration_sec > 0) {
+        log_message(1, "CONFIG", "Producer Duration: %d s", config->producer_duration_sec);
+    }
+    log_message(1, "CONFIG", "Verbose: %d", config->verbose);
+    log_message(1, "CONFIG", "Report Interval: %d s", config->report_interval_sec);
+    if (config->dashboard) {
+        log_message(1, "CONFIG", "Dashboard: redraw every %d ms", config->dashboard_refresh_ms);
+    }
+    if (config->producer_queue_full_policy == QUEUE_FULL_RETRY) {
+        log_message(1, "CONFIG", "Queue Full Policy: retry (%d attempts)",
+                    config->producer_queue_full_retries);
+    } else {
+        log_message(1, "CONFIG", "Queue Full Policy: %s",
+                    queue_full_policy_names[config->producer_queue_full_policy]);
+    }
+    log_message(1, "CONFIG", "Producer Threads: %d (%s)", config->producer_threads,
+                config->producer_shared_handle ? "shared handle" : "one handle per thread");
+    log_message(1, "CONFIG", "Producer Message Size: %d bytes, %d payloads per thread",
+                config->producer_message_size, config->producer_payload_count);
+    log_message(1, "CONFIG", "Payload: %s sizes (%d-%d bytes), %s content, %d%% compressible",
+                payload_size_distribution_names[config->payload_size_distribution],
+                config->payload_size_min, config->payload_size_max,
+                payload_content_names[config->payload_content], config->payload_compressibility);
+    if (config->key_distribution == KEY_DIST_ZIPF) {
+        log_message(1, "CONFIG", "Keys: zipf (s = %.2f) over %d keys",
+                    config->key_zipf_exponent, config->key_space);
+    } else if (config->key_distribution != KEY_DIST_NONE) {
+        log_message(1, "CONFIG", "Keys: %s over %d keys",
+                    key_distribution_names[config->key_distribution], config->key_space);
+    } else {
+        log_message(1, "CONFIG", "Keys: none");
+    }
+    log_message(1, "CONFIG", "Producer Rate: %d msg/s, %.2f MB/s (0 = unlimited)",
+                config->producer_rate_msgs, config->producer_rate_mb);
+    if (config->compression_level >= 0) {
+        log_message(1, "CONFIG", "Compression: %s (level %d)",
+                    config->compression_codec, config->compression_level);
+    } else {
+        log_message(1, "CONFIG", "Compression: %s", config->compression_codec);
+    }
+    log_message(1, "CONFIG", "Statistics Interval: %d ms (0 = disabled)",
+                config->statistics_interval_ms);
+    log_message(1, "CONFIG", "Auto Commit: %s", config->consumer_enable_auto_commit);
+    if (strlen(config->consumer_assign) > 0) {
+        log_message(1, "CONFIG", "Consumer Mode: assign %s (no group membership)",
+                    config->consumer_assign);
+    } else {
+        log_message(1, "CONFIG", "Consumer Mode: subscribe (group %s)", config->consumer_group_id);
+    }
+    log_message(1, "CONFIG", "Assignment Strategy: %s",
+                strlen(config->consumer_assignment_strategy) > 0 ?
+                config->consumer_assignment_strategy : "librdkafka default");
+    if (config->consumer_rebalance_churn_sec > 0) {
+        log_message(1, "CONFIG", "Rebalance Churn: a second member joins and leaves every %d s",
+                    config->consumer_rebalance_churn_sec);
+    }
+    if (config->consumer_commit_policy == COMMIT_MESSAGES) {
+        log_message(1, "CONFIG", "Commit Policy: every %d messages (async)",
+                    config->consumer_commit_every_messages);
+    } else if (config->consumer_commit_policy == COMMIT_INTERVAL) {
+        log_message(1, "CONFIG", "Commit Policy: every %d ms (async)",
+                    config->consumer_commit_interval_ms);
+    } else {
+        log_message(1, "CONFIG", "Commit Policy: %s",
+                    commit_policy_names[config->consumer_commit_policy]);
+    }
+    log_message(1, "CONFIG", "Consumer Batch Size: %d%s", config->consumer_batch_size,
+                config->consumer_batch_size > 1 ? "" : " (rd_kafka_consumer_poll per message)");
+    if (config->consumer_workers > 0) {
+        log_message(1, "CONFIG", "Consumer Workers: %d (dispatch by %s, queue %d), work %d us/msg",
+                    config->consumer_workers, dispatch_names[config->consumer_dispatch],
+                    config->consumer_worker_queue_size, config->consumer_work_us);
+    } else {
+        log_message(1, "CONFIG", "Consumer Workers: none (polling thread), work %d us/msg",
+                    config->consumer_work_us);
+    }
+    if (config->consumer_quiet) {
+        log_message(1, "CONFIG", "Consumer Output: quiet (sample every %d, %d per second, 0 = off)",
+                    config->consumer_sample_every, config->consumer_sample_per_sec);
+    } else {
+        log_message(1, "CONFIG", "Consumer Output: every message");
+    }
+    log_message(1, "CONFIG", "Skip Certificate Verify: %s", 
+                config->ssl_skip_certificate_verify ? "true" : "false");
+    log_message(1, "CONFIG", "=====================");
+}
+
+/*
+ * Atomically raise *ptr to value if value is larger
+ */
+static void atomic_max_i64(int64_t *ptr, int64_t value) {
+    int64_t current = ATOMIC_LOAD(ptr);
+    
+    while (value > current &&
+           !__atomic_compare_exchange_n(ptr, &current, value, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* current was reloaded by the failed exchange */
+    }
+}
+
+/*
+ * Map a value to its histogram bucket
+ */
+static int hist_bucket_index(int64_t value) {
+    int msb, shift, index;
+    
+    if (value < HIST_SUB_BUCKETS) {
+        return value < 0 ? 0 : (int)value;
+    }
+    
+    msb = 63 - __builtin_clzll((unsigned long long)value);
+    shift = msb - HIST_SUB_BUCKET_BITS + 1;
+    index = HIST_SUB_BUCKETS + (shift - 1) * HIST_HALF_BUCKETS +
+            (int)(value >> shift) - HIST_HALF_BUCKETS;
+    
+    return index < HIST_BUCKET_COUNT ? index : HIST_BUCKET_COUNT - 1;
+}
+
+/*
+ * Highest value that maps to a histogram bucket
+ */
+static int64_t hist_bucket_value(int index) {
+    int shift, sub;
+    
+    if (index < HIST_SUB_BUCKETS) {
+        return index;
+    }
+    
+    shift = (index - HIST_SUB_BUCKETS) / HIST_HALF_BUCKETS + 1;
+    sub = (index - HIST_SUB_BUCKETS) % HIST_HALF_BUCKETS + HIST_HALF_BUCKETS;
+    return (((int64_t)sub + 1) << shift) - 1;
+}
+
+/*
+ * Record a value; safe to call concurrently from any thread
+ */
+static void hist_record(LatencyHistogram *hist, int64_t value) {
+    ATOMIC_ADD(&hist->counts[hist_bucket_index(value)], 1);
+    ATOMIC_ADD(&hist->total_count, 1);
+    atomic_max_i64(&hist->max_value, value);
+}
+
+/*
+ * Value at the given percentile (0-100), 0 if the histogram is empty
+ */
+static int64_t hist_percentile(const LatencyHistogram *hist, double percentile) {
+    int64_t total = 0;
+    int64_t target, seen = 0;
+    int i;
+    
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        total += ATOMIC_LOAD(&hist->counts[i]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    
+    target = (int64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (target < 1) target = 1;
+    if (target > total) target = total;
+    
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        seen += ATOMIC_LOAD(&hist->counts[i]);
+        if (seen >= target) {
+            return hist_bucket_value(i);
+        }
+    }
+    return hist_bucket_value(HIST_BUCKET_COUNT - 1);
+}
+
+/*
+ * Compute what was recorded since the previous snapshot, then advance the
+ * snapshot. The live histogram is only read, never reset, so writers are
+ * never disturbed. The delta's max is the highest non-empty bucket.
+ */
+static void hist_delta(const LatencyHistogram *current, LatencyHistogram *previous,
+                       LatencyHistogram *delta) {
+    int i;
+    
+    delta->total_count = 0;
+    delta->max_value = 0;
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        int64_t count = ATOMIC_LOAD(&current->counts[i]);
+        delta->counts[i] = count - previous->counts[i];
+        previous->counts[i] = count;
+        if (delta->counts[i] > 0) {
+            delta->total_count += delta->counts[i];
+            delta->max_value = hist_bucket_value(i);
+        }
+    }
+    previous->total_count = ATOMIC_LOAD(&current->total_count);
+    previous->max_value = ATOMIC_LOAD(&current->max_value);
+}
+
+/*
+ * Add the contents of one histogram to another (dst must not be shared)
+ */
+static void hist_merge(LatencyHistogram *dst, const LatencyHistogram *src) {
+    int64_t max_value = ATOMIC_LOAD(&src->max_value);
+    int i;
+    
+    for (i = 0; i < HIST_BUCKET_COUNT; i++) {
+        dst->counts[i] += ATOMIC_LOAD(&src->counts[i]);
+    }
+    dst->total_count += ATOMIC_LOAD(&src->total_count);
+    if (max_value > dst->max_value) {
+        dst->max_value = max_value;
+    }
+}
+
+/*
+ * Log the standard percentile line for a latency histogram
+ */
+static void log_latency_percentiles(const char *label, const LatencyHistogram *hist) {
+    log_message(1, "INFO", "%s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms",
+                label,
+                (double)hist_percentile(hist, 50.0) / 1e6,
+                (double)hist_percentile(hist, 90.0) / 1e6,
+                (double)hist_percentile(hist, 99.0) / 1e6,
+                (double)hist_percentile(hist, 99.9) / 1e6,
+                (double)ATOMIC_LOAD(&hist->max_value) / 1e6);
+}
+
+/*
+ * Monotonic high-resolution clock in nanoseconds
+ */
+static int64_t get_time_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000LL +
+           (int64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000LL / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Sleep for the given number of milliseconds
+ */
+static void sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep((useconds_t)ms * 1000);
+#endif
+}
+
+/*
+ * Start a thread
+ * Returns 0 on success
+ */
+static int thread_create(thread_t *thread, thread_func_t func, void *arg) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, func, arg, 0, NULL);
+    return *thread != NULL ? 0 : -1;
+#else
+    return pthread_create(thread, NULL, func, arg);
+#endif
+}
+
+/*
+ * Wait for a thread to finish and release it
+ */
+static void thread_join(thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+/*
+ * Wall clock in nanoseconds since the Unix epoch, comparable across hosts
+ * with synchronized clocks (used for end-to-end latency)
+ */
+static int64_t get_wall_time_ns(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER ticks;
+    
+    GetSystemTimePreciseAsFileTime(&ft);
+    ticks.LowPart = ft.dwLowDateTime;
+    ticks.HighPart = ft.dwHighDateTime;
+    /* 100 ns ticks since 1601-01-01 */
+    return ((int64_t)ticks.QuadPart - 116444736000000000LL) * 100;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Current process id, used as the default producer id
+ */
+static unsigned int get_process_id(void) {
+#ifdef _WIN32
+    return (unsigned int)GetCurrentProcessId();
+#else
+    return (unsigned int)getpid();
+#endif
+}
+
+/*
+ * CPU time (user + kernel) consumed by this process so far, in nanoseconds
+ */
+static int64_t get_process_cpu_ns(void) {
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    ULARGE_INTEGER kernel, user;
+    
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
+                         &kernel_time, &user_time)) {
+        return 0;
+    }
+    kernel.LowPart = kernel_time.dwLowDateTime;
+    kernel.HighPart = kernel_time.dwHighDateTime;
+    user.LowPart = user_time.dwLowDateTime;
+    user.HighPart = user_time.dwHighDateTime;
+    return (int64_t)(kernel.QuadPart + user.QuadPart) * 100;
+#else
+    struct rusage usage;
+    
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return ((int64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+           ((int64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+#endif
+}
+
+/*
+ * Resident memory of this process in bytes, now or at its peak; 0 if
+ * unknown. Without /proc the current value falls back to the peak.
+ */
+static int64_t get_process_rss_bytes(int peak) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return (int64_t)(peak ? counters.PeakWorkingSetSize : counters.WorkingSetSize);
+#else
+    struct rusage usage;
+    FILE *file;
+    long pages = 0;
+    
+    if (!peak && (file = fopen("/proc/self/statm", "r")) != NULL) {
+        if (fscanf(file, "%*s %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(file);
+        if (pages > 0) {
+            return (int64_t)pages * sysconf(_SC_PAGESIZE);
+        }
+    }
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (int64_t)usage.ru_maxrss;          /* Bytes on macOS */
+#else
+    return (int64_t)usage.ru_maxrss * 1024;   /* Kilobytes on Linux and the BSDs */
+#endif
+#endif
+}
+
+/*
+ * Serialize a payload header (PAYLOAD_HEADER_SIZE bytes, little-endian)
+ */
+static void encode_payload_header(unsigned char *buf, const PayloadHeader *header) {
+    uint64_t send_time = (uint64_t)header->send_time_ns;
+    int i;
+    
+    for (i = 0; i < 4; i++) {
+        buf[i] = (unsigned char)(PAYLOAD_MAGIC >> (8 * i));
+        buf[4 + i] = (unsigned char)(header->producer_id >> (8 * i));
+    }
+    for (i = 0; i < 8; i++) {
+        buf[8 + i] = (unsigned char)(header->sequence >> (8 * i));
+        buf[16 + i] = (unsigned char)(send_time >> (8 * i));
+    }
+}
+
+/*
+ * Parse a payload header
+ * Returns 1 if the payload starts with a valid header, 0 otherwise
+ */
+static int decode_payload_header(const void *buf, size_t len, PayloadHeader *header) {
+    const unsigned char *p = (const unsigned char *)buf;
+    uint32_t magic = 0;
+    uint64_t send_time = 0;
+    int i;
+    
+    if (!p || len < PAYLOAD_HEADER_SIZE) {
+        return 0;
+    }
+    
+    for (i = 0; i < 4; i++) {
+        magic |= (uint32_t)p[i] << (8 * i);
+    }
+    if (magic != PAYLOAD_MAGIC) {
+        return 0;
+    }
+    
+    header->producer_id = 0;
+    header->sequence = 0;
+    for (i = 0; i < 4; i++) {
+        header->producer_id |= (uint32_t)p[4 + i] << (8 * i);
+    }
+    for (i = 0; i < 8; i++) {
+        header->sequence |= (uint64_t)p[8 + i] << (8 * i);
+        send_time |= (uint64_t)p[16 + i] << (8 * i);
+    }
+    header->send_time_ns = (int64_t)send_time;
+    return 1;
+}
+
+/*
+ * Wait until a monotonic deadline, serving delivery reports meanwhile.
+ * Coarse waits are handed to rd_kafka_poll(); the last couple of
+ * milliseconds are spun so sub-millisecond send intervals stay accurate.
+ */
+static void wait_until_ns(rd_kafka_t *rk, int64_t deadline_ns) {
+    int64_t remaining_ns;
+    
+    while ((remaining_ns = deadline_ns - get_time_ns()) > 0) {
+        if (remaining_ns > 2000000) {
+            rd_kafka_poll(rk, (int)(remaining_ns / 1000000) - 1);
+        } else {
+            rd_kafka_poll(rk, 0);
+        }
+    }
+}
+
+/*
+ * Delivery report callback for producer
+ */
+static void dr_msg_cb(rd_kafka_t *rk, const rd_kafka_message_t *rkmessage, void *opaque) {
+    const Config *config = ((ClientContext *)opaque)->config;
+    MsgSlot *slot = (MsgSlot *)rkmessage->_private;
+    
+    (void)rk;
+    
+    if (slot) {
+        ProducerStats *stats = slot->stats;
+        
+        if (rkmessage->err) {
+            ATOMIC_ADD(&stats->failed, 1);
+        } else {
+            /* Intended-time latency keeps broker stalls visible */
+            int64_t now_ns = get_time_ns();
+            int partition = rkmessage->partition;
+            
+            if (partition < 0 || partition >= MAX_TRACKED_PARTITIONS) {
+                partition = MAX_TRACKED_PARTITIONS - 1;
+            }
+            hist_record(&stats->ack_latency, now_ns - slot->enqueue_ns);
+            hist_record(&stats->intended_latency, now_ns - slot->intended_ns);
+            ATOMIC_ADD(&stats->partition_messages[partition], 1);
+            ATOMIC_ADD(&stats->partition_bytes[partition], (long long)rkmessage->len);
+            ATOMIC_ADD(&stats->partition_latency_sum_ns[partition], now_ns - slot->enqueue_ns);
+            atomic_max_i64(&stats->partition_latency_max_ns[partition], now_ns - slot->enqueue_ns);
+            ATOMIC_ADD(&stats->bytes_delivered, (long long)rkmessage->len);
+            ATOMIC_ADD(&stats->delivered, 1);
+        }
+        ATOMIC_STORE_RELEASE(&slot->in_flight, 0);
+    }
+    
+    if (rkmessage->err) {
+        log_message(config->verbose, "ERROR", "Message delivery failed: %s",
+                    rd_kafka_err2str(rkmessage->err));
+    } else {
+        log_message(config->verbose, "DEBUG", "Message delivered to partition %d at offset %lld",
+                    (int)rkmessage->partition, (long long)rkmessage->offset);
+    }
+}
+
+/*
+ * Statistics callback (statistics.interval.ms), served from rd_kafka_poll()
+ * or the consumer poll. Queues the JSON for the parser thread and keeps it
+ * (returns 1); parses in place when the parser is not running or full.
+ */
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+    ClientContext *context = (ClientContext *)opaque;
+    StatsDocument *document;
+    uint64_t pos;
+    int64_t diff;
+    
+    (void)rk;
+    
+    if (ATOMIC_LOAD_ACQUIRE(&stats_parser.running)) {
+        pos = ATOMIC_LOAD(&stats_parser.enqueue_pos);
+        for (;;) {
+            document = &stats_parser.documents[pos & (STATS_RING_SIZE - 1)];
+            diff = (int64_t)ATOMIC_LOAD_ACQUIRE(&document->sequence) - (int64_t)pos;
+            if (diff == 0) {
+                if (ATOMIC_CAS(&stats_parser.enqueue_pos, &pos, pos + 1)) {
+                    document->context = context;
+                    document->json = json;
+                    document->json_len = json_len;
+                    ATOMIC_STORE_RELEASE(&document->sequence, pos + 1);
+                    return 1;
+                }
+            } else if (diff < 0) {
+                /* A report is only a snapshot: skip one rather than block */
+                ATOMIC_ADD(&stats_parser.dropped, 1);
+                return 0;
+            } else {
+                pos = ATOMIC_LOAD(&stats_parser.enqueue_pos);
+            }
+        }
+    }
+    
+    parse_statistics(json, json_len, context->config->topic, &context->statistics);
+    ATOMIC_ADD(&context->stats_reports, 1);
+    
+    /* Returning 0 lets librdkafka free the JSON buffer */
+    return 0;
+}
+
+/*
+ * Start the statistics parser thread once; handles created before that
+ * parse in their callback
+ */
+static void start_stats_parser(void) {
+    int expected = 0;
+    uint64_t i;
+    
+    if (!ATOMIC_CAS(&stats_parser.started, &expected, 1)) {
+        return;
+    }
+    for (i = 0; i < STATS_RING_SIZE; i++) {
+        stats_parser.documents[i].sequence = i;
+    }
+    stats_parser.enqueue_pos = 0;
+    stats_parser.dequeue_pos = 0;
+    stats_parser.parsed = 0;
+    ATOMIC_STORE_RELEASE(&stats_parser.running, 1);
+    if (thread_create(&stats_parser.thread, stats_parser_main, NULL) != 0) {
+        ATOMIC_STORE_RELEASE(&stats_parser.running, 0);
+        ATOMIC_STORE(&stats_parser.started, 0);
+    }
+}
+
+/*
+ * Stop the parser after it has parsed everything queued so far
+ */
+static void stop_stats_parser(void) {
+    if (!ATOMIC_LOAD(&stats_parser.running)) {
+        return;
+    }
+    ATOMIC_STORE_RELEASE(&stats_parser.running, 0);
+    thread_join(stats_parser.thread);
+    ATOMIC_STORE(&stats_parser.started, 0);
+    if (stats_parser.dropped > 0) {
+        log_message(1, "INFO", "Statistics parser skipped %lld reports (queue full)", stats_parser.dropped);
+    }
+}
+
+/*
+ * Wait until every report queued so far has been parsed. Called after
+ * rd_kafka_destroy() so no queued document refers to a freed context.
+ */
+static void drain_statistics(void) {
+    uint64_t target = ATOMIC_LOAD(&stats_parser.enqueue_pos);
+    
+    while (ATOMIC_LOAD_ACQUIRE(&stats_parser.running) &&
+           ATOMIC_LOAD_ACQUIRE(&stats_parser.parsed) < target) {
+        sleep_ms(1);
+    }
+}
+
+/*
+ * Parser thread: parses queued reports into their handle's counters
+ */
+static thread_ret_t THREAD_CALL stats_parser_main(void *arg) {
+    StatsDocument *document;
+    int stopping = 0;
+    
+    (void)arg;
+    
+    for (;;) {
+        document = &stats_parser.documents[stats_parser.dequeue_pos & (STATS_RING_SIZE - 1)];
+        if (ATOMIC_LOAD_ACQUIRE(&document->sequence) != stats_parser.dequeue_pos + 1) {
+            if (stopping) {
+                break;
+            }
+            stopping = !ATOMIC_LOAD_ACQUIRE(&stats_parser.running);
+            if (!stopping) {
+                sleep_ms(5);
+            }
+            continue;
+        }
+        parse_statistics(document->json, document->json_len, document->context->config->topic,
+                         &document->context->statistics);
+        ATOMIC_ADD(&document->context->stats_reports, 1);
+        rd_kafka_mem_free(NULL, document->json);
+        ATOMIC_STORE_RELEASE(&document->sequence, stats_parser.dequeue_pos + STATS_RING_SIZE);
+        stats_parser.dequeue_pos++;
+        ATOMIC_STORE_RELEASE(&stats_parser.parsed, stats_parser.dequeue_pos);
+    }
+    return 0;
+}
+
+/*
+ * Single pass over a statistics document without building a tree: a stack
+ * of the keys leading to the current position is kept (pointing into the
+ * document), and every numeric value is offered to store_statistic()
+ */
+static void parse_statistics(const char *json, size_t len, const char *topic, ClientStatistics *stats) {
+    const char *keys[STATS_MAX_DEPTH + 1];
+    size_t key_lengths[STATS_MAX_DEPTH + 1];
+    const char *key = NULL;
+    const char *start;
+    char *end;
+    size_t key_length = 0;
+    size_t i = 0, j;
+    int depth = 0;
+    int64_t value;
+    
+    while (i < len) {
+        switch (json[i]) {
+        case '{':
+        case '[':
+            /* The key that led here names the new level */
+            if (depth <= STATS_MAX_DEPTH) {
+                keys[depth] = key;
+                key_lengths[depth] = key_length;
+            }
+            depth++;
+            key = NULL;
+            i++;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                /* Closes more than was opened: not a document we can follow */
+                return;
+            }
+            depth--;
+            key = NULL;
+            i++;
+            break;
+        case '"':
+            start = json + i + 1;
+            for (i++; i < len && json[i] != '"'; i++) {
+                if (json[i] == '\\') {
+                    i++;
+                }
+            }
+            j = ++i;
+            while (j < len && isspace((unsigned char)json[j])) {
+                j++;
+            }
+            if (j < len && json[j] == ':') {
+                key = start;
+                key_length = (size_t)(json + i - 1 - start);
+                i = j + 1;
+            } else {
+                key = NULL;
+            }
+            break;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            value = strtoll(json + i, &end, 10);
+            i = (size_t)(end - json);
+            while (i < len && (isdigit((unsigned char)json[i]) || json[i] == '.' ||
+                               json[i] == 'e' || json[i] == 'E' || json[i] == '+' || json[i] == '-')) {
+                i++;
+            }
+            if (key && depth >= 1 && depth <= STATS_MAX_DEPTH) {
+                keys[depth] = key;
+                key_lengths[depth] = key_length;
+                store_statistic(stats, topic, keys, key_lengths, depth, value);
+            }
+            key = NULL;
+            break;
+        default:
+            i++;
+            break;
+        }
+    }
+}
+
+/*
+ * Keep one numeric value if its path is one of the tracked fields.
+ * keys[1..depth] is the path from the document root, keys[depth] the field.
+ */
+static void store_statistic(ClientStatistics *stats, const char *topic, const char **keys,
+                            const size_t *key_lengths, int depth, int64_t value) {
+    BrokerStatistics *broker;
+    PartitionStatistics *partition;
+    long id;
+    char *end;
+    
+    if (depth == 1) {
+        if (key_equals(keys[1], key_lengths[1], "tx_bytes")) {
+            ATOMIC_STORE(&stats->tx_bytes, value);
+        } else if (key_equals(keys[1], key_lengths[1], "rx_bytes")) {
+            ATOMIC_STORE(&stats->rx_bytes, value);
+        } else if (key_equals(keys[1], key_lengths[1], "msg_cnt")) {
+            ATOMIC_STORE(&stats->msg_cnt, value);
+        }
+        return;
+    }
+    
+    /* brokers.<name>.<field> and brokers.<name>.rtt|throttle.<field> */
+    if (key_equals(keys[1], key_lengths[1], "brokers") && (depth == 3 || depth == 4)) {
+        broker = find_broker_statistics(stats, keys[2], key_lengths[2]);
+        if (!broker) {
+            return;
+        }
+        if (depth == 3) {
+            if (key_equals(keys[3], key_lengths[3], "nodeid")) {
+                ATOMIC_STORE(&broker->nodeid, value);
+            } else if (key_equals(keys[3], key_lengths[3], "outbuf_cnt")) {
+                ATOMIC_STORE(&broker->outbuf_cnt, value);
+            } else if (key_equals(keys[3], key_lengths[3], "outbuf_msg_cnt")) {
+                ATOMIC_STORE(&broker->outbuf_msg_cnt, value);
+            } else if (key_equals(keys[3], key_lengths[3], "waitresp_cnt")) {
+                ATOMIC_STORE(&broker->waitresp_cnt, value);
+            }
+        } else if (key_equals(keys[3], key_lengths[3], "rtt")) {
+            if (key_equals(keys[4], key_lengths[4], "avg")) {
+                ATOMIC_STORE(&broker->rtt_avg_us, value);
+            } else if (key_equals(keys[4], key_lengths[4], "p99")) {
+                ATOMIC_STORE(&broker->rtt_p99_us, value);
+            }
+        } else if (key_equals(keys[3], key_lengths[3], "throttle")) {
+            if (key_equals(keys[4], key_lengths[4], "avg")) {
+                ATOMIC_STORE(&broker->throttle_avg_ms, value);
+            } else if (key_equals(keys[4], key_lengths[4], "max")) {
+                ATOMIC_STORE(&broker->throttle_max_ms, value);
+            }
+        }
+        return;
+    }
+    
+    /* topics.<topic>.batchsize|batchcnt.avg and topics.<topic>.partitions.<id>.<field> */
+    if (depth < 4 || !key_equals(keys[1], key_lengths[1], "topics") ||
+        !key_equals(keys[2], key_lengths[2], topic)) {
+        return;
+    }
+    if (depth == 4 && key_equals(keys[4], key_lengths[4], "avg")) {
+        if (key_equals(keys[3], key_lengths[3], "batchsize")) {
+            ATOMIC_STORE(&stats->batch_size_avg, value);
+        } else if (key_equals(keys[3], key_lengths[3], "batchcnt")) {
+            ATOMIC_STORE(&stats->batch_cnt_avg, value);
+        }
+    } else if (depth == 5 && key_equals(keys[3], key_lengths[3], "partitions")) {
+        /* "-1" is the unassigned partition */
+        id = strtol(keys[4], &end, 10);
+        if (end != keys[4] + key_lengths[4] || id < 0 || id >= MAX_TRACKED_PARTITIONS) {
+            return;
+        }
+        partition = &stats->partitions[id];
+        if (key_equals(keys[5], key_lengths[5], "txmsgs")) {
+            ATOMIC_STORE(&partition->txmsgs, value);
+        } else if (key_equals(keys[5], key_lengths[5], "rxmsgs")) {
+            ATOMIC_STORE(&partition->rxmsgs, value);
+        } else if (key_equals(keys[5], key_lengths[5], "fetchq_cnt")) {
+            ATOMIC_STORE(&partition->fetchq_cnt, value);
+        } else if (key_equals(keys[5], key_lengths[5], "msgq_cnt")) {
+            ATOMIC_STORE(&partition->msgq_cnt, value);
+        } else {
+            return;
+        }
+        if (id >= stats->partition_count) {
+            ATOMIC_STORE_RELEASE(&stats->partition_count, (int)id + 1);
+        }
+    }
+}
+
+/*
+ * Compare a key that is not NUL-terminated with a string
+ */
+static int key_equals(const char *key, size_t len, const char *literal) {
+    return key && strlen(literal) == len && memcmp(key, literal, len) == 0;
+}
+
+/*
+ * Find a broker by name, adding it on first sight (parser thread only)
+ * Returns NULL when MAX_STATS_BROKERS are already tracked
+ */
+static BrokerStatistics *find_broker_statistics(ClientStatistics *stats, const char *name, size_t len) {
+    BrokerStatistics *broker;
+    int i;
+    
+    if (len >= sizeof(stats->brokers[0].name)) {
+        len = sizeof(stats->brokers[0].name) - 1;
+    }
+    for (i = 0; i < stats->broker_count; i++) {
+        if (strncmp(stats->brokers[i].name, name, len) == 0 && stats->brokers[i].name[len] == '\0') {
+            return &stats->brokers[i];
+        }
+    }
+    if (stats->broker_count == MAX_STATS_BROKERS) {
+        return NULL;
+    }
+    broker = &stats->brokers[stats->broker_count];
+    memcpy(broker->name, name, len);
+    broker->name[len] = '\0';
+    broker->nodeid = -1;
+    
+    /* Readers see the name complete once the count covers it */
+    ATOMIC_STORE_RELEASE(&stats->broker_count, stats->broker_count + 1);
+    return broker;
+}
+
+/*
+ * Log the latest statistics of one handle: a line per broker, the client
+ * queues, and with per_partition a line per partition of the topic
+ */
+static void log_client_statistics(const ClientStatistics *stats, const char *label, int per_partition) {
+    const BrokerStatistics *broker;
+    const PartitionStatistics *partition;
+    int broker_count = ATOMIC_LOAD_ACQUIRE(&stats->broker_count);
+    int partition_count = ATOMIC_LOAD_ACQUIRE(&stats->partition_count);
+    long long txmsgs = 0, rxmsgs = 0, fetchq = 0, msgq = 0, max_fetchq = 0;
+    int max_fetchq_partition = -1;
+    int i;
+    
+    for (i = 0; i < broker_count; i++) {
+        broker = &stats->brokers[i];
+        if (ATOMIC_LOAD(&broker->nodeid) < 0) {
+            continue;
+        }
+        log_message(1, "INFO", "%sbroker %s: rtt avg %.3f ms, p99 %.3f ms, %lld in flight, "
+                    "outbuf %lld requests (%lld msgs), throttle avg %lld ms, max %lld ms",
+                    label, broker->name, (double)ATOMIC_LOAD(&broker->rtt_avg_us) / 1000.0,
+                    (double)ATOMIC_LOAD(&broker->rtt_p99_us) / 1000.0,
+                    (long long)ATOMIC_LOAD(&broker->waitresp_cnt), (long long)ATOMIC_LOAD(&broker->outbuf_cnt),
+                    (long long)ATOMIC_LOAD(&broker->outbuf_msg_cnt),
+                    (long long)ATOMIC_LOAD(&broker->throttle_avg_ms),
+                    (long long)ATOMIC_LOAD(&broker->throttle_max_ms));
+    }
+    
+    for (i = 0; i < partition_count; i++) {
+        partition = &stats->partitions[i];
+        txmsgs += ATOMIC_LOAD(&partition->txmsgs);
+        rxmsgs += ATOMIC_LOAD(&partition->rxmsgs);
+        fetchq += ATOMIC_LOAD(&partition->fetchq_cnt);
+        msgq += ATOMIC_LOAD(&partition->msgq_cnt);
+        if (ATOMIC_LOAD(&partition->fetchq_cnt) > max_fetchq) {
+            max_fetchq = ATOMIC_LOAD(&partition->fetchq_cnt);
+            max_fetchq_partition = i;
+        }
+        if (per_partition && (partition->txmsgs > 0 || partition->rxmsgs > 0)) {
+            log_message(1, "INFO", "%spartition %d: txmsgs %lld, rxmsgs %lld, msgq %lld, fetchq %lld",
+                        label, i, (long long)ATOMIC_LOAD(&partition->txmsgs),
+                        (long long)ATOMIC_LOAD(&partition->rxmsgs), (long long)ATOMIC_LOAD(&partition->msgq_cnt),
+                        (long long)ATOMIC_LOAD(&partition->fetchq_cnt));
+        }
+    }
+    log_message(1, "INFO", "%sclient: %lld msgs queued, avg batch %lld bytes (%lld msgs), "
+                "txmsgs %lld, rxmsgs %lld, msgq %lld, fetchq %lld (max %lld on partition %d)",
+                label, (long long)ATOMIC_LOAD(&stats->msg_cnt), (long long)ATOMIC_LOAD(&stats->batch_size_avg),
+                (long long)ATOMIC_LOAD(&stats->batch_cnt_avg), txmsgs, rxmsgs, msgq, fetchq,
+                max_fetchq, max_fetchq_partition);
+}
+
+/*
+ * Create Kafka producer with mTLS configuration
+ */
+static rd_kafka_t* create_producer(const Config *config) {
+    rd_kafka_t *rk;
+    rd_kafka_conf_t *conf;
+    ClientContext *context;
+    char errstr[512];
+    
+    conf = rd_kafka_conf_new();
+    
+    /* Enable librdkafka debug logging if verbose mode */
+    if (config->verbose) {
+        if (rd_kafka_conf_set(conf, "debug", "all",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "WARNING", "Failed to set debug: %s", errstr);
+        }
+        if (rd_kafka_conf_set(conf, "log_level", "7",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "WARNING", "Failed to set log_level: %s", errstr);
+        }
+    }
+    
+    /* Set bootstrap servers */
+    if (rd_kafka_conf_set(conf, "bootstrap.servers", config->brokers,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set bootstrap.servers: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    /* Configure mTLS authentication */
+    if (strcmp(config->security_protocol, "SSL") == 0) {
+        log_message(1, "INFO", "Configuring mTLS authentication...");
+        
+        if (rd_kafka_conf_set(conf, "security.protocol", "SSL",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set security.protocol: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            return NULL;
+        }
+        
+        /* CA Certificate */
+        if (strlen(config->ssl_ca_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.ca.location", config->ssl_ca_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.ca.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "CA certificate configured: %s", config->ssl_ca_location);
+        }
+        
+        /* Client Certificate */
+        if (strlen(config->ssl_certificate_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.certificate.location", config->ssl_certificate_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.certificate.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Client certificate configured: %s", config->ssl_certificate_location);
+        }
+        
+        /* Client Key */
+        if (strlen(config->ssl_key_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.key.location", config->ssl_key_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.key.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Client key configured: %s", config->ssl_key_location);
+        }
+        
+        /* Key Password (if provided) */
+        if (strlen(config->ssl_key_password) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.key.password", config->ssl_key_password,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.key.password: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Key password configured");
+        }
+        
+        /* Skip certificate verification (for testing only) */
+        if (config->ssl_skip_certificate_verify) {
+            if (rd_kafka_conf_set(conf, "enable.ssl.certificate.verification", "false",
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to disable SSL certificate verification: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "WARNING", "SSL certificate verification is DISABLED - use only for testing!");
+        }
+    }
+    
+    /* Producer-specific settings */
+    char batch_size_str[32], linger_str[32], acks_str[32];
+    snprintf(batch_size_str, sizeof(batch_size_str), "%d", config->producer_batch_size);
+    snprintf(linger_str, sizeof(linger_str), "%d", config->producer_linger_ms);
+    snprintf(acks_str, sizeof(acks_str), "%d", config->producer_ack);
+    
+    rd_kafka_conf_set(conf, "batch.size", batch_size_str, NULL, 0);
+    rd_kafka_conf_set(conf, "linger.ms", linger_str, NULL, 0);
+    rd_kafka_conf_set(conf, "acks", acks_str, NULL, 0);
+    
+    if (strlen(config->producer_partitioner) > 0) {
+        if (rd_kafka_conf_set(conf, "partitioner", config->producer_partitioner,
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set partitioner: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            return NULL;
+        }
+    }
+    if (config->producer_max_in_flight > 0) {
+        char in_flight_str[32];
+        snprintf(in_flight_str, sizeof(in_flight_str), "%d", config->producer_max_in_flight);
+        rd_kafka_conf_set(conf, "max.in.flight.requests.per.connection", in_flight_str, NULL, 0);
+    }
+    
+    /* Local queue limits: QUEUE_FULL backpressure starts here */
+    if (config->producer_queue_max_messages > 0) {
+        char queue_str[32];
+        snprintf(queue_str, sizeof(queue_str), "%d", config->producer_queue_max_messages);
+        rd_kafka_conf_set(conf, "queue.buffering.max.messages", queue_str, NULL, 0);
+    }
+    if (config->producer_queue_max_kbytes > 0) {
+        char queue_str[32];
+        snprintf(queue_str, sizeof(queue_str), "%d", config->producer_queue_max_kbytes);
+        rd_kafka_conf_set(conf, "queue.buffering.max.kbytes", queue_str, NULL, 0);
+    }
+    
+    /* Compression */
+    if (rd_kafka_conf_set(conf, "compression.codec", config->compression_codec,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set compression.codec: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    if (config->compression_level >= 0) {
+        char level_str[32];
+        snprintf(level_str, sizeof(level_str), "%d", config->compression_level);
+        if (rd_kafka_conf_set(conf, "compression.level", level_str,
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set compression.level: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            return NULL;
+        }
+    }
+    
+    /* Statistics feed the bytes-on-the-wire counter and the broker/queue lines */
+    if (config->statistics_interval_ms > 0) {
+        char interval_str[32];
+        snprintf(interval_str, sizeof(interval_str), "%d", config->statistics_interval_ms);
+        rd_kafka_conf_set(conf, "statistics.interval.ms", interval_str, NULL, 0);
+        rd_kafka_conf_set_stats_cb(conf, stats_cb);
+        start_stats_parser();
+    }
+    
+    /* Set delivery report callback */
+    rd_kafka_conf_set_dr_msg_cb(conf, dr_msg_cb);
+    
+    /* Per-handle context for callbacks, released by destroy_producer() */
+    context = (ClientContext *)calloc(1, sizeof(ClientContext));
+    if (!context) {
+        log_message(1, "ERROR", "Failed to allocate producer context");
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    context->config = config;
+    rd_kafka_conf_set_opaque(conf, context);
+    
+    /* Create producer */
+    rk = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr, sizeof(errstr));
+    if (!rk) {
+        log_message(1, "ERROR", "Failed to create producer: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        free(context);
+        return NULL;
+    }
+    
+    log_message(1, "INFO", "Producer created successfully");
+    return rk;
+}
+
+/*
+ * Create Kafka consumer with mTLS configuration
+ */
+static rd_kafka_t* create_consumer(const Config *config) {
+    rd_kafka_t *rk;
+    rd_kafka_conf_t *conf;
+    ClientContext *context;
+    char errstr[512];
+    char timeout_str[32];
+    
+    conf = rd_kafka_conf_new();
+    
+    /* Enable librdkafka debug logging if verbose mode */
+    if (config->verbose) {
+        if (rd_kafka_conf_set(conf, "debug", "all",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "WARNING", "Failed to set debug: %s", errstr);
+        }
+        if (rd_kafka_conf_set(conf, "log_level", "7",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "WARNING", "Failed to set log_level: %s", errstr);
+        }
+    }
+    
+    /* Set bootstrap servers */
+    if (rd_kafka_conf_set(conf, "bootstrap.servers", config->brokers,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set bootstrap.servers: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    /* Configure mTLS authentication */
+    if (strcmp(config->security_protocol, "SSL") == 0) {
+        log_message(1, "INFO", "Configuring mTLS authentication...");
+        
+        if (rd_kafka_conf_set(conf, "security.protocol", "SSL",
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set security.protocol: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            return NULL;
+        }
+        
+        /* CA Certificate */
+        if (strlen(config->ssl_ca_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.ca.location", config->ssl_ca_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.ca.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "CA certificate configured: %s", config->ssl_ca_location);
+        }
+        
+        /* Client Certificate */
+        if (strlen(config->ssl_certificate_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.certificate.location", config->ssl_certificate_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.certificate.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Client certificate configured: %s", config->ssl_certificate_location);
+        }
+        
+        /* Client Key */
+        if (strlen(config->ssl_key_location) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.key.location", config->ssl_key_location,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.key.location: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Client key configured: %s", config->ssl_key_location);
+        }
+        
+        /* Key Password (if provided) */
+        if (strlen(config->ssl_key_password) > 0) {
+            if (rd_kafka_conf_set(conf, "ssl.key.password", config->ssl_key_password,
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to set ssl.key.password: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "INFO", "Key password configured");
+        }
+        
+        /* Skip certificate verification (for testing only) */
+        if (config->ssl_skip_certificate_verify) {
+            if (rd_kafka_conf_set(conf, "enable.ssl.certificate.verification", "false",
+                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+                log_message(1, "ERROR", "Failed to disable SSL certificate verification: %s", errstr);
+                rd_kafka_conf_destroy(conf);
+                return NULL;
+            }
+            log_message(1, "WARNING", "SSL certificate verification is DISABLED - use only for testing!");
+        }
+    }
+    
+    /* Consumer-specific settings */
+    if (rd_kafka_conf_set(conf, "group.id", config->consumer_group_id,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set group.id: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    if (rd_kafka_conf_set(conf, "auto.offset.reset", config->consumer_auto_offset_reset,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set auto.offset.reset: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    snprintf(timeout_str, sizeof(timeout_str), "%d", config->consumer_session_timeout_ms);
+    if (rd_kafka_conf_set(conf, "session.timeout.ms", timeout_str,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set session.timeout.ms: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    if (strlen(config->consumer_assignment_strategy) > 0) {
+        if (rd_kafka_conf_set(conf, "partition.assignment.strategy", config->consumer_assignment_strategy,
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set partition.assignment.strategy: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            return NULL;
+        }
+    }
+    
+    /* Per-handle context for callbacks, released by destroy_consumer() */
+    context = (ClientContext *)calloc(1, sizeof(ClientContext));
+    if (context) {
+        context->rebalance = (RebalanceStats *)calloc(1, sizeof(RebalanceStats));
+        if (config->consumer_commit_policy != COMMIT_NONE) {
+            context->commit = (CommitState *)calloc(1, sizeof(CommitState));
+        }
+    }
+    if (!context || !context->rebalance ||
+        (config->consumer_commit_policy != COMMIT_NONE && !context->commit)) {
+        log_message(1, "ERROR", "Failed to allocate consumer context");
+        rd_kafka_conf_destroy(conf);
+        if (context) {
+            free(context->rebalance);
+            free(context->commit);
+        }
+        free(context);
+        return NULL;
+    }
+    context->config = config;
+    context->rebalance->created_ns = get_time_ns();
+    rd_kafka_conf_set_opaque(conf, context);
+    rd_kafka_conf_set_rebalance_cb(conf, rebalance_cb);
+    
+    /* Statistics are parsed off the poll loop by the parser thread */
+    if (config->statistics_interval_ms > 0) {
+        char interval_str[32];
+        snprintf(interval_str, sizeof(interval_str), "%d", config->statistics_interval_ms);
+        rd_kafka_conf_set(conf, "statistics.interval.ms", interval_str, NULL, 0);
+        rd_kafka_conf_set_stats_cb(conf, stats_cb);
+        start_stats_parser();
+    }
+    
+    if (config->consumer_commit_policy != COMMIT_NONE) {
+        /* Explicit commits of offsets stored after handling: auto commit and
+         * auto store would commit messages that were only fetched */
+        if (strcmp(config->consumer_enable_auto_commit, "false") != 0) {
+            log_message(1, "WARNING", "consumer_commit_policy = %s overrides consumer_enable_auto_commit",
+                        commit_policy_names[config->consumer_commit_policy]);
+        }
+        rd_kafka_conf_set(conf, "enable.auto.commit", "false", NULL, 0);
+        rd_kafka_conf_set(conf, "enable.auto.offset.store", "false", NULL, 0);
+        log_message(1, "INFO", "Explicit offset commits: %s",
+                    commit_policy_names[config->consumer_commit_policy]);
+    } else {
+        /* Enable/disable auto commit */
+        if (rd_kafka_conf_set(conf, "enable.auto.commit", config->consumer_enable_auto_commit,
+                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+            log_message(1, "ERROR", "Failed to set enable.auto.commit: %s", errstr);
+            rd_kafka_conf_destroy(conf);
+            free(context->rebalance);
+            free(context);
+            return NULL;
+        }
+        log_message(1, "INFO", "Auto commit enabled: %s", config->consumer_enable_auto_commit);
+    }
+    
+    /* Create consumer */
+    rk = rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr, sizeof(errstr));
+    if (!rk) {
+        log_message(1, "ERROR", "Failed to create consumer: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        free(context->commit);
+        free(context->rebalance);
+        free(context);
+        return NULL;
+    }
+    
+    log_message(1, "INFO", "Consumer created successfully (Group ID: %s)", config->consumer_group_id);
+    return rk;
+}
+
+/*
+ * Destroy a consumer handle and its callback context
+ */
+static void destroy_consumer(rd_kafka_t *rk) {
+    ClientContext *context = (ClientContext *)rd_kafka_opaque(rk);
+    
+    if (context->commit && context->commit->queue) {
+        rd_kafka_queue_destroy(context->commit->queue);
+    }
+    rd_kafka_destroy(rk);
+    drain_statistics();
+    free(context->commit);
+    free(context->rebalance);
+    free(context);
+}
+
+/*
+ * Issue an async commit of all stored offsets
+ */
+static void send_commit(rd_kafka_t *rk, CommitState *commit) {
+    rd_kafka_resp_err_t err;
+    
+    if (!commit->queue) {
+        commit->queue = rd_kafka_queue_get_consumer(rk);
+    }
+    commit->sent++;
+    commit->in_flight = 1;
+    commit->pending = 0;
+    commit->generation++;
+    commit->sent_ns = get_time_ns();
+    err = rd_kafka_commit_queue(rk, NULL, commit->queue, offset_commit_cb, (void *)commit->generation);
+    if (err) {
+        /* Rejected locally, no callback will follow */
+        commit->in_flight = 0;
+        if (err == RD_KAFKA_RESP_ERR__NO_OFFSET) {
+            commit->empty++;
+        } else {
+            commit->failed++;
+            log_message(1, "WARNING", "Offset commit failed: %s", rd_kafka_err2str(err));
+        }
+    }
+}
+
+/*
+ * Commit stored offsets asynchronously. At most one commit is outstanding:
+ * a request made meanwhile is folded into a single follow-up commit, which
+ * then carries the latest stored offset of every partition.
+ */
+static void request_commit(rd_kafka_t *rk, CommitState *commit) {
+    commit->requested++;
+    if (commit->in_flight) {
+        if (commit->pending) {
+            commit->coalesced++;
+        }
+        commit->pending = 1;
+        return;
+    }
+    send_commit(rk, commit);
+}
+
+/*
+ * Commit stored offsets and wait for the result (rebalance and shutdown)
+ */
+static void commit_offsets_sync(rd_kafka_t *rk, CommitState *commit) {
+    rd_kafka_resp_err_t err;
+    int64_t start_ns;
+    
+    /* This covers any requested follow-up; an outstanding async commit stays
+     * in flight and is accounted when its own callback arrives */
+    commit->pending = 0;
+    commit->requested++;
+    commit->sent++;
+    start_ns = get_time_ns();
+    err = rd_kafka_commit(rk, NULL, 0);
+    if (err == RD_KAFKA_RESP_ERR__NO_OFFSET) {
+        commit->empty++;
+    } else if (err) {
+        commit->failed++;
+        log_message(1, "WARNING", "Offset commit failed: %s", rd_kafka_err2str(err));
+    } else {
+        commit->completed++;
+        hist_record(&commit->latency, get_time_ns() - start_ns);
+    }
+}
+
+/*
+ * Apply the commit policy on the polling thread
+ */
+static void maybe_commit(rd_kafka_t *rk, const Config *config, CommitState *commit,
+                         long long consumed, int64_t now_ns) {
+    if (config->consumer_commit_policy == COMMIT_MESSAGES) {
+        if (consumed - commit->last_commit_consumed >= config->consumer_commit_every_messages) {
+            commit->last_commit_consumed = consumed;
+            request_commit(rk, commit);
+        }
+    } else if (config->consumer_commit_policy == COMMIT_INTERVAL) {
+        if (commit->last_commit_ns == 0) {
+            commit->last_commit_ns = now_ns;
+        } else if (now_ns - commit->last_commit_ns >= (int64_t)config->consumer_commit_interval_ms * 1000000LL) {
+            commit->last_commit_ns = now_ns;
+            if (consumed != commit->last_commit_consumed) {
+                commit->last_commit_consumed = consumed;
+                request_commit(rk, commit);
+            }
+        }
+    }
+}
+
+/*
+ * Async offset commit result (served from the consumer poll call); the
+ * commit opaque is the generation send_commit() tagged it with
+ */
+static void offset_commit_cb(rd_kafka_t *rk, rd_kafka_resp_err_t err,
+                             rd_kafka_topic_partition_list_t *offsets, void *commit_opaque) {
+    CommitState *commit = ((ClientContext *)rd_kafka_opaque(rk))->commit;
+    int i;
+    
+    if (!commit->in_flight || (uintptr_t)commit_opaque != commit->generation) {
+        log_message(1, "WARNING", "Ignoring the result of an unknown offset commit");
+        return;
+    }
+    
+    commit->in_flight = 0;
+    hist_record(&commit->latency, get_time_ns() - commit->sent_ns);
+    if (err == RD_KAFKA_RESP_ERR__NO_OFFSET) {
+        commit->empty++;
+    } else if (err) {
+        commit->failed++;
+        log_message(1, "WARNING", "Offset commit failed: %s", rd_kafka_err2str(err));
+    } else {
+        commit->completed++;
+        for (i = 0; offsets && i < offsets->cnt; i++) {
+            if (offsets->elems[i].err) {
+                log_message(1, "WARNING", "Offset commit failed for partition %d: %s",
+                            (int)offsets->elems[i].partition,
+                            rd_kafka_err2str(offsets->elems[i].err));
+            } else {
+                commit->partitions++;
+            }
+        }
+    }
+    
+    if (commit->pending) {
+        send_commit(rk, commit);
+    }
+}
+
+/*
+ * Group rebalance: log and apply the change (incrementally for the
+ * cooperative protocol), committing what was handled before giving
+ * partitions up. The first message afterwards closes the pause window.
+ */
+static void rebalance_cb(rd_kafka_t *rk, rd_kafka_resp_err_t err,
+                         rd_kafka_topic_partition_list_t *partitions, void *opaque) {
+    ClientContext *context = (ClientContext *)opaque;
+    RebalanceStats *rebalance = context->rebalance;
+    const char *protocol = rd_kafka_rebalance_protocol(rk);
+    int cooperative = protocol && strcmp(protocol, "COOPERATIVE") == 0;
+    rd_kafka_error_t *error = NULL;
+    char list[256];
+    int lost = 0;
+    
+    format_partition_list(partitions, list, sizeof(list));
+    
+    /* Messages stop when this starts; the pause runs from the last one */
+    if (!rebalance->window_open && rebalance->last_message_ns > 0) {
+        rebalance->window_open = 1;
+        rebalance->window_start_ns = rebalance->last_message_ns;
+    }
+    
+    if (err == RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS) {
+        rebalance->assign_events++;
+        if (cooperative) {
+            error = rd_kafka_incremental_assign(rk, partitions);
+            rebalance->assigned += partitions->cnt;
+        } else {
+            rd_kafka_assign(rk, partitions);
+            rebalance->assigned = partitions->cnt;
+        }
+        log_message(1, "INFO", "%s%sRebalance at +%.3f s: assigned %d partitions [%s] (%s), %d now",
+                    context->name, context->name[0] ? ": " : "",
+                    (double)(get_time_ns() - rebalance->created_ns) / 1e9, partitions->cnt, list,
+                    cooperative ? "cooperative" : "eager", rebalance->assigned);
+    } else {
+        if (err == RD_KAFKA_RESP_ERR__REVOKE_PARTITIONS) {
+            rebalance->revoke_events++;
+            lost = rd_kafka_assignment_lost(rk);
+            if (lost) {
+                rebalance->lost_events++;
+            }
+        } else {
+            log_message(1, "ERROR", "%s%sRebalance failed: %s", context->name,
+                        context->name[0] ? ": " : "", rd_kafka_err2str(err));
+        }
+        
+        /* Lost partitions may already belong to someone else: do not commit */
+        if (context->commit && !lost) {
+            commit_offsets_sync(rk, context->commit);
+        }
+        if (cooperative) {
+            error = rd_kafka_incremental_unassign(rk, partitions);
+            rebalance->assigned -= partitions->cnt;
+        } else {
+            rd_kafka_assign(rk, NULL);
+            rebalance->assigned = 0;
+        }
+        log_message(1, "INFO", "%s%sRebalance at +%.3f s: revoked %d partitions [%s] (%s%s), %d left",
+                    context->name, context->name[0] ? ": " : "",
+                    (double)(get_time_ns() - rebalance->created_ns) / 1e9, partitions->cnt, list,
+                    cooperative ? "cooperative" : "eager", lost ? ", assignment lost" : "",
+                    rebalance->assigned);
+    }
+    
+    if (error) {
+        log_message(1, "ERROR", "Incremental %s failed: %s",
+                    err == RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS ? "assign" : "unassign",
+                    rd_kafka_error_string(error));
+        rd_kafka_error_destroy(error);
+    }
+}
+
+/*
+ * Format partition ids as "0,1,2" (truncated with "..." if too long)
+ */
+static void format_partition_list(const rd_kafka_topic_partition_list_t *list, char *buffer, size_t size) {
+    size_t used = 0;
+    int i, written;
+    
+    buffer[0] = '\0';
+    for (i = 0; list && i < list->cnt; i++) {
+        written = snprintf(buffer + used, size - used, "%s%d", i > 0 ? "," : "",
+                           (int)list->elems[i].partition);
+        if (written < 0 || (size_t)written >= size - used) {
+            if (size > 4) {
+                strcpy(buffer + size - 4, "...");
+            }
+            return;
+        }
+        used += (size_t)written;
+    }
+}
+
+/*
+ * Called by the polling thread when messages arrive: records the pause if
+ * a rebalance happened since the previous message
+ */
+static void note_message_flow(ClientContext *context, int64_t now_ns) {
+    RebalanceStats *rebalance = context->rebalance;
+    
+    if (rebalance->window_open) {
+        rebalance->window_open = 0;
+        hist_record(&rebalance->pause, now_ns - rebalance->window_start_ns);
+        log_message(1, "INFO", "%s%sRebalance pause: %.1f ms without messages",
+                    context->name, context->name[0] ? ": " : "",
+                    (double)(now_ns - rebalance->window_start_ns) / 1e6);
+    }
+    rebalance->last_message_ns = now_ns;
+}
+
+/*
+ * Print rebalance counts and the message-flow pauses they caused
+ */
+static void print_rebalance_summary(const RebalanceStats *rebalance) {
+    if (rebalance->assign_events == 0 && rebalance->revoke_events == 0) {
+        return;
+    }
+    log_message(1, "INFO", "Rebalances: %lld assign, %lld revoke (%lld lost) events, %d partitions assigned",
+                rebalance->assign_events, rebalance->revoke_events, rebalance->lost_events,
+                rebalance->assigned);
+    if (rebalance->pause.total_count > 0) {
+        log_latency_percentiles("Rebalance pause", &rebalance->pause);
+    }
+}
+
+/*
+ * Extra group member for consumer_rebalance_churn_sec: joins, consumes
+ * (without committing) and leaves again, so the main consumer goes
+ * through a rebalance each time
+ */
+static thread_ret_t THREAD_CALL churn_member_main(void *arg) {
+    const Config *config = (const Config *)arg;
+    rd_kafka_topic_partition_list_t *topics;
+    rd_kafka_message_t *rkmessage;
+    ClientContext *context;
+    rd_kafka_t *rk;
+    int64_t phase_end_ns;
+    long long taken;
+    int round = 0;
+    
+    while (run) {
+        /* Out of the group for one period, then in it for one */
+        phase_end_ns = get_time_ns() + (int64_t)config->consumer_rebalance_churn_sec * 1000000000LL;
+        while (run && get_time_ns() < phase_end_ns) {
+            sleep_ms(100);
+        }
+        if (!run) {
+            break;
+        }
+        
+        rk = create_consumer(config);
+        if (!rk) {
+            break;
+        }
+        context = (ClientContext *)rd_kafka_opaque(rk);
+        snprintf(context->name, sizeof(context->name), "churn member %d", ++round);
+        topics = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(topics, config->topic, RD_KAFKA_PARTITION_UA);
+        rd_kafka_subscribe(rk, topics);
+        rd_kafka_topic_partition_list_destroy(topics);
+        
+        taken = 0;
+        phase_end_ns = get_time_ns() + (int64_t)config->consumer_rebalance_churn_sec * 1000000000LL;
+        while (run && get_time_ns() < phase_end_ns) {
+            rkmessage = rd_kafka_consumer_poll(rk, 100);
+            if (rkmessage) {
+                if (!rkmessage->err) {
+                    taken++;
+                }
+                rd_kafka_message_destroy(rkmessage);
+            }
+        }
+        
+        log_message(1, "INFO", "%s leaving the group after taking %lld messages", context->name, taken);
+        rd_kafka_consumer_close(rk);
+        destroy_consumer(rk);
+    }
+    return 0;
+}
+
+/*
+ * Print commit counters and latency
+ */
+static void print_commit_summary(const CommitState *commit, int64_t elapsed_ns) {
+    double elapsed_sec = (double)elapsed_ns / 1e9;
+    
+    if (elapsed_sec <= 0.0) {
+        elapsed_sec = 1e-9;
+    }
+    
+    log_message(1, "INFO", "Commits: %lld requested, %lld sent (%.2f/s), %lld coalesced, "
+                "%lld completed, %lld empty, %lld failed, %lld partition offsets",
+                commit->requested, commit->sent, (double)commit->sent / elapsed_sec,
+                commit->coalesced, commit->completed, commit->empty, commit->failed,
+                commit->partitions);
+    if (commit->latency.total_count > 0) {
+        log_latency_percentiles("Commit latency", &commit->latency);
+    }
+}
+
+/*
+ * Print producer run summary
+ */
+static void print_producer_summary(const ProducerStats *stats, int64_t elapsed_ns) {
+    double elapsed_sec = (double)elapsed_ns / 1e9;
+    
+    if (elapsed_sec <= 0.0) {
+        elapsed_sec = 1e-9;
+    }
+    
+    log_message(1, "INFO", "=== Producer Summary ===");
+    log_message(1, "INFO", "Messages: %lld produced, %lld delivered, %lld failed, "
+                "%lld dropped (queue full), %lld rejected",
+                stats->produced, stats->delivered, stats->failed,
+                stats->dropped, stats->produce_errors);
+    log_message(1, "INFO", "Elapsed: %.3f s, throughput: %.1f msg/s, %.3f MB/s",
+                elapsed_sec, (double)stats->delivered / elapsed_sec,
+                (double)stats->bytes_delivered / (1024.0 * 1024.0) / elapsed_sec);
+    if (stats->delivered > 0) {
+        log_message(1, "INFO", "Client CPU: %.3f s (%.1f%% of one core, %.2f us/msg)",
+                    (double)stats->cpu_ns / 1e9, 100.0 * (double)stats->cpu_ns / 1e9 / elapsed_sec,
+                    (double)stats->cpu_ns / 1e3 / (double)stats->delivered);
+    }
+    if (stats->wire_bytes > 0) {
+        log_message(1, "INFO", "Bytes on the wire: %.3f MB, compression ratio %.2f",
+                    (double)stats->wire_bytes / (1024.0 * 1024.0),
+                    (double)stats->bytes_delivered / (double)stats->wire_bytes);
+    }
+    if (stats->delivered > 0) {
+        log_latency_percentiles("Ack latency (enqueue)", &stats->ack_latency);
+        log_latency_percentiles("Ack latency (intended send)", &stats->intended_latency);
+    }
+    log_message(1, "INFO", "Local queue full: %lld times, stalled %.3f s total, longest %.3f ms",
+                stats->queue_full_events, (double)stats->queue_full_stall_ns / 1e9,
+                (double)stats->queue_full_max_stall_ns / 1e6);
+    if (stats->slot_wait_ns > 0) {
+        log_message(1, "INFO", "Waited %.3f s for free payload buffers (raise producer_payload_count)",
+                    (double)stats->slot_wait_ns / 1e9);
+    }
+    log_message(1, "INFO", "Max schedule lag: %.3f ms", (double)stats->max_schedule_lag_ns / 1e6);
+    print_partition_summary(stats);
+    log_message(1, "INFO", "========================");
+}
+
+/*
+ * Print per-partition delivery counts and ack latency, and how uneven they are
+ */
+static void print_partition_summary(const ProducerStats *stats) {
+    long long max_messages = 0;
+    int partitions = 0;
+    int i;
+    
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (stats->partition_messages[i] > 0) {
+            partitions++;
+            if (stats->partition_messages[i] > max_messages) {
+                max_messages = stats->partition_messages[i];
+            }
+        }
+    }
+    if (partitions == 0 || stats->delivered == 0) {
+        return;
+    }
+    
+    /* Skew 1.0 = perfectly even; the hottest partition bounds throughput */
+    log_message(1, "INFO", "Partitions: %d, skew (hottest / mean): %.2f", partitions,
+                (double)max_messages * partitions / (double)stats->delivered);
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (stats->partition_messages[i] == 0) {
+            continue;
+        }
+        log_message(1, "INFO", "  Partition %d%s: %lld msgs (%.1f%%), %.3f MB, ack avg %.3f ms, max %.3f ms",
+                    i, i == MAX_TRACKED_PARTITIONS - 1 ? "+" : "", stats->partition_messages[i],
+                    100.0 * (double)stats->partition_messages[i] / (double)stats->delivered,
+                    (double)stats->partition_bytes[i] / (1024.0 * 1024.0),
+                    (double)stats->partition_latency_sum_ns[i] / (double)stats->partition_messages[i] / 1e6,
+                    (double)stats->partition_latency_max_ns[i] / 1e6);
+    }
+}
+
+/*
+ * Log throughput and ack latency for the interval since the last report
+ */
+static void report_producer_progress(ProducerStats *stats, ProducerProgress *progress,
+                                     int64_t now_ns) {
+    long long delivered = ATOMIC_LOAD(&stats->delivered);
+    long long bytes = ATOMIC_LOAD(&stats->bytes_delivered);
+    double interval_sec = (double)(now_ns - progress->last_report_ns) / 1e9;
+    
+    if (interval_sec <= 0.0) {
+        return;
+    }
+    
+    hist_delta(&stats->ack_latency, &progress->last_ack_latency, &progress->interval_latency);
+    
+    log_message(1, "INFO", "[%.1f s] %.1f msg/s, %.3f MB/s, ack p50 %.3f ms, p99 %.3f ms, "
+                "p99.9 %.3f ms, max %.3f ms, failed %lld, dropped %lld, queue full stall %.3f s",
+                (double)(now_ns - progress->start_ns) / 1e9,
+                (double)(delivered - progress->last_delivered) / interval_sec,
+                (double)(bytes - progress->last_bytes) / (1024.0 * 1024.0) / interval_sec,
+                (double)hist_percentile(&progress->interval_latency, 50.0) / 1e6,
+                (double)hist_percentile(&progress->interval_latency, 99.0) / 1e6,
+                (double)hist_percentile(&progress->interval_latency, 99.9) / 1e6,
+                (double)progress->interval_latency.max_value / 1e6,
+                ATOMIC_LOAD(&stats->failed), ATOMIC_LOAD(&stats->dropped),
+                (double)ATOMIC_LOAD(&stats->queue_full_stall_ns) / 1e9);
+    
+    progress->last_report_ns = now_ns;
+    progress->last_delivered = delivered;
+    progress->last_bytes = bytes;
+}
+
+/*
+ * Flush a producer handle, purging anything that does not complete so that
+ * no delivery report can fire after the tracking slots and payload arena
+ * are freed
+ */
+static void flush_producer(rd_kafka_t *rk) {
+    rd_kafka_flush(rk, 10000);
+    
+    if (rd_kafka_outq_len(rk) > 0) {
+        log_message(1, "WARNING", "%d messages still queued after flush, purging",
+                    rd_kafka_outq_len(rk));
+        rd_kafka_purge(rk, RD_KAFKA_PURGE_F_QUEUE | RD_KAFKA_PURGE_F_INFLIGHT);
+        rd_kafka_flush(rk, 1000);
+    }
+}
+
+/*
+ * Destroy a producer handle and its callback context
+ */
+static void destroy_producer(rd_kafka_t *rk) {
+    ClientContext *context = (ClientContext *)rd_kafka_opaque(rk);
+    
+    rd_kafka_destroy(rk);
+    drain_statistics();
+    free(context);
+}
+
+/*
+ * Serve callbacks until the next statistics report arrives, so counters
+ * taken from it cover everything sent so far
+ */
+static void wait_for_statistics(rd_kafka_t *rk, int interval_ms) {
+    ClientContext *context = (ClientContext *)rd_kafka_opaque(rk);
+    int reports = ATOMIC_LOAD(&context->stats_reports);
+    int64_t deadline_ns = get_time_ns() + (int64_t)interval_ms * 2 * 1000000LL;
+    
+    while (ATOMIC_LOAD(&context->stats_reports) == reports && get_time_ns() < deadline_ns) {
+        rd_kafka_poll(rk, 10);
+    }
+}
+
+/*
+ * Parse a payload size distribution name
+ * Returns -1 if the name is unknown
+ */
+static int parse_payload_size_distribution(const char *value) {
+    int i;
+    
+    for (i = 0; i < PAYLOAD_SIZE_DISTRIBUTION_COUNT; i++) {
+        if (strcmp(value, payload_size_distribution_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Parse a payload content type name
+ * Returns -1 if the name is unknown
+ */
+static int parse_payload_content(const char *value) {
+    int i;
+    
+    for (i = 0; i < PAYLOAD_CONTENT_COUNT; i++) {
+        if (strcmp(value, payload_content_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Parse a key distribution name
+ * Returns -1 if the name is unknown
+ */
+static int parse_key_distribution(const char *value) {
+    int i;
+    
+    for (i = 0; i < KEY_DIST_COUNT; i++) {
+        if (strcmp(value, key_distribution_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Build the cumulative Zipf distribution over key_space keys, so drawing a
+ * key is one uniform random number and a binary search
+ * Returns NULL on allocation failure
+ */
+static double *build_zipf_cdf(int key_space, double exponent) {
+    double *cdf = (double *)malloc((size_t)key_space * sizeof(double));
+    double sum = 0.0;
+    int i;
+    
+    if (!cdf) {
+        return NULL;
+    }
+    for (i = 0; i < key_space; i++) {
+        sum += 1.0 / pow((double)(i + 1), exponent);
+        cdf[i] = sum;
+    }
+    for (i = 0; i < key_space; i++) {
+        cdf[i] /= sum;
+    }
+    return cdf;
+}
+
+/*
+ * Pick the key index for a message according to key_distribution
+ */
+static long long next_key_index(ProducerWorker *worker, long long sequence) {
+    const ProducerEngine *engine = worker->engine;
+    const Config *config = engine->config;
+    double u;
+    int low, high, mid;
+    
+    switch (config->key_distribution) {
+    case KEY_DIST_UNIFORM:
+        return (long long)(rng_next(&worker->key_rng) % (uint64_t)config->key_space);
+    case KEY_DIST_SEQUENTIAL:
+        return sequence % config->key_space;
+    case KEY_DIST_ZIPF:
+        /* First key whose cumulative probability reaches u */
+        u = rng_uniform(&worker->key_rng);
+        low = 0;
+        high = config->key_space - 1;
+        while (low < high) {
+            mid = low + (high - low) / 2;
+            if (engine->key_cdf[mid] < u) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Write "key-<index>" into buf (at least MAX_KEY_LENGTH_BYTES) without printf
+ * Returns the key length
+ */
+static size_t format_key(char *buf, long long index) {
+    char digits[20];
+    size_t count = 0, len = 4;
+    
+    memcpy(buf, "key-", 4);
+    do {
+        digits[count++] = (char)('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+    while (count > 0) {
+        buf[len++] = digits[--count];
+    }
+    return len;
+}
+
+/*
+ * xorshift64* pseudo-random generator (fast, good enough for payloads)
+ */
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * Uniform random double in [0, 1)
+ */
+static double rng_uniform(uint64_t *state) {
+    return (double)(rng_next(state) >> 11) / 9007199254740992.0;
+}
+
+/*
+ * Draw one payload size from the configured distribution.
+ * Results are clamped to [payload_size_min, payload_size_max] (except for
+ * fixed sizes) and never below the payload header.
+ */
+static int draw_payload_size(const Config *config, uint64_t *rng) {
+    double size;
+    double sum = 0.0;
+    int i;
+    
+    switch (config->payload_size_distribution) {
+    case PAYLOAD_SIZE_UNIFORM:
+        size = config->payload_size_min +
+               rng_uniform(rng) * (double)(config->payload_size_max - config->payload_size_min + 1);
+        break;
+    case PAYLOAD_SIZE_NORMAL:
+        /* Irwin-Hall: the sum of 12 uniforms minus 6 is close to a standard normal */
+        for (i = 0; i < 12; i++) {
+            sum += rng_uniform(rng);
+        }
+        size = config->producer_message_size + (sum - 6.0) *
+               (config->payload_size_stddev > 0 ? config->payload_size_stddev
+                                                : config->producer_message_size / 4.0);
+        break;
+    case PAYLOAD_SIZE_BIMODAL:
+        size = rng_uniform(rng) * 100.0 < config->payload_bimodal_large_pct
+               ? config->payload_size_max : config->payload_size_min;
+        break;
+    default:
+        size = config->producer_message_size;
+        break;
+    }
+    
+    if (config->payload_size_distribution != PAYLOAD_SIZE_FIXED) {
+        if (size < config->payload_size_min) size = config->payload_size_min;
+        if (size > config->payload_size_max) size = config->payload_size_max;
+    }
+    if (size < PAYLOAD_HEADER_SIZE) {
+        size = PAYLOAD_HEADER_SIZE;
+    }
+    return (int)size;
+}
+
+/*
+ * Fill a buffer with random bytes, one 64-bit word per generator step
+ */
+static void fill_random(unsigned char *buf, size_t len, uint64_t *rng) {
+    size_t pos = 0;
+    uint64_t word;
+    
+    while (pos + sizeof(word) <= len) {
+        word = rng_next(rng);
+        memcpy(buf + pos, &word, sizeof(word));
+        pos += sizeof(word);
+    }
+    if (pos < len) {
+        word = rng_next(rng);
+        memcpy(buf + pos, &word, len - pos);
+    }
+}
+
+/*
+ * Fill a buffer by repeating a pattern, doubling the filled prefix with
+ * memcpy so large buffers take O(log n) copies
+ */
+static void fill_repeat(unsigned char *buf, size_t len, const char *pattern) {
+    size_t filled = strlen(pattern);
+    
+    if (filled > len) {
+        filled = len;
+    }
+    memcpy(buf, pattern, filled);
+    while (filled < len) {
+        size_t chunk = filled < len - filled ? filled : len - filled;
+        memcpy(buf + filled, buf, chunk);
+        filled += chunk;
+    }
+}
+
+/*
+ * Append one word: a dictionary word with probability compressibility/100,
+ * otherwise random characters. Returns the new position.
+ */
+static size_t append_token(unsigned char *buf, size_t pos, size_t len,
+                           const Config *config, uint64_t *rng) {
+    static const char *dictionary[] = {
+        "kafka", "broker", "topic", "partition", "offset", "producer", "consumer",
+        "message", "record", "event", "stream", "cluster", "leader", "replica",
+        "commit", "batch", "latency", "throughput", "order", "customer", "payment",
+        "status", "created", "updated", "active", "pending", "completed", "region",
+        "europe", "america", "asia", "value"
+    };
+    static const char charset[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_";
+    
+    if (rng_uniform(rng) * 100.0 < config->payload_compressibility) {
+        const char *word = dictionary[rng_next(rng) % (sizeof(dictionary) / sizeof(dictionary[0]))];
+        while (*word && pos < len) {
+            buf[pos++] = (unsigned char)*word++;
+        }
+    } else {
+        uint64_t bits = rng_next(rng);
+        int count = 4 + (int)(bits & 7);
+        
+        bits >>= 3;
+        while (count-- > 0 && pos < len) {
+            buf[pos++] = (unsigned char)charset[bits & 63];
+            bits >>= 6;
+        }
+    }
+    return pos;
+}
+
+/*
+ * Generate payload content of the configured type. payload_compressibility
+ * (0-100) sets the share of repetitive content: repeated blocks for random
+ * content, dictionary words versus random tokens for text and JSON.
+ */
+static void generate_payload(unsigned char *buf, size_t len, const Config *config, uint64_t *rng) {
+    size_t pos = 0;
+    
+    switch (config->payload_content) {
+    case PAYLOAD_CONTENT_RANDOM:
+        /* Every 512-byte block: a repeated run, then random bytes */
+        while (pos < len) {
+            size_t block = len - pos < 512 ? len - pos : 512;
+            size_t repeated = block * (size_t)config->payload_compressibility / 100;
+            
+            if (repeated > block) {
+                repeated = block;
+            }
+            fill_repeat(buf + pos, repeated, "KAFKA-CLI-");
+            fill_random(buf + pos + repeated, block - repeated, rng);
+            pos += block;
+        }
+        break;
+    case PAYLOAD_CONTENT_JSON:
+        while (pos < len) {
+            char number[48];
+            size_t n = (size_t)snprintf(number, sizeof(number), "{\"id\":%u,\"user\":\"",
+                                        (unsigned int)(rng_next(rng) % 1000000));
+            size_t i;
+            
+            for (i = 0; i < n && pos < len; i++) buf[pos++] = (unsigned char)number[i];
+            pos = append_token(buf, pos, len, config, rng);
+            for (i = 0; i < 11 && pos < len; i++) buf[pos++] = (unsigned char)"\",\"event\":\""[i];
+            pos = append_token(buf, pos, len, config, rng);
+            n = (size_t)snprintf(number, sizeof(number), "\",\"value\":%u.%02u}\n",
+                                 (unsigned int)(rng_next(rng) % 100000),
+                                 (unsigned int)(rng_next(rng) % 100));
+            for (i = 0; i < n && pos < len; i++) buf[pos++] = (unsigned char)number[i];
+        }
+        break;
+    default:
+        while (pos < len) {
+            pos = append_token(buf, pos, len, config, rng);
+            if (pos < len) {
+                buf[pos++] = ' ';
+            }
+        }
+        break;
+    }
+}
+
+/*
+ * Allocate a producer thread's payload arena: draw every slot's size from
+ * the configured distribution, then generate content once behind the
+ * header area. Returns the arena size in bytes, or 0 on allocation failure.
+ */
+static size_t build_payload_arena(ProducerWorker *worker, const Config *config,
+                                  int payload_count, uint64_t seed) {
+    uint64_t rng = seed ? seed : 1;
+    size_t total = 0;
+    size_t offset = 0;
+    int j;
+    
+    for (j = 0; j < payload_count; j++) {
+        worker->slots[j].payload_len = (size_t)draw_payload_size(config, &rng);
+        total += worker->slots[j].payload_len;
+    }
+    
+    worker->arena = (unsigned char *)malloc(total);
+    if (!worker->arena) {
+        return 0;
+    }
+    
+    for (j = 0; j < payload_count; j++) {
+        MsgSlot *slot = &worker->slots[j];
+        slot->payload = worker->arena + offset;
+        generate_payload(slot->payload + PAYLOAD_HEADER_SIZE,
+                         slot->payload_len - PAYLOAD_HEADER_SIZE, config, &rng);
+        offset += slot->payload_len;
+    }
+    return total;
+}
+
+/*
+ * Hand a slot's payload to librdkafka (zero-copy: the buffer stays ours
+ * until the delivery report fires)
+ */
+static rd_kafka_resp_err_t produce_slot(rd_kafka_t *rk, const char *topic, MsgSlot *slot) {
+    return rd_kafka_producev(
+        rk,
+        RD_KAFKA_V_TOPIC(topic),
+        RD_KAFKA_V_VALUE(slot->payload, slot->payload_len),
+        RD_KAFKA_V_MSGFLAGS(0),
+        RD_KAFKA_V_KEY(slot->key_len > 0 ? slot->key : NULL, slot->key_len),
+        RD_KAFKA_V_OPAQUE(slot),
+        RD_KAFKA_V_END
+    );
+}
+
+/*
+ * Producer thread: claims sequence numbers and send times from the shared
+ * engine until the message budget is used up
+ */
+static thread_ret_t THREAD_CALL producer_thread_main(void *arg) {
+    ProducerWorker *worker = (ProducerWorker *)arg;
+    ProducerEngine *engine = worker->engine;
+    const Config *config = engine->config;
+    rd_kafka_t *rk = worker->rk;
+    ProducerStats *stats = worker->stats;
+    rd_kafka_resp_err_t err;
+    size_t message_len;
+    PayloadHeader header;
+    MsgSlot *slot;
+    long long sequence;
+    long long local_count = 0;
+    int64_t intended_ns, now_ns, step_ns, stall_start_ns;
+    int attempts;
+    
+    header.producer_id = engine->producer_id;
+    
+    while ((sequence = ATOMIC_ADD(&engine->next_sequence, 1)) < engine->message_limit) {
+        if (engine->deadline_ns > 0 && get_time_ns() >= engine->deadline_ns) {
+            break;
+        }
+        
+        /* Slot is still owned by an undelivered message: wait for its report */
+        slot = &worker->slots[local_count++ % engine->payload_count];
+        if (ATOMIC_LOAD_ACQUIRE(&slot->in_flight)) {
+            stall_start_ns = get_time_ns();
+            while (ATOMIC_LOAD_ACQUIRE(&slot->in_flight)) {
+                rd_kafka_poll(rk, 1);
+            }
+            ATOMIC_ADD(&stats->slot_wait_ns, get_time_ns() - stall_start_ns);
+        }
+        message_len = slot->payload_len;
+        
+        if (engine->paced) {
+            /* Claim the next slot on the shared schedule; the tighter limit wins */
+            step_ns = (int64_t)engine->msg_interval_ns;
+            if ((int64_t)(engine->byte_interval_ns * (double)message_len) > step_ns) {
+                step_ns = (int64_t)(engine->byte_interval_ns * (double)message_len);
+            }
+            intended_ns = ATOMIC_ADD(&engine->next_send_ns, step_ns);
+            wait_until_ns(rk, intended_ns);
+            now_ns = get_time_ns();
+            atomic_max_i64(&stats->max_schedule_lag_ns, now_ns - intended_ns);
+        } else {
+            now_ns = get_time_ns();
+            intended_ns = now_ns;
+        }
+        if (config->key_distribution != KEY_DIST_NONE) {
+            slot->key_len = format_key(slot->key, next_key_index(worker, sequence));
+        }
+        slot->intended_ns = intended_ns;
+        slot->enqueue_ns = now_ns;
+        ATOMIC_STORE(&slot->in_flight, 1);
+        
+        /* Stamp the header last so the send time is as close to enqueue as possible */
+        header.sequence = (uint64_t)sequence;
+        header.send_time_ns = get_wall_time_ns();
+        encode_payload_header(slot->payload, &header);
+        
+        err = produce_slot(rk, config->topic, slot);
+        
+        /* Local queue full: apply the backpressure policy, serving delivery reports to make room */
+        if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+            ATOMIC_ADD(&stats->queue_full_events, 1);
+            stall_start_ns = get_time_ns();
+            attempts = 0;
+            while (err == RD_KAFKA_RESP_ERR__QUEUE_FULL &&
+                   config->producer_queue_full_policy != QUEUE_FULL_DROP &&
+                   (config->producer_queue_full_policy == QUEUE_FULL_BLOCK ||
+                    attempts++ < config->producer_queue_full_retries)) {
+                rd_kafka_poll(rk, 1);
+                slot->enqueue_ns = get_time_ns();
+                header.send_time_ns = get_wall_time_ns();
+                encode_payload_header(slot->payload, &header);
+                err = produce_slot(rk, config->topic, slot);
+            }
+            now_ns = get_time_ns() - stall_start_ns;
+            ATOMIC_ADD(&stats->queue_full_stall_ns, now_ns);
+            atomic_max_i64(&stats->queue_full_max_stall_ns, now_ns);
+        }
+        
+        if (err) {
+            ATOMIC_STORE(&slot->in_flight, 0);
+            if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                ATOMIC_ADD(&stats->dropped, 1);
+                log_message(config->verbose, "DEBUG", "Dropped message %lld: local queue full",
+                            sequence + 1);
+            } else {
+                ATOMIC_ADD(&stats->produce_errors, 1);
+                log_message(1, "ERROR", "Failed to produce message %lld: %s",
+                            sequence + 1, rd_kafka_err2str(err));
+            }
+        } else {
+            ATOMIC_ADD(&stats->produced, 1);
+            log_message(config->verbose, "DEBUG", "Produced message %lld/%d (%d bytes)",
+                        sequence + 1, config->message_count, (int)message_len);
+        }
+        
+        /* Poll for delivery reports */
+        rd_kafka_poll(rk, 0);
+    }
+    
+    /* A shared handle is flushed once by the engine after all threads finish */
+    if (!config->producer_shared_handle) {
+        flush_producer(rk);
+    }
+    
+    worker->finish_ns = get_time_ns();
+    ATOMIC_ADD(&engine->active_workers, -1);
+    return 0;
+}
+
+/*
+ * Sum per-thread statistics into a single view
+ */
+static void collect_producer_stats(ProducerStats *merged, ProducerWorker *workers, int count) {
+    int i, j;
+    
+    memset(merged, 0, sizeof(*merged));
+    for (i = 0; i < count; i++) {
+        const ProducerStats *stats = workers[i].stats;
+        
+        merged->produced += ATOMIC_LOAD(&stats->produced);
+        merged->delivered += ATOMIC_LOAD(&stats->delivered);
+        merged->failed += ATOMIC_LOAD(&stats->failed);
+        merged->bytes_delivered += ATOMIC_LOAD(&stats->bytes_delivered);
+        merged->dropped += ATOMIC_LOAD(&stats->dropped);
+        merged->produce_errors += ATOMIC_LOAD(&stats->produce_errors);
+        merged->queue_full_events += ATOMIC_LOAD(&stats->queue_full_events);
+        merged->queue_full_stall_ns += ATOMIC_LOAD(&stats->queue_full_stall_ns);
+        merged->slot_wait_ns += ATOMIC_LOAD(&stats->slot_wait_ns);
+        if (ATOMIC_LOAD(&stats->queue_full_max_stall_ns) > merged->queue_full_max_stall_ns) {
+            merged->queue_full_max_stall_ns = ATOMIC_LOAD(&stats->queue_full_max_stall_ns);
+        }
+        if (ATOMIC_LOAD(&stats->max_schedule_lag_ns) > merged->max_schedule_lag_ns) {
+            merged->max_schedule_lag_ns = ATOMIC_LOAD(&stats->max_schedule_lag_ns);
+        }
+        hist_merge(&merged->ack_latency, &stats->ack_latency);
+        hist_merge(&merged->intended_latency, &stats->intended_latency);
+        for (j = 0; j < MAX_TRACKED_PARTITIONS; j++) {
+            merged->partition_messages[j] += ATOMIC_LOAD(&stats->partition_messages[j]);
+            merged->partition_bytes[j] += ATOMIC_LOAD(&stats->partition_bytes[j]);
+            merged->partition_latency_sum_ns[j] += ATOMIC_LOAD(&stats->partition_latency_sum_ns[j]);
+            if (ATOMIC_LOAD(&stats->partition_latency_max_ns[j]) > merged->partition_latency_max_ns[j]) {
+                merged->partition_latency_max_ns[j] = ATOMIC_LOAD(&stats->partition_latency_max_ns[j]);
+            }
+        }
+    }
+}
+
+/*
+ * Produce messages to Kafka
+ *
+ * With a target rate configured the producer runs open-loop: every message
+ * has an intended send time on a fixed schedule, independent of how fast
+ * the broker acknowledges. Latency is measured from that intended time, so
+ * a stalled broker shows up as latency instead of a silently lower send rate.
+ *
+ * producer_threads threads share the message budget and the schedule; each
+ * drives its own client handle unless producer_shared_handle is set. The
+ * calling thread only reports progress. Merged statistics are copied to
+ * totals when it is not NULL.
+ */
+static int produce_messages(const Config *config, ProducerStats *totals, RunResult *run_result) {
+    ProducerEngine engine;
+    ProducerWorker *workers;
+    ProducerStats *merged;
+    ProducerProgress *progress;
+    rd_kafka_t *shared_rk = NULL;
+    int thread_count = config->producer_threads > 0 ? config->producer_threads : 1;
+    int64_t report_interval_ns = (int64_t)config->report_interval_sec * 1000000000LL;
+    int64_t now_ns, end_ns, start_cpu_ns;
+    long long attempted;
+    size_t arena_size, total_arena_size = 0;
+    Dashboard dashboard;
+    char label[64];
+    int result = 0;
+    int i, j;
+    
+    memset(&engine, 0, sizeof(engine));
+    memset(&dashboard, 0, sizeof(dashboard));
+    engine.config = config;
+    engine.producer_id = config->producer_id > 0 ? (uint32_t)config->producer_id : get_process_id();
+    if (config->producer_rate_msgs > 0) {
+        engine.msg_interval_ns = 1e9 / (double)config->producer_rate_msgs;
+    }
+    if (config->producer_rate_mb > 0.0) {
+        engine.byte_interval_ns = 1e9 / (config->producer_rate_mb * 1024.0 * 1024.0);
+    }
+    engine.paced = engine.msg_interval_ns > 0.0 || engine.byte_interval_ns > 0.0;
+    if (config->producer_message_size < PAYLOAD_HEADER_SIZE ||
+        config->payload_size_min < PAYLOAD_HEADER_SIZE) {
+        log_message(1, "WARNING", "Payload sizes below the %d byte payload header are raised to %d",
+                    PAYLOAD_HEADER_SIZE, PAYLOAD_HEADER_SIZE);
+    }
+    engine.payload_count = config->producer_payload_count > 0 ? config->producer_payload_count : 1;
+    if (config->key_distribution != KEY_DIST_NONE && config->key_space <= 0) {
+        log_message(1, "ERROR", "key_space must be positive when keys are enabled");
+        return 1;
+    }
+    if (config->key_distribution == KEY_DIST_ZIPF) {
+        engine.key_cdf = build_zipf_cdf(config->key_space, config->key_zipf_exponent);
+        if (!engine.key_cdf) {
+            log_message(1, "ERROR", "Failed to allocate Zipf table for %d keys", config->key_space);
+            return 1;
+        }
+    }
+    engine.message_limit = config->message_count;
+    if (config->producer_duration_sec > 0 && config->message_count <= 0) {
+        engine.message_limit = LLONG_MAX;
+    }
+    
+    workers = (ProducerWorker *)calloc((size_t)thread_count, sizeof(ProducerWorker));
+    merged = (ProducerStats *)calloc(1, sizeof(ProducerStats));
+    progress = (ProducerProgress *)calloc(1, sizeof(ProducerProgress));
+    if (!workers || !merged || !progress) {
+        log_message(1, "ERROR", "Failed to allocate producer statistics");
+        free(workers);
+        free(merged);
+        free(progress);
+        free(engine.key_cdf);
+        return 1;
+    }
+    
+    /* Create every handle and payload arena up front so errors fail fast */
+    if (config->producer_shared_handle) {
+        shared_rk = create_producer(config);
+        if (!shared_rk) {
+            result = 1;
+        }
+    }
+    for (i = 0; i < thread_count && result == 0; i++) {
+        workers[i].engine = &engine;
+        workers[i].index = i;
+        workers[i].key_rng = 0xD1B54A32D192ED03ULL * (uint64_t)(i + 1) ^ engine.producer_id;
+        workers[i].stats = (ProducerStats *)calloc(1, sizeof(ProducerStats));
+        workers[i].slots = (MsgSlot *)calloc((size_t)engine.payload_count, sizeof(MsgSlot));
+        if (!workers[i].stats || !workers[i].slots) {
+            log_message(1, "ERROR", "Failed to allocate message tracking slots");
+            result = 1;
+            break;
+        }
+        for (j = 0; j < engine.payload_count; j++) {
+            workers[i].slots[j].stats = workers[i].stats;
+        }
+        arena_size = build_payload_arena(&workers[i], config, engine.payload_count,
+                                         0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1));
+        if (arena_size == 0) {
+            log_message(1, "ERROR", "Failed to allocate payload arena for %d payloads",
+                        engine.payload_count);
+            result = 1;
+            break;
+        }
+        total_arena_size += arena_size;
+        workers[i].rk = shared_rk ? shared_rk : create_producer(config);
+        if (!workers[i].rk) {
+            result = 1;
+        }
+    }
+    
+    if (result == 0) {
+        if (config->producer_duration_sec > 0) {
+            log_message(1, "INFO", "Starting to produce to topic '%s' for %d s (message limit: %d, 0 = none)...",
+                        config->topic, config->producer_duration_sec, config->message_count);
+        } else {
+            log_message(1, "INFO", "Starting to produce %d messages to topic '%s'...",
+                        config->message_count, config->topic);
+        }
+        log_message(1, "INFO", "Producer id: %u, threads: %d, %s", engine.producer_id,
+                    thread_count, shared_rk ? "shared handle" : "one handle per thread");
+        log_message(1, "INFO", "Payload arena: %d payloads per thread, %s sizes (avg %.0f bytes), "
+                    "%s content, %d%% compressible, %.1f MB total", engine.payload_count,
+                    payload_size_distribution_names[config->payload_size_distribution],
+                    (double)total_arena_size / ((double)engine.payload_count * thread_count),
+                    payload_content_names[config->payload_content],
+                    config->payload_compressibility, (double)total_arena_size / (1024.0 * 1024.0));
+        if (engine.paced) {
+            log_message(1, "INFO", "Open-loop target rate: %d msg/s, %.2f MB/s (0 = no limit)",
+                        config->producer_rate_msgs, config->producer_rate_mb);
+        } else {
+            log_message(1, "INFO", "No target rate set, producing as fast as possible");
+        }
+        
+        start_cpu_ns = get_process_cpu_ns();
+        engine.start_ns = get_time_ns();
+        engine.next_send_ns = engine.start_ns;
+        if (config->producer_duration_sec > 0) {
+            engine.deadline_ns = engine.start_ns + (int64_t)config->producer_duration_sec * 1000000000LL;
+        }
+        engine.active_workers = thread_count;
+        if (run_result) {
+            start_run_result(run_result, "producer", engine.start_ns);
+        }
+        progress->start_ns = engine.start_ns;
+        progress->last_report_ns = engine.start_ns;
+        
+        for (i = 0; i < thread_count; i++) {
+            if (thread_create(&workers[i].thread, producer_thread_main, &workers[i]) != 0) {
+                /* Remaining threads pick up its share of the budget */
+                log_message(1, "ERROR", "Failed to start producer thread %d", i);
+                workers[i].finish_ns = -1;
+                ATOMIC_ADD(&engine.active_workers, -1);
+            }
+        }
+        
+        if (config->dashboard) {
+            dashboard.config = config;
+            dashboard.mode = "producer";
+            dashboard.workers = workers;
+            dashboard.worker_count = thread_count;
+            dashboard.shared_rk = shared_rk;
+            start_dashboard(&dashboard);
+        }
+        attach_producer_metrics(workers, thread_count, shared_rk);
+        
+        /* Progress reporting stays on this thread, off the produce path */
+        while (ATOMIC_LOAD(&engine.active_workers) > 0) {
+            sleep_ms(100);
+            now_ns = get_time_ns();
+            if (run_result && now_ns - run_result->last_ns >= 1000000000LL) {
+                collect_producer_stats(merged, workers, thread_count);
+                sample_run_result(run_result, now_ns, merged->delivered, merged->bytes_delivered,
+                                  merged->failed + merged->dropped + merged->produce_errors,
+                                  &merged->ack_latency);
+            }
+            if (report_interval_ns > 0 && now_ns - progress->last_report_ns >= report_interval_ns) {
+                collect_producer_stats(merged, workers, thread_count);
+                report_producer_progress(merged, progress, now_ns);
+                if (config->statistics_interval_ms > 0) {
+                    for (i = 0; i < thread_count; i++) {
+                        if (workers[i].rk && (i == 0 || workers[i].rk != shared_rk)) {
+                            snprintf(label, sizeof(label), shared_rk || thread_count == 1 ? "  " : "  handle %d ", i);
+                            log_client_statistics(&((ClientContext *)rd_kafka_opaque(workers[i].rk))->statistics,
+                                                  label, 0);
+                        }
+                    }
+                }
+            }
+        }
+        
+        stop_dashboard(&dashboard);
+        
+        end_ns = engine.start_ns;
+        for (i = 0; i < thread_count; i++) {
+            if (workers[i].finish_ns < 0) {
+                continue;
+            }
+            thread_join(workers[i].thread);
+            if (workers[i].finish_ns > end_ns) {
+                end_ns = workers[i].finish_ns;
+            }
+        }
+        if (shared_rk) {
+            log_message(1, "INFO", "Flushing messages...");
+            flush_producer(shared_rk);
+            end_ns = get_time_ns();
+        }
+        
+        if (thread_count > 1) {
+            for (i = 0; i < thread_count; i++) {
+                double elapsed_sec = (double)(end_ns - engine.start_ns) / 1e9;
+                log_message(1, "INFO", "Thread %d: %lld delivered, %.1f msg/s, ack p99 %.3f ms",
+                            i, workers[i].stats->delivered,
+                            elapsed_sec > 0.0 ? (double)workers[i].stats->delivered / elapsed_sec : 0.0,
+                            (double)hist_percentile(&workers[i].stats->ack_latency, 99.0) / 1e6);
+            }
+        }
+        collect_producer_stats(merged, workers, thread_count);
+        merged->elapsed_ns = end_ns - engine.start_ns;
+        merged->cpu_ns = get_process_cpu_ns() - start_cpu_ns;
+        
+        /* Wire bytes come from each handle's final statistics report */
+        if (config->statistics_interval_ms > 0) {
+            for (i = 0; i < thread_count; i++) {
+                if (workers[i].rk && (i == 0 || workers[i].rk != shared_rk)) {
+                    wait_for_statistics(workers[i].rk, config->statistics_interval_ms);
+                    merged->wire_bytes += ATOMIC_LOAD(
+                        &((ClientContext *)rd_kafka_opaque(workers[i].rk))->statistics.tx_bytes);
+                }
+            }
+        }
+        print_producer_summary(merged, merged->elapsed_ns);
+        if (run_result) {
+            finish_run_result(run_result, merged->elapsed_ns, merged->delivered, merged->bytes_delivered,
+                              merged->failed + merged->dropped + merged->produce_errors, &merged->ack_latency);
+        }
+        if (config->statistics_interval_ms > 0) {
+            for (i = 0; i < thread_count; i++) {
+                if (workers[i].rk && (i == 0 || workers[i].rk != shared_rk)) {
+                    snprintf(label, sizeof(label), shared_rk || thread_count == 1 ? "Last statistics: " :
+                             "Last statistics, handle %d: ", i);
+                    log_client_statistics(&((ClientContext *)rd_kafka_opaque(workers[i].rk))->statistics,
+                                          label, 1);
+                }
+            }
+        }
+        if (totals) {
+            memcpy(totals, merged, sizeof(*totals));
+        }
+        
+        attempted = merged->produced + merged->dropped + merged->produce_errors;
+        if (merged->delivered == attempted) {
+            log_message(1, "INFO", "Produced %lld messages successfully", merged->delivered);
+        } else {
+            log_message(1, "WARNING", "Only %lld of %lld messages were delivered "
+                        "(%lld failed, %lld dropped, %lld rejected)",
+                        merged->delivered, attempted, merged->failed,
+                        merged->dropped, merged->produce_errors);
+        }
+    }
+    
+    detach_metrics();
+    
+    /* Handles go first: their delivery reports reference the slots */
+    for (i = 0; i < thread_count; i++) {
+        if (workers[i].rk && workers[i].rk != shared_rk) {
+            destroy_producer(workers[i].rk);
+        }
+    }
+    if (shared_rk) {
+        destroy_producer(shared_rk);
+    }
+    for (i = 0; i < thread_count; i++) {
+        free(workers[i].slots);
+        free(workers[i].arena);
+        free(workers[i].stats);
+    }
+    free(workers);
+    free(merged);
+    free(progress);
+    free(engine.key_cdf);
+    return result;
+}
+
+/*
+ * Run the configured producer workload once per codec in codec_bench_codecs
+ * (entries are codec or codec:level) and print a comparison table
+ */
+static int run_codec_benchmark(const Config *config) {
+    CodecBenchResult results[MAX_BENCH_RUNS];
+    RunResult *runs = NULL;
+    Config *run_config;
+    char list[MAX_VALUE_LENGTH];
+    char *entry, *level;
+    int run_count = 0;
+    int result = 0;
+    int i;
+    
+    run_config = (Config *)malloc(sizeof(Config));
+    if (!run_config) {
+        log_message(1, "ERROR", "Failed to allocate benchmark configuration");
+        return 1;
+    }
+    
+    strncpy(list, config->codec_bench_codecs, sizeof(list) - 1);
+    list[sizeof(list) - 1] = '\0';
+    for (entry = strtok(list, ", "); entry && run_count < MAX_BENCH_RUNS; entry = strtok(NULL, ", ")) {
+        memset(&results[run_count], 0, sizeof(results[run_count]));
+        strncpy(results[run_count].label, entry, sizeof(results[run_count].label) - 1);
+        level = strchr(entry, ':');
+        if (level) {
+            *level++ = '\0';
+        }
+        strncpy(results[run_count].codec, entry, sizeof(results[run_count].codec) - 1);
+        results[run_count].level = level ? atoi(level) : -1;
+        run_count++;
+    }
+    if (run_count == 0) {
+        log_message(1, "ERROR", "codec_bench_codecs is empty");
+        free(run_config);
+        return 1;
+    }
+    if (config->result_dir[0] != '\0') {
+        runs = (RunResult *)calloc((size_t)run_count, sizeof(RunResult));
+        if (!runs) {
+            log_message(1, "ERROR", "Failed to allocate benchmark results");
+            free(run_config);
+            return 1;
+        }
+    }
+    
+    for (i = 0; i < run_count; i++) {
+        memcpy(run_config, config, sizeof(Config));
+        strcpy(run_config->compression_codec, results[i].codec);
+        run_config->compression_level = results[i].level;
+        if (run_config->statistics_interval_ms <= 0) {
+            run_config->statistics_interval_ms = 1000;
+        }
+        
+        log_message(1, "INFO", "=== Codec run %d/%d: %s ===", i + 1, run_count, results[i].label);
+        results[i].stats = (ProducerStats *)calloc(1, sizeof(ProducerStats));
+        if (runs) {
+            memcpy(runs[i].name, results[i].label, sizeof(results[i].label));
+        }
+        if (!results[i].stats || produce_messages(run_config, results[i].stats, runs ? &runs[i] : NULL) != 0) {
+            log_message(1, "ERROR", "Codec run '%s' failed", results[i].label);
+            free(results[i].stats);
+            results[i].stats = NULL;
+            result = 1;
+        }
+    }
+    
+    log_message(1, "INFO", "=== Codec Benchmark (%d messages, %s payloads, %d%% compressible) ===",
+                config->message_count, payload_content_names[config->payload_content],
+                config->payload_compressibility);
+    log_message(1, "INFO", "%-12s %12s %10s %9s %10s %11s %7s %12s",
+                "codec", "msg/s", "MB/s", "CPU s", "CPU us/msg", "wire MB", "ratio", "ack p99 ms");
+    for (i = 0; i < run_count; i++) {
+        const ProducerStats *stats = results[i].stats;
+        double elapsed_sec;
+        
+        if (!stats) {
+            log_message(1, "INFO", "%-12s failed", results[i].label);
+            continue;
+        }
+        elapsed_sec = stats->elapsed_ns > 0 ? (double)stats->elapsed_ns / 1e9 : 1e-9;
+        log_message(1, "INFO", "%-12s %12.1f %10.3f %9.3f %10.2f %11.3f %7.2f %12.3f", results[i].label,
+                    (double)stats->delivered / elapsed_sec,
+                    (double)stats->bytes_delivered / (1024.0 * 1024.0) / elapsed_sec,
+                    (double)stats->cpu_ns / 1e9,
+                    stats->delivered > 0 ? (double)stats->cpu_ns / 1e3 / (double)stats->delivered : 0.0,
+                    (double)stats->wire_bytes / (1024.0 * 1024.0),
+                    stats->wire_bytes > 0 ? (double)stats->bytes_delivered / (double)stats->wire_bytes : 0.0,
+                    (double)hist_percentile(&stats->ack_latency, 99.0) / 1e6);
+        free(results[i].stats);
+    }
+    log_message(1, "INFO", "Ratio = payload bytes / bytes sent to brokers (includes protocol overhead)");
+    
+    if (runs) {
+        write_result_files(config, "codec-bench", runs, run_count);
+        for (i = 0; i < run_count; i++) {
+            free_run_result(&runs[i]);
+        }
+        free(runs);
+    }
+    free(run_config);
+    return result;
+}
+
+/*
+ * Parse a comma-separated list of integers ("all" is read as -1, for acks)
+ * Returns the number of values; an empty list yields the fallback value
+ */
+static int parse_int_list(const char *value, int fallback, int *values, int max_values) {
+    char list[MAX_VALUE_LENGTH];
+    char *entry;
+    int count = 0;
+    
+    strncpy(list, value, sizeof(list) - 1);
+    list[sizeof(list) - 1] = '\0';
+    for (entry = strtok(list, ", "); entry && count < max_values; entry = strtok(NULL, ", ")) {
+        values[count++] = strcmp(entry, "all") == 0 ? -1 : atoi(entry);
+    }
+    if (count == 0) {
+        values[count++] = fallback;
+    }
+    return count;
+}
+
+/*
+ * Run every combination of the sweep_* value lists for sweep_duration_sec
+ * each, then print a table and the fastest setting within the latency budget
+ */
+static int run_parameter_sweep(const Config *config) {
+    int batch_sizes[MAX_SWEEP_VALUES], linger_values[MAX_SWEEP_VALUES], acks_values[MAX_SWEEP_VALUES];
+    int message_sizes[MAX_SWEEP_VALUES], in_flight_values[MAX_SWEEP_VALUES];
+    int batch_count, linger_count, acks_count, size_count, in_flight_count;
+    int run_count, run_index, best = -1, result_code = 0;
+    int64_t budget_ns = (int64_t)(config->sweep_latency_budget_ms * 1e6);
+    SweepResult *results;
+    RunResult *runs = NULL;
+    ProducerStats *stats;
+    Config *run_config;
+    int i;
+    
+    batch_count = parse_int_list(config->sweep_batch_size, config->producer_batch_size,
+                                 batch_sizes, MAX_SWEEP_VALUES);
+    linger_count = parse_int_list(config->sweep_linger_ms, config->producer_linger_ms,
+                                  linger_values, MAX_SWEEP_VALUES);
+    acks_count = parse_int_list(config->sweep_acks, config->producer_ack,
+                                acks_values, MAX_SWEEP_VALUES);
+    size_count = parse_int_list(config->sweep_message_size, config->producer_message_size,
+                                message_sizes, MAX_SWEEP_VALUES);
+    in_flight_count = parse_int_list(config->sweep_max_in_flight, config->producer_max_in_flight,
+                                     in_flight_values, MAX_SWEEP_VALUES);
+    run_count = batch_count * linger_count * acks_count * size_count * in_flight_count;
+    
+    results = (SweepResult *)calloc((size_t)run_count, sizeof(SweepResult));
+    stats = (ProducerStats *)malloc(sizeof(ProducerStats));
+    run_config = (Config *)malloc(sizeof(Config));
+    if (config->result_dir[0] != '\0') {
+        runs = (RunResult *)calloc((size_t)run_count, sizeof(RunResult));
+    }
+    if (!results || !stats || !run_config || (config->result_dir[0] != '\0' && !runs)) {
+        log_message(1, "ERROR", "Failed to allocate sweep results");
+        free(results);
+        free(runs);
+        free(stats);
+        free(run_config);
+        return 1;
+    }
+    
+    log_message(1, "INFO", "Sweeping %d combinations, %d s each (about %d min)", run_count,
+                config->sweep_duration_sec, (run_count * config->sweep_duration_sec + 59) / 60);
+    
+    for (run_index = 0; run_index < run_count; run_index++) {
+        SweepResult *result = &results[run_index];
+        double elapsed_sec;
+        char acks[12];
+        int index = run_index;
+        
+        /* Decode the run number into one value per dimension, last one fastest */
+        result->max_in_flight = in_flight_values[index % in_flight_count];
+        index /= in_flight_count;
+        result->message_size = message_sizes[index % size_count];
+        index /= size_count;
+        result->acks = acks_values[index % acks_count];
+        index /= acks_count;
+        result->linger_ms = linger_values[index % linger_count];
+        index /= linger_count;
+        result->batch_size = batch_sizes[index];
+        
+        memcpy(run_config, config, sizeof(Config));
+        run_config->producer_batch_size = result->batch_size;
+        run_config->producer_linger_ms = result->linger_ms;
+        run_config->producer_ack = result->acks;
+        run_config->producer_message_size = result->message_size;
+        run_config->producer_max_in_flight = result->max_in_flight;
+        run_config->producer_duration_sec = config->sweep_duration_sec;
+        run_config->message_count = 0;
+        
+        log_message(1, "INFO", "=== Sweep run %d/%d: batch.size %d, linger.ms %d, acks %d, "
+                    "message size %d, max in flight %d ===", run_index + 1, run_count, result->batch_size,
+                    result->linger_ms, result->acks, result->message_size, result->max_in_flight);
+        memset(stats, 0, sizeof(ProducerStats));
+        if (runs) {
+            if (result->acks < 0) {
+                strcpy(acks, "all");
+            } else {
+                snprintf(acks, sizeof(acks), "%d", result->acks);
+            }
+            snprintf(runs[run_index].name, sizeof(runs[run_index].name),
+                     "batch%d-linger%d-acks%s-size%d-inflight%d", result->batch_size,
+                     result->linger_ms, acks, result->message_size, result->max_in_flight);
+        }
+        if (produce_messages(run_config, stats, runs ? &runs[run_index] : NULL) != 0) {
+            log_message(1, "ERROR", "Sweep run %d failed", run_index + 1);
+            result_code = 1;
+            continue;
+        }
+        
+        /* Intended-time latency equals ack latency unless a target rate is set */
+        elapsed_sec = stats->elapsed_ns > 0 ? (double)stats->elapsed_ns / 1e9 : 1e-9;
+        result->msgs_per_sec = (double)stats->delivered / elapsed_sec;
+        result->mb_per_sec = (double)stats->bytes_delivered / (1024.0 * 1024.0) / elapsed_sec;
+        result->p50_ns = hist_percentile(&stats->intended_latency, 50.0);
+        result->p99_ns = hist_percentile(&stats->intended_latency, 99.0);
+        result->p999_ns = hist_percentile(&stats->intended_latency, 99.9);
+        result->budget_ns = hist_percentile(&stats->intended_latency, config->sweep_latency_percentile);
+        result->lost = stats->failed + stats->dropped + stats->produce_errors;
+        result->ok = stats->delivered > 0;
+        if (!result->ok) {
+            log_message(1, "ERROR", "Sweep run %d delivered no messages", run_index + 1);
+            result_code = 1;
+        }
+    }
+    
+    log_message(1, "INFO", "=== Parameter Sweep (%d s per run, budget p%g <= %.3f ms) ===",
+                config->sweep_duration_sec, config->sweep_latency_percentile,
+                config->sweep_latency_budget_ms);
+    log_message(1, "INFO", "%10s %7s %5s %8s %9s %12s %10s %10s %10s %10s %8s",
+                "batch", "linger", "acks", "msg size", "in flight", "msg/s", "MB/s",
+                "p50 ms", "p99 ms", "p99.9 ms", "lost");
+    for (i = 0; i < run_count; i++) {
+        if (!results[i].ok) {
+            log_message(1, "INFO", "%10d %7d %5d %8d %9d %12s", results[i].batch_size,
+                        results[i].linger_ms, results[i].acks, results[i].message_size,
+                        results[i].max_in_flight, "failed");
+            continue;
+        }
+        log_message(1, "INFO", "%10d %7d %5d %8d %9d %12.1f %10.3f %10.3f %10.3f %10.3f %8lld",
+                    results[i].batch_size, results[i].linger_ms, results[i].acks,
+                    results[i].message_size, results[i].max_in_flight, results[i].msgs_per_sec,
+                    results[i].mb_per_sec, (double)results[i].p50_ns / 1e6,
+                    (double)results[i].p99_ns / 1e6, (double)results[i].p999_ns / 1e6,
+                    results[i].lost);
+        /* Lossy runs only look fast; they never win */
+        if (results[i].lost == 0 && results[i].budget_ns <= budget_ns &&
+            (best < 0 || results[i].mb_per_sec > results[best].mb_per_sec)) {
+            best = i;
+        }
+    }
+    
+    if (best >= 0) {
+        log_message(1, "INFO", "Best within budget: producer_batch_size = %d, producer_linger_ms = %d, "
+                    "producer_ack = %d, producer_message_size = %d, producer_max_in_flight = %d "
+                    "(%.3f MB/s, p%g %.3f ms)", results[best].batch_size, results[best].linger_ms,
+                    results[best].acks, results[best].message_size, results[best].max_in_flight,
+                    results[best].mb_per_sec, config->sweep_latency_percentile,
+                    (double)results[best].budget_ns / 1e6);
+    } else {
+        log_message(1, "WARNING", "No loss-free combination stayed within p%g <= %.3f ms",
+                    config->sweep_latency_percentile, config->sweep_latency_budget_ms);
+    }
+    
+    if (runs) {
+        write_result_files(config, "sweep", runs, run_count);
+        for (i = 0; i < run_count; i++) {
+            free_run_result(&runs[i]);
+        }
+        free(runs);
+    }
+    free(results);
+    free(stats);
+    free(run_config);
+    return result_code;
+}
+
+/*
+ * Whether a scenario is listed in mock_bench_scenarios (empty = all)
+ */
+static int mock_bench_selected(const Config *config, const char *name) {
+    char list[MAX_VALUE_LENGTH];
+    char *entry;
+    
+    if (config->mock_bench_scenarios[0] == '\0') {
+        return 1;
+    }
+    strncpy(list, config->mock_bench_scenarios, sizeof(list) - 1);
+    list[sizeof(list) - 1] = '\0';
+    for (entry = strtok(list, ", "); entry; entry = strtok(NULL, ", ")) {
+        if (strcmp(entry, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Address of an exported librdkafka function, or NULL if this build lacks it
+ */
+static void *find_librdkafka_symbol(const char *name) {
+#ifdef _WIN32
+    HMODULE module = GetModuleHandle("librdkafka.dll");
+    
+    return module ? (void *)GetProcAddress(module, name) : NULL;
+#else
+    /* The program's handle searches every library it was linked with */
+    void *program = dlopen(NULL, RTLD_LAZY);
+    void *symbol;
+    
+    if (!program) {
+        return NULL;
+    }
+    symbol = dlsym(program, name);
+    dlclose(program);
+    return symbol;
+#endif
+}
+
+/*
+ * Look up the mock cluster functions (librdkafka 1.4 or later, built with
+ * the mock cluster, which is the default)
+ * Returns 0 if all of them are available
+ */
+static int load_mock_api(MockApi *mock) {
+    mock->handle_mock_cluster = (rd_kafka_mock_cluster_t *(*)(const rd_kafka_t *))
+        find_librdkafka_symbol("rd_kafka_handle_mock_cluster");
+    mock->topic_create = (rd_kafka_resp_err_t (*)(rd_kafka_mock_cluster_t *, const char *, int, int))
+        find_librdkafka_symbol("rd_kafka_mock_topic_create");
+    mock->cluster_bootstraps = (const char *(*)(const rd_kafka_mock_cluster_t *))
+        find_librdkafka_symbol("rd_kafka_mock_cluster_bootstraps");
+    return mock->handle_mock_cluster && mock->topic_create && mock->cluster_bootstraps ? 0 : -1;
+}
+
+/*
+ * Create a handle whose only job is to own an in-process mock cluster of
+ * mock_bench_brokers brokers (test.mock.num.brokers), and create the topic
+ * on it. The cluster listens on loopback and lives until the handle is
+ * destroyed. Returns the handle and the cluster's bootstrap servers, or NULL.
+ */
+static rd_kafka_t *create_mock_cluster(const Config *config, const MockApi *mock, const char *topic,
+                                       int partitions, const char **bootstraps) {
+    rd_kafka_conf_t *conf;
+    rd_kafka_t *rk;
+    rd_kafka_mock_cluster_t *mcluster;
+    rd_kafka_resp_err_t err;
+    char value[16];
+    char errstr[512];
+    
+    conf = rd_kafka_conf_new();
+    snprintf(value, sizeof(value), "%d", config->mock_bench_brokers);
+    if (rd_kafka_conf_set(conf, "test.mock.num.brokers", value,
+                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
+        log_message(1, "ERROR", "Failed to set test.mock.num.brokers: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    rk = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr, sizeof(errstr));
+    if (!rk) {
+        log_message(1, "ERROR", "Failed to create mock cluster: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+        return NULL;
+    }
+    
+    mcluster = mock->handle_mock_cluster(rk);
+    if (!mcluster) {
+        log_message(1, "ERROR", "This librdkafka build has no mock cluster support");
+        rd_kafka_destroy(rk);
+        return NULL;
+    }
+    err = mock->topic_create(mcluster, topic, partitions,
+                             config->mock_bench_brokers < 3 ? config->mock_bench_brokers : 3);
+    if (err) {
+        log_message(1, "ERROR", "Failed to create mock topic %s: %s", topic, rd_kafka_err2str(err));
+        rd_kafka_destroy(rk);
+        return NULL;
+    }
+    
+    *bootstraps = mock->cluster_bootstraps(mcluster);
+    log_message(1, "INFO", "Mock cluster with %d broker(s) at %s", config->mock_bench_brokers, *bootstraps);
+    return rk;
+}
+
+/*
+ * Stop the read back if it has not finished by the deadline
+ */
+static thread_ret_t THREAD_CALL mock_bench_watchdog_main(void *arg) {
+    MockBenchWatchdog *watchdog = (MockBenchWatchdog *)arg;
+    
+    while (!ATOMIC_LOAD(&watchdog->done)) {
+        if (get_time_ns() >= watchdog->deadline_ns) {
+            ATOMIC_STORE(&watchdog->fired, 1);
+            break;
+        }
+        sleep_ms(100);
+    }
+    return 0;
+}
+
+/*
+ * Read a round trip scenario's messages back from the mock cluster with the
+ * configured consumer settings. Returns 0 if every delivered message arrived.
+ */
+static int run_mock_bench_consumer(Config *run_config, RunResult *run_result, long long expected) {
+    MockBenchWatchdog watchdog;
+    thread_t watchdog_thread;
+    int watchdog_started;
+    rd_kafka_t *rk;
+    
+    run_config->message_count = (int)expected;
+    run_config->consumer_quiet = 1;
+    run_config->consumer_sample_every = 0;
+    run_config->consumer_sample_per_sec = 0;
+    run_config->consumer_assign[0] = '\0';
+    run_config->consumer_rebalance_churn_sec = 0;
+    strcpy(run_config->consumer_auto_offset_reset, "earliest");
+    
+    rk = create_consumer(run_config);
+    if (!rk) {
+        return 1;
+    }
+    
+    /* Reading back is faster than producing; the margin covers the group join */
+    memset(&watchdog, 0, sizeof(watchdog));
+    watchdog.deadline_ns = get_time_ns() + (int64_t)(run_config->mock_bench_duration_sec + 30) * 1000000000LL;
+    watchdog_started = thread_create(&watchdog_thread, mock_bench_watchdog_main, &watchdog) == 0;
+    consume_messages(rk, run_config, &watchdog.fired, run_result);
+    ATOMIC_STORE(&watchdog.done, 1);
+    if (watchdog_started) {
+        thread_join(watchdog_thread);
+    }
+    rd_kafka_consumer_close(rk);
+    destroy_consumer(rk);
+    
+    if (watchdog.fired) {
+        log_message(1, "ERROR", "Read back timed out after %lld of %lld messages",
+                    run_result->messages, expected);
+        return 1;
+    }
+    
+    /* A backlog read after producing has its age as end-to-end latency: not reported */
+    memset(run_result->latency_ms, 0, sizeof(run_result->latency_ms));
+    return run_result->messages >= expected ? 0 : 1;
+}
+
+/*
+ * Run the fixed mock-bench scenarios, each against a fresh in-process mock
+ * cluster without network or certificates, then print a comparison table
+ * and write one result file with a run per scenario
+ */
+static int run_mock_benchmark(const Config *config) {
+    RunResult *results;
+    const MockBenchScenario *scenario;
+    MockApi mock;
+    Config *run_config;
+    RunResult *run_result;
+    rd_kafka_t *owner;
+    const char *bootstraps;
+    char acks[12];
+    int run_count = 0;
+    int failed = 0;
+    int produced;
+    int i;
+    
+    if (config->mock_bench_brokers <= 0 || config->mock_bench_duration_sec <= 0) {
+        log_message(1, "ERROR", "mock_bench_brokers and mock_bench_duration_sec must be positive");
+        return 1;
+    }
+    if (load_mock_api(&mock) != 0) {
+        log_message(1, "ERROR", "librdkafka %s has no mock cluster API (rd_kafka_mock_*); mock-bench "
+                    "needs librdkafka 1.4 or later built with the mock cluster", rd_kafka_version_str());
+        return 1;
+    }
+    /* Two histograms per run: too large for the stack */
+    results = (RunResult *)calloc(MAX_BENCH_RUNS, sizeof(RunResult));
+    run_config = (Config *)malloc(sizeof(Config));
+    if (!results || !run_config) {
+        log_message(1, "ERROR", "Failed to allocate benchmark configuration");
+        free(results);
+        free(run_config);
+        return 1;
+    }
+    
+    for (i = 0; i < MOCK_BENCH_SCENARIOS && run; i++) {
+        scenario = &mock_bench_scenarios[i];
+        if (!mock_bench_selected(config, scenario->name)) {
+            continue;
+        }
+        
+        owner = create_mock_cluster(config, &mock, config->topic, scenario->partitions, &bootstraps);
+        if (!owner) {
+            failed = 1;
+            break;
+        }
+        
+        /* The scenario fixes the workload; client settings come from the config */
+        memcpy(run_config, config, sizeof(Config));
+        strncpy(run_config->brokers, bootstraps, MAX_VALUE_LENGTH - 1);
+        run_config->brokers[MAX_VALUE_LENGTH - 1] = '\0';
+        strcpy(run_config->security_protocol, "PLAINTEXT");
+        run_config->producer_message_size = scenario->message_size;
+        run_config->payload_size_distribution = PAYLOAD_SIZE_FIXED;
+        run_config->key_distribution = KEY_DIST_NONE;
+        run_config->producer_ack = scenario->acks;
+        run_config->producer_rate_msgs = 0;
+        run_config->producer_rate_mb = 0.0;
+        run_config->message_count = scenario->message_count;
+        run_config->producer_duration_sec = scenario->message_count > 0 ? 0 : config->mock_bench_duration_sec;
+        run_config->dashboard = 0;
+        
+        if (scenario->acks < 0) {
+            strcpy(acks, "all");
+        } else {
+            snprintf(acks, sizeof(acks), "%d", scenario->acks);
+        }
+        log_message(1, "INFO", "=== Mock scenario %s: %d-byte messages, acks %s, %d partition(s) ===",
+                    scenario->name, scenario->message_size, acks, scenario->partitions);
+        
+        run_result = &results[run_count];
+        strncpy(run_result->name, scenario->name, sizeof(run_result->name) - 1);
+        produced = produce_messages(run_config, NULL, run_result) == 0 && run_result->finished;
+        if (produced) {
+            run_count++;
+        } else {
+            log_message(1, "ERROR", "Mock scenario %s failed", scenario->name);
+            free_run_result(run_result);
+            memset(run_result, 0, sizeof(*run_result));
+            failed = 1;
+        }
+        
+        if (produced && scenario->consume) {
+            run_result = &results[run_count];
+            snprintf(run_result->name, sizeof(run_result->name), "%s-consume", scenario->name);
+            log_message(1, "INFO", "=== Mock scenario %s: reading %lld messages back ===",
+                        scenario->name, results[run_count - 1].messages);
+            if (run_mock_bench_consumer(run_config, run_result, results[run_count - 1].messages) == 0 &&
+                run_result->finished) {
+                run_count++;
+            } else {
+                log_message(1, "ERROR", "Mock scenario %s read back failed", scenario->name);
+                free_run_result(run_result);
+                memset(run_result, 0, sizeof(*run_result));
+                failed = 1;
+            }
+        }
+        
+        rd_kafka_destroy(owner);
+    }
+    
+    log_message(1, "INFO", "=== Mock Cluster Benchmark (%d brokers, %d s per scenario, librdkafka %s) ===",
+                config->mock_bench_brokers, config->mock_bench_duration_sec, rd_kafka_version_str());
+    log_message(1, "INFO", "%-24s %12s %10s %10s %10s %11s %8s",
+                "scenario", "msg/s", "MB/s", "p50 ms", "p99 ms", "CPU us/msg", "errors");
+    for (i = 0; i < run_count; i++) {
+        double elapsed_sec = results[i].elapsed_sec > 0.0 ? results[i].elapsed_sec : 1e-9;
+        
+        log_message(1, "INFO", "%-24s %12.1f %10.3f %10.3f %10.3f %11.2f %8lld", results[i].name,
+                    (double)results[i].messages / elapsed_sec,
+                    (double)results[i].bytes / (1024.0 * 1024.0) / elapsed_sec,
+                    results[i].latency_ms[0], results[i].latency_ms[2],
+                    results[i].messages > 0 ? results[i].cpu_sec * 1e6 / (double)results[i].messages : 0.0,
+                    results[i].errors);
+    }
+    log_message(1, "INFO", "Latency is ack latency; CPU includes the mock brokers, which run in this process");
+    
+    if (run_count > 0) {
+        write_result_files(config, "mock-bench", results, run_count);
+    }
+    for (i = 0; i < run_count; i++) {
+        free_run_result(&results[i]);
+    }
+    free(results);
+    free(run_config);
+    return failed;
+}
+
+/*
+ * One consume call: a batch from the consumer queue when batch is set,
+ * otherwise a single poll into *rkmessage
+ * Returns the number of messages (and events) returned
+ */
+static ssize_t consume_call(rd_kafka_t *rk, rd_kafka_queue_t *queue, rd_kafka_message_t **batch,
+                            int batch_size, rd_kafka_message_t **rkmessage, int timeout_ms) {
+    ssize_t count;
+    
+    if (batch) {
+        count = rd_kafka_consume_batch_queue(queue, timeout_ms, batch, (size_t)batch_size);
+        return count < 0 ? 0 : count;
+    }
+    *rkmessage = rd_kafka_consumer_poll(rk, timeout_ms);
+    return *rkmessage ? 1 : 0;
+}
+
+/*
+ * Signal handler to stop consumer
+ */
+static void stop_consumer(int sig) {
+    log_message(1, "INFO", "Received signal %d, shutting down...", sig);
+    run = 0;
+    if (global_kafka_handle) {
+        rd_kafka_consumer_close(global_kafka_handle);
+    }
+}
+
+/*
+ * Account a consumed message, decoding its payload header if present
+ * Returns 1 and fills header/e2e_latency_ns if the payload has a header
+ */
+static int record_consumed_message(ConsumerStats *stats, const rd_kafka_message_t *rkmessage,
+                                   PayloadHeader *header, int64_t *e2e_latency_ns) {
+    /* Atomic so progress reports can read worker statistics while they run */
+    ATOMIC_ADD(&stats->consumed, 1);
+    ATOMIC_ADD(&stats->bytes, (long long)rkmessage->len);
+    if (rkmessage->partition >= 0 && rkmessage->partition < MAX_TRACKED_PARTITIONS) {
+        ATOMIC_ADD(&stats->partition_consumed[rkmessage->partition], 1);
+    } else {
+        ATOMIC_ADD(&stats->partition_consumed[MAX_TRACKED_PARTITIONS - 1], 1);
+    }
+    
+    if (!decode_payload_header(rkmessage->payload, rkmessage->len, header)) {
+        ATOMIC_ADD(&stats->headerless, 1);
+        return 0;
+    }
+    
+    *e2e_latency_ns = get_wall_time_ns() - header->send_time_ns;
+    if (*e2e_latency_ns < 0) {
+        /* Producer clock is ahead of ours; count it rather than skew the histogram */
+        ATOMIC_ADD(&stats->clock_skewed, 1);
+        *e2e_latency_ns = 0;
+    }
+    hist_record(&stats->e2e_latency, *e2e_latency_ns);
+    return 1;
+}
+
+/*
+ * Print consumer run summary
+ */
+static void print_consumer_summary(const ConsumerStats *stats, int64_t elapsed_ns) {
+    double elapsed_sec = (double)elapsed_ns / 1e9;
+    
+    if (elapsed_sec <= 0.0) {
+        elapsed_sec = 1e-9;
+    }
+    
+    log_message(1, "INFO", "=== Consumer Summary ===");
+    log_message(1, "INFO", "Messages: %lld consumed, %.3f MB", stats->consumed,
+                (double)stats->bytes / (1024.0 * 1024.0));
+    log_message(1, "INFO", "Elapsed: %.3f s, throughput: %.1f msg/s, %.3f MB/s",
+                elapsed_sec, (double)stats->consumed / elapsed_sec,
+                (double)stats->bytes / (1024.0 * 1024.0) / elapsed_sec);
+    if (stats->first_message_ns > 0) {
+        log_message(1, "INFO", "Time to first message: %.1f ms", (double)stats->first_message_ns / 1e6);
+    }
+    if (stats->poll_calls > 0) {
+        log_message(1, "INFO", "Consume calls: %lld returning data (avg %.1f messages/call, "
+                    "%.3f us/call, %.3f us/message), %lld empty; timed without waiting",
+                    stats->poll_calls, (double)stats->poll_messages / (double)stats->poll_calls,
+                    (double)stats->poll_ns / 1e3 / (double)stats->poll_calls,
+                    (double)stats->poll_ns / 1e3 / (double)stats->poll_messages,
+                    stats->empty_polls);
+    }
+    if (stats->e2e_latency.total_count > 0) {
+        log_latency_percentiles("End-to-end latency", &stats->e2e_latency);
+    }
+    if (stats->headerless > 0) {
+        log_message(1, "INFO", "Messages without payload header (not timed): %lld",
+                    stats->headerless);
+    }
+    if (stats->errors > 0) {
+        log_message(1, "WARNING", "Consumer errors: %lld", stats->errors);
+    }
+    if (stats->clock_skewed > 0) {
+        log_message(1, "WARNING", "%lld messages had a send time in the future - "
+                    "check clock synchronization between producer and consumer hosts",
+                    stats->clock_skewed);
+    }
+    log_message(1, "INFO", "========================");
+}
+
+/*
+ * Log consume throughput and end-to-end latency for the interval since the last report
+ */
+static void report_consumer_progress(ConsumerStats *stats, ConsumerProgress *progress,
+                                     int64_t now_ns) {
+    double interval_sec = (double)(now_ns - progress->last_report_ns) / 1e9;
+    long long consumed, bytes;
+    
+    if (interval_sec <= 0.0) {
+        return;
+    }
+    
+    /* Workers update these while we read */
+    consumed = ATOMIC_LOAD(&stats->consumed);
+    bytes = ATOMIC_LOAD(&stats->bytes);
+    hist_delta(&stats->e2e_latency, &progress->last_e2e_latency, &progress->interval_latency);
+    
+    log_message(1, "INFO", "[%.1f s] %.1f msg/s, %.3f MB/s, e2e p50 %.3f ms, p99 %.3f ms, "
+                "max %.3f ms, total %lld",
+                (double)(now_ns - progress->start_ns) / 1e9,
+                (double)(consumed - progress->last_consumed) / interval_sec,
+                (double)(bytes - progress->last_bytes) / (1024.0 * 1024.0) / interval_sec,
+                (double)hist_percentile(&progress->interval_latency, 50.0) / 1e6,
+                (double)hist_percentile(&progress->interval_latency, 99.0) / 1e6,
+                (double)progress->interval_latency.max_value / 1e6,
+                consumed);
+    
+    progress->last_report_ns = now_ns;
+    progress->last_consumed = consumed;
+    progress->last_bytes = bytes;
+}
+
+/*
+ * Decide whether a quiet-mode consumer prints this message: every Nth
+ * message and/or at most N messages per second
+ */
+static int should_print_message(const Config *config, ConsumerProgress *progress,
+                                long long count, int64_t now_ns) {
+    if (config->consumer_sample_every > 0 && count % config->consumer_sample_every == 0) {
+        return 1;
+    }
+    if (config->consumer_sample_per_sec > 0) {
+        if (now_ns - progress->sample_window_ns >= 1000000000LL) {
+            progress->sample_window_ns = now_ns;
+            progress->sample_window_count = 0;
+        }
+        if (progress->sample_window_count < config->consumer_sample_per_sec) {
+            progress->sample_window_count++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Parse a consumer_assign list: "partition[:offset]" entries where offset
+ * is a number, beginning, end or stored (the default: the group's committed
+ * offset, else auto.offset.reset)
+ * Returns a new list, or NULL if an entry is invalid
+ */
+static rd_kafka_topic_partition_list_t *parse_partition_offsets(const char *value, const char *topic) {
+    rd_kafka_topic_partition_list_t *list;
+    char entries[MAX_VALUE_LENGTH];
+    char *entry, *offset, *end;
+    long partition;
+    int64_t start;
+    
+    strncpy(entries, value, sizeof(entries) - 1);
+    entries[sizeof(entries) - 1] = '\0';
+    list = rd_kafka_topic_partition_list_new(8);
+    for (entry = strtok(entries, ", "); entry; entry = strtok(NULL, ", ")) {
+        offset = strchr(entry, ':');
+        if (offset) {
+            *offset++ = '\0';
+        }
+        partition = strtol(entry, &end, 10);
+        if (end == entry || *end != '\0' || partition < 0) {
+            log_message(1, "ERROR", "consumer_assign: invalid partition '%s'", entry);
+            rd_kafka_topic_partition_list_destroy(list);
             return NULL;
         }
         
-        /* CA Certificate */
-        if (strlen(config->ssl_ca_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.ca.location", config->ssl_ca_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.ca.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+        if (!offset || strcmp(offset, "stored") == 0) {
+            start = RD_KAFKA_OFFSET_STORED;
+        } else if (strcmp(offset, "beginning") == 0) {
+            start = RD_KAFKA_OFFSET_BEGINNING;
+        } else if (strcmp(offset, "end") == 0) {
+            start = RD_KAFKA_OFFSET_END;
+        } else {
+            start = strtoll(offset, &end, 10);
+            if (end == offset || *end != '\0' || start < 0) {
+                log_message(1, "ERROR", "consumer_assign: invalid offset '%s' for partition %ld",
+                            offset, partition);
+                rd_kafka_topic_partition_list_destroy(list);
+                return NULL;
+            }
+        }
+        rd_kafka_topic_partition_list_add(list, topic, (int32_t)partition);
+        list->elems[list->cnt - 1].offset = start;
+    }
+    
+    if (list->cnt == 0) {
+        log_message(1, "ERROR", "consumer_assign lists no partitions");
+        rd_kafka_topic_partition_list_destroy(list);
+        return NULL;
+    }
+    return list;
+}
+
+/*
+ * Recompute lag for the current assignment from the consumer positions and
+ * the cached high watermarks (no broker round trip)
+ * Returns 0 if the assignment could be read
+ */
+static int update_consumer_lag(rd_kafka_t *rk, ConsumerLag *lag, int64_t now_ns) {
+    rd_kafka_topic_partition_list_t *assignment = NULL;
+    int64_t low, high, total = 0;
+    int known = 0;
+    int i, partition;
+    
+    if (rd_kafka_assignment(rk, &assignment) != RD_KAFKA_RESP_ERR_NO_ERROR || !assignment) {
+        return -1;
+    }
+    rd_kafka_position(rk, assignment);
+    
+    memset(lag->assigned, 0, sizeof(lag->assigned));
+    lag->partitions = assignment->cnt;
+    for (i = 0; i < assignment->cnt; i++) {
+        const rd_kafka_topic_partition_t *elem = &assignment->elems[i];
+        
+        partition = (int)elem->partition;
+        if (partition < 0 || partition >= MAX_TRACKED_PARTITIONS) {
+            continue;
+        }
+        lag->assigned[partition] = 1;
+        lag->position[partition] = elem->offset;
+        lag->lag[partition] = -1;
+        if (rd_kafka_get_watermark_offsets(rk, elem->topic, elem->partition, &low, &high) !=
+            RD_KAFKA_RESP_ERR_NO_ERROR || high < 0) {
+            continue;
+        }
+        lag->high_watermark[partition] = high;
+        
+        /* Nothing fetched yet: everything from the low watermark is behind */
+        lag->lag[partition] = high - (elem->offset >= 0 ? elem->offset : low);
+        if (lag->lag[partition] < 0) {
+            lag->lag[partition] = 0;
+        }
+        if (lag->lag[partition] > lag->max_lag[partition]) {
+            lag->max_lag[partition] = lag->lag[partition];
+        }
+        total += lag->lag[partition];
+        known++;
+    }
+    rd_kafka_topic_partition_list_destroy(assignment);
+    
+    lag->previous_total_lag = lag->total_lag;
+    lag->previous_update_ns = lag->last_update_ns;
+    lag->total_lag = known > 0 ? total : -1;
+    lag->last_update_ns = now_ns;
+    if (lag->total_lag > lag->max_total_lag) {
+        lag->max_total_lag = lag->total_lag;
+    }
+    return 0;
+}
+
+/*
+ * Log total lag, its trend, and the lag of each assigned partition
+ */
+static void report_consumer_lag(const ConsumerLag *lag) {
+    char partitions[512];
+    size_t used = 0;
+    double interval_sec, rate;
+    int i;
+    
+    if (lag->total_lag < 0) {
+        log_message(1, "INFO", "Lag: unknown (%d partitions assigned, no watermarks yet)",
+                    lag->partitions);
+        return;
+    }
+    
+    partitions[0] = '\0';
+    for (i = 0; i < MAX_TRACKED_PARTITIONS && used < sizeof(partitions) - 32; i++) {
+        if (lag->assigned[i] && lag->lag[i] >= 0) {
+            used += (size_t)snprintf(partitions + used, sizeof(partitions) - used, "%s%d:%lld",
+                                     used > 0 ? " " : "", i, (long long)lag->lag[i]);
+        }
+    }
+    
+    /* Trend between the last two updates decides whether we catch up */
+    interval_sec = (double)(lag->last_update_ns - lag->previous_update_ns) / 1e9;
+    if (lag->previous_update_ns == 0 || lag->previous_total_lag < 0 || interval_sec <= 0.0) {
+        log_message(1, "INFO", "Lag: %lld messages [%s]", (long long)lag->total_lag, partitions);
+        return;
+    }
+    rate = (double)(lag->total_lag - lag->previous_total_lag) / interval_sec;
+    if (lag->total_lag == 0) {
+        log_message(1, "INFO", "Lag: 0 messages, caught up [%s]", partitions);
+    } else if (rate < 0.0) {
+        log_message(1, "INFO", "Lag: %lld messages, %.1f msg/s, caught up in ~%.0f s [%s]",
+                    (long long)lag->total_lag, rate, (double)lag->total_lag / -rate, partitions);
+    } else {
+        log_message(1, "INFO", "Lag: %lld messages, +%.1f msg/s, falling behind [%s]",
+                    (long long)lag->total_lag, rate, partitions);
+    }
+}
+
+/*
+ * Print final and peak lag per partition next to what was consumed from it
+ */
+static void print_lag_summary(const ConsumerLag *lag, const ConsumerStats *stats) {
+    int i;
+    
+    if (lag->last_update_ns == 0) {
+        return;
+    }
+    
+    if (lag->total_lag >= 0) {
+        log_message(1, "INFO", "Lag: %lld messages at the end, peak %lld",
+                    (long long)lag->total_lag, (long long)lag->max_total_lag);
+    } else {
+        log_message(1, "INFO", "Lag: unknown");
+    }
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (!lag->assigned[i] && stats->partition_consumed[i] == 0) {
+            continue;
+        }
+        if (lag->assigned[i] && lag->lag[i] >= 0) {
+            log_message(1, "INFO", "  Partition %d: %lld msgs consumed, position %lld, "
+                        "high watermark %lld, lag %lld, peak lag %lld",
+                        i, stats->partition_consumed[i], (long long)lag->position[i],
+                        (long long)lag->high_watermark[i], (long long)lag->lag[i],
+                        (long long)lag->max_lag[i]);
+        } else {
+            log_message(1, "INFO", "  Partition %d%s: %lld msgs consumed%s",
+                        i, i == MAX_TRACKED_PARTITIONS - 1 ? "+" : "", stats->partition_consumed[i],
+                        lag->assigned[i] ? ", lag unknown" : ", no longer assigned");
+        }
+    }
+}
+
+/*
+ * Account, print and (unless the offset is tracked by key dispatch) store
+ * the offset of one message or consumer event (the caller destroys the message)
+ */
+static void handle_consumed_message(const Config *config, ConsumerStats *stats,
+                                    ConsumerProgress *progress, rd_kafka_message_t *rkmessage,
+                                    int *msg_count, int store_offset) {
+    PayloadHeader header;
+    int64_t e2e_latency_ns = 0;
+    int has_header;
+    
+    if (rkmessage->err) {
+        if (rkmessage->err == RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+            log_message(config->verbose, "DEBUG", "Reached end of partition");
+        } else {
+            log_message(1, "ERROR", "Consumer error: %s",
+                        rd_kafka_message_errstr(rkmessage));
+            ATOMIC_ADD(&stats->errors, 1);
+        }
+        return;
+    }
+    
+    /* Valid message received */
+    (*msg_count)++;
+    has_header = record_consumed_message(stats, rkmessage, &header, &e2e_latency_ns);
+    
+    if (config->consumer_quiet) {
+        /* One line per sampled message, nothing for the rest */
+        if ((config->consumer_sample_every > 0 || config->consumer_sample_per_sec > 0) &&
+            should_print_message(config, progress, *msg_count, get_time_ns())) {
+            if (has_header) {
+                log_message(1, "INFO", "Message %d: partition %d, offset %lld, key %.*s, "
+                            "%d bytes, producer %u, sequence %llu, end-to-end %.3f ms",
+                            *msg_count, (int)rkmessage->partition, (long long)rkmessage->offset,
+                            (int)rkmessage->key_len, (char *)rkmessage->key, (int)rkmessage->len,
+                            header.producer_id, (unsigned long long)header.sequence,
+                            (double)e2e_latency_ns / 1e6);
+            } else {
+                log_message(1, "INFO", "Message %d: partition %d, offset %lld, key %.*s, %d bytes",
+                            *msg_count, (int)rkmessage->partition, (long long)rkmessage->offset,
+                            (int)rkmessage->key_len, (char *)rkmessage->key, (int)rkmessage->len);
+            }
+        }
+    } else {
+        log_message(1, "INFO", "Received message %d:", *msg_count);
+        log_message(1, "INFO", "  Topic: %s", rd_kafka_topic_name(rkmessage->rkt));
+        log_message(1, "INFO", "  Partition: %d", (int)rkmessage->partition);
+        log_message(1, "INFO", "  Offset: %lld", (long long)rkmessage->offset);
+        log_message(1, "INFO", "  Key: %.*s",
+                    (int)rkmessage->key_len, (char *)rkmessage->key);
+        if (has_header) {
+            log_message(1, "INFO", "  Producer: %u, Sequence: %llu, End-to-end: %.3f ms",
+                        header.producer_id, (unsigned long long)header.sequence,
+                        (double)e2e_latency_ns / 1e6);
+            log_message(1, "INFO", "  Value: %.*s",
+                        (int)(rkmessage->len - PAYLOAD_HEADER_SIZE),
+                        (char *)rkmessage->payload + PAYLOAD_HEADER_SIZE);
+        } else {
+            log_message(1, "INFO", "  Value: %.*s",
+                        (int)rkmessage->len, (char *)rkmessage->payload);
+        }
+    }
+    
+    if (config->consumer_work_us > 0) {
+        burn_cpu_us(config->consumer_work_us);
+    }
+    
+    /* Store offset */
+    if (store_offset) {
+        rd_kafka_offset_store(rkmessage->rkt, rkmessage->partition, rkmessage->offset);
+    }
+}
+
+/*
+ * Spin for the given number of microseconds to simulate per-message processing
+ */
+static void burn_cpu_us(int microseconds) {
+    int64_t until_ns = get_time_ns() + (int64_t)microseconds * 1000;
+    
+    while (get_time_ns() < until_ns) {
+        /* busy wait: the point is to use the CPU */
+    }
+}
+
+/*
+ * Worker thread: handle messages from its queue until stopped and drained
+ */
+static thread_ret_t THREAD_CALL consumer_worker_main(void *arg) {
+    ConsumerWorker *worker = (ConsumerWorker *)arg;
+    MessageQueue *queue = &worker->queue;
+    rd_kafka_message_t *rkmessage;
+    uint64_t tail;
+    int64_t start_ns;
+    int *done;
+    
+    for (;;) {
+        tail = queue->tail;
+        if (ATOMIC_LOAD_ACQUIRE(&queue->head) == tail) {
+            if (ATOMIC_LOAD_ACQUIRE(&worker->stop)) {
+                break;
+            }
+            sleep_ms(1);
+            continue;
+        }
+        
+        rkmessage = queue->ring[tail % (uint64_t)queue->capacity];
+        done = queue->done[tail % (uint64_t)queue->capacity];
+        ATOMIC_STORE_RELEASE(&queue->tail, tail + 1);
+        
+        start_ns = get_time_ns();
+        handle_consumed_message(worker->config, worker->stats, worker->progress,
+                                rkmessage, &worker->msg_count, done == NULL);
+        rd_kafka_message_destroy(rkmessage);
+        if (done) {
+            ATOMIC_STORE_RELEASE(done, 1);
+        }
+        ATOMIC_ADD(&worker->busy_ns, get_time_ns() - start_ns);
+    }
+    
+    return 0;
+}
+
+/*
+ * Allocate the worker queues and start the worker threads
+ * Returns 0 on success
+ */
+static int start_worker_pool(WorkerPool *pool, rd_kafka_t *rk, const Config *config,
+                             ConsumerStats *stats) {
+    int queue_size = config->consumer_worker_queue_size > 0 ? config->consumer_worker_queue_size : 1;
+    int i;
+    
+    memset(pool, 0, sizeof(*pool));
+    pool->rk = rk;
+    pool->config = config;
+    pool->high_watermark = queue_size * 3 / 4 > 0 ? queue_size * 3 / 4 : 1;
+    pool->low_watermark = queue_size / 4;
+    pool->workers = (ConsumerWorker *)calloc((size_t)config->consumer_workers, sizeof(ConsumerWorker));
+    if (!pool->workers) {
+        return -1;
+    }
+    
+    for (i = 0; i < config->consumer_workers; i++) {
+        ConsumerWorker *worker = &pool->workers[i];
+        
+        worker->config = config;
+        worker->index = i;
+        worker->stats = stats;
+        worker->queue.capacity = queue_size;
+        worker->queue.ring = (rd_kafka_message_t **)calloc((size_t)queue_size,
+                                                           sizeof(rd_kafka_message_t *));
+        worker->queue.done = (int **)calloc((size_t)queue_size, sizeof(int *));
+        worker->progress = (ConsumerProgress *)calloc(1, sizeof(ConsumerProgress));
+        if (!worker->queue.ring || !worker->queue.done || !worker->progress) {
+            free(worker->queue.ring);
+            free(worker->queue.done);
+            free(worker->progress);
+            break;
+        }
+        if (thread_create(&worker->thread, consumer_worker_main, worker) != 0) {
+            log_message(1, "ERROR", "Failed to start consumer worker %d", i);
+            free(worker->queue.ring);
+            free(worker->queue.done);
+            free(worker->progress);
+            break;
+        }
+        pool->worker_count++;
+    }
+    
+    if (pool->worker_count < config->consumer_workers) {
+        stop_worker_pool(pool);
+        return -1;
+    }
+    
+    log_message(1, "INFO", "Started %d consumer workers (dispatch by %s, queue %d, "
+                "pause at %d, resume at %d)", pool->worker_count,
+                dispatch_names[config->consumer_dispatch], queue_size,
+                pool->high_watermark, pool->low_watermark);
+    return 0;
+}
+
+/*
+ * Let the workers drain their queues, join them, store the offsets they
+ * completed and free the queues
+ */
+static void stop_worker_pool(WorkerPool *pool) {
+    int i;
+    
+    for (i = 0; i < pool->worker_count; i++) {
+        ATOMIC_STORE_RELEASE(&pool->workers[i].stop, 1);
+    }
+    for (i = 0; i < pool->worker_count; i++) {
+        thread_join(pool->workers[i].thread);
+        free(pool->workers[i].queue.ring);
+        free(pool->workers[i].queue.done);
+        free(pool->workers[i].progress);
+        pool->workers[i].queue.ring = NULL;
+        pool->workers[i].queue.done = NULL;
+        pool->workers[i].progress = NULL;
+    }
+    
+    store_completed_offsets(pool);
+    for (i = 0; i < MAX_TRACKED_PARTITIONS; i++) {
+        if (pool->trackers[i]) {
+            free(pool->trackers[i]->offsets);
+            free(pool->trackers[i]->done);
+            free(pool->trackers[i]);
+            pool->trackers[i] = NULL;
+        }
+    }
+}
+
+/*
+ * Pause or resume fetching of one partition
+ */
+static void set_partition_paused(rd_kafka_t *rk, const char *topic, int partition, int paused) {
+    rd_kafka_topic_partition_list_t *list = rd_kafka_topic_partition_list_new(1);
+    rd_kafka_resp_err_t err;
+    
+    rd_kafka_topic_partition_list_add(list, topic, partition);
+    err = paused ? rd_kafka_pause_partitions(rk, list) : rd_kafka_resume_partitions(rk, list);
+    if (err) {
+        log_message(1, "WARNING", "Failed to %s partition %d: %s",
+                    paused ? "pause" : "resume", partition, rd_kafka_err2str(err));
+    }
+    rd_kafka_topic_partition_list_destroy(list);
+}
+
+/*
+ * The offset tracker of a partition, allocated on first use. Every message
+ * of the partition in a worker queue or being handled takes a slot.
+ * Returns NULL if it cannot be allocated; the partition is then dispatched
+ * by partition, which keeps its offsets in order.
+ */
+static OffsetTracker *get_offset_tracker(WorkerPool *pool, int partition) {
+    OffsetTracker *tracker = pool->trackers[partition];
+    
+    if (tracker) {
+        return tracker;
+    }
+    tracker = (OffsetTracker *)calloc(1, sizeof(OffsetTracker));
+    if (!tracker) {
+        return NULL;
+    }
+    tracker->capacity = pool->worker_count * (pool->workers[0].queue.capacity + 1);
+    tracker->offsets = (int64_t *)malloc((size_t)tracker->capacity * sizeof(int64_t));
+    tracker->done = (int *)calloc((size_t)tracker->capacity, sizeof(int));
+    if (!tracker->offsets || !tracker->done) {
+        free(tracker->offsets);
+        free(tracker->done);
+        free(tracker);
+        return NULL;
+    }
+    pool->trackers[partition] = tracker;
+    return tracker;
+}
+
+/*
+ * Key dispatch: store each partition's offset up to its first message not
+ * yet handled, so a commit never skips a message still queued
+ */
+static void store_completed_offsets(WorkerPool *pool) {
+    rd_kafka_topic_partition_list_t *offsets = NULL;
+    OffsetTracker *tracker;
+    int64_t next_offset;
+    int partition, slot;
+    
+    for (partition = 0; partition < MAX_TRACKED_PARTITIONS; partition++) {
+        tracker = pool->trackers[partition];
+        if (!tracker) {
+            continue;
+        }
+        next_offset = -1;
+        while (tracker->tail != tracker->head) {
+            slot = (int)(tracker->tail % (uint64_t)tracker->capacity);
+            if (!ATOMIC_LOAD_ACQUIRE(&tracker->done[slot])) {
+                break;
+            }
+            next_offset = tracker->offsets[slot] + 1;
+            tracker->done[slot] = 0;
+            tracker->tail++;
+        }
+        if (next_offset >= 0) {
+            if (!offsets) {
+                offsets = rd_kafka_topic_partition_list_new(16);
+            }
+            rd_kafka_topic_partition_list_add(offsets, pool->config->topic, partition);
+            offsets->elems[offsets->cnt - 1].offset = next_offset;
+        }
+    }
+    
+    if (offsets) {
+        /* Refused for partitions revoked meanwhile; their new owner goes on from the commit */
+        rd_kafka_offsets_store(pool->rk, offsets);
+        rd_kafka_topic_partition_list_destroy(offsets);
+    }
+}
+
+/*
+ * Hand a message to its worker. Messages of one partition (or one key)
+ * always go to the same worker, so their processing order is preserved.
+ * A partition is paused when its worker falls behind; if the queue fills
+ * anyway (messages fetched before the pause) the dispatcher waits.
+ */
+static void dispatch_message(WorkerPool *pool, rd_kafka_message_t *rkmessage) {
+    ConsumerWorker *worker;
+    MessageQueue *queue;
+    OffsetTracker *tracker = NULL;
+    uint64_t head, hash = 14695981039346656037ULL;
+    int64_t wait_start_ns;
+    int depth, partition = (int)rkmessage->partition;
+    int *done = NULL;
+    size_t i;
+    
+    /* Key dispatch tracks every message of the partition, keyed or not */
+    if (pool->config->consumer_dispatch == DISPATCH_KEY && partition >= 0 &&
+        partition < MAX_TRACKED_PARTITIONS) {
+        tracker = get_offset_tracker(pool, partition);
+    }
+    if (tracker && rkmessage->key) {
+        /* FNV-1a over the key */
+        for (i = 0; i < rkmessage->key_len; i++) {
+            hash = (hash ^ ((const unsigned char *)rkmessage->key)[i]) * 1099511628211ULL;
+        }
+        worker = &pool->workers[hash % (uint64_t)pool->worker_count];
+    } else {
+        worker = &pool->workers[(partition < 0 ? 0 : partition) % pool->worker_count];
+    }
+    queue = &worker->queue;
+    head = queue->head;
+    
+    if (head - ATOMIC_LOAD_ACQUIRE(&queue->tail) >= (uint64_t)queue->capacity) {
+        wait_start_ns = get_time_ns();
+        while (head - ATOMIC_LOAD_ACQUIRE(&queue->tail) >= (uint64_t)queue->capacity) {
+            sleep_ms(1);
+        }
+        pool->full_wait_ns += get_time_ns() - wait_start_ns;
+    }
+    
+    if (tracker) {
+        /* Handled but not yet stored offsets hold slots too: store them to make room */
+        while (tracker->head - tracker->tail >= (uint64_t)tracker->capacity) {
+            store_completed_offsets(pool);
+            if (tracker->head - tracker->tail >= (uint64_t)tracker->capacity) {
+                sleep_ms(1);
+            }
+        }
+        done = &tracker->done[tracker->head % (uint64_t)tracker->capacity];
+        tracker->offsets[tracker->head % (uint64_t)tracker->capacity] = rkmessage->offset;
+        tracker->head++;
+    }
+    
+    queue->ring[head % (uint64_t)queue->capacity] = rkmessage;
+    queue->done[head % (uint64_t)queue->capacity] = done;
+    ATOMIC_STORE_RELEASE(&queue->head, head + 1);
+    
+    depth = (int)(head + 1 - ATOMIC_LOAD_ACQUIRE(&queue->tail));
+    if (depth > worker->max_depth) {
+        worker->max_depth = depth;
+    }
+    
+    if (depth >= pool->high_watermark && partition >= 0 && partition < MAX_TRACKED_PARTITIONS &&
+        pool->paused_by[partition] == 0) {
+        set_partition_paused(pool->rk, rd_kafka_topic_name(rkmessage->rkt), partition, 1);
+        pool->paused_by[partition] = worker->index + 1;
+        pool->paused_since_ns[partition] = get_time_ns();
+        pool->pause_events++;
+        log_message(pool->config->verbose, "DEBUG", "Paused partition %d: worker %d has %d queued",
+                    partition, worker->index, depth);
+    }
+}
+
+/*
+ * Resume partitions whose worker has drained below the low watermark
+ */
+static void resume_drained_partitions(WorkerPool *pool) {
+    const MessageQueue *queue;
+    int partition;
+    
+    if (pool->pause_events == 0) {
+        return;
+    }
+    
+    for (partition = 0; partition < MAX_TRACKED_PARTITIONS; partition++) {
+        if (pool->paused_by[partition] == 0) {
+            continue;
+        }
+        queue = &pool->workers[pool->paused_by[partition] - 1].queue;
+        if (ATOMIC_LOAD(&queue->head) - ATOMIC_LOAD_ACQUIRE(&queue->tail) <=
+            (uint64_t)pool->low_watermark) {
+            set_partition_paused(pool->rk, pool->config->topic, partition, 0);
+            pool->paused_by[partition] = 0;
+            pool->paused_ns += get_time_ns() - pool->paused_since_ns[partition];
+        }
+    }
+}
+
+/*
+ * Print per-worker throughput, utilisation and queue depth
+ */
+static void print_worker_pool_summary(const WorkerPool *pool, int64_t elapsed_ns) {
+    double elapsed_sec = (double)elapsed_ns / 1e9;
+    int64_t busy_total_ns = 0;
+    int64_t busy_ns;
+    int i;
+    
+    if (elapsed_sec <= 0.0) {
+        elapsed_sec = 1e-9;
+    }
+    
+    log_message(1, "INFO", "Worker  Messages      msg/s  Busy %%  Max queue");
+    for (i = 0; i < pool->worker_count; i++) {
+        const ConsumerWorker *worker = &pool->workers[i];
+        int msg_count = ATOMIC_LOAD(&worker->msg_count);
+        
+        busy_ns = ATOMIC_LOAD(&worker->busy_ns);
+        busy_total_ns += busy_ns;
+        log_message(1, "INFO", "%6d  %8d  %9.1f  %6.1f  %9d",
+                    i, msg_count, (double)msg_count / elapsed_sec,
+                    100.0 * (double)busy_ns / 1e9 / elapsed_sec, ATOMIC_LOAD(&worker->max_depth));
+    }
+    log_message(1, "INFO", "Busy cores: %.2f of %d workers",
+                (double)busy_total_ns / 1e9 / elapsed_sec, pool->worker_count);
+    log_message(1, "INFO", "Backpressure: %lld partition pauses, %.3f s paused, "
+                "dispatcher waited %.3f s on full queues",
+                pool->pause_events, (double)pool->paused_ns / 1e9,
+                (double)pool->full_wait_ns / 1e9);
+}
+
+/*
+ * Consume messages from Kafka until done, Ctrl+C, or *stop is set (stop may be NULL)
+ */
+static int consume_messages(rd_kafka_t *rk, const Config *config, const int *stop, RunResult *run_result) {
+    rd_kafka_topic_partition_list_t *topics;
+    rd_kafka_resp_err_t err;
+    rd_kafka_message_t *rkmessage;
+    rd_kafka_message_t **batch = NULL;
+    rd_kafka_message_t **messages;
+    rd_kafka_queue_t *queue = NULL;
+    ssize_t batch_count;
+    int msg_count = 0;
+    ConsumerStats *stats;
+    ConsumerProgress *progress;
+    int64_t join_ns, start_ns, now_ns, call_ns;
+    int64_t report_interval_ns = (int64_t)config->report_interval_sec * 1000000000LL;
+    WorkerPool *pool = NULL;
+    ClientContext *context = (ClientContext *)rd_kafka_opaque(rk);
+    CommitState *commit = context->commit;
+    ConsumerLag *lag;
+    Config churn_config;
+    thread_t churn_thread;
+    int churn_started = 0;
+    int64_t last_statistics_ns;
+    Dashboard dashboard;
+    int i;
+    
+    global_kafka_handle = rk;
+    memset(&dashboard, 0, sizeof(dashboard));
+    
+    stats = (ConsumerStats *)calloc(1, sizeof(ConsumerStats));
+    progress = (ConsumerProgress *)calloc(1, sizeof(ConsumerProgress));
+    lag = (ConsumerLag *)calloc(1, sizeof(ConsumerLag));
+    if (config->consumer_batch_size > 1) {
+        batch = (rd_kafka_message_t **)calloc((size_t)config->consumer_batch_size,
+                                              sizeof(rd_kafka_message_t *));
+    }
+    if (!stats || !progress || !lag || (config->consumer_batch_size > 1 && !batch)) {
+        log_message(1, "ERROR", "Failed to allocate consumer statistics");
+        free(stats);
+        free(progress);
+        free(lag);
+        free(batch);
+        return 1;
+    }
+    
+    /* Subscribe to topic, or assign partitions directly without joining the group */
+    join_ns = get_time_ns();
+    if (strlen(config->consumer_assign) > 0) {
+        topics = parse_partition_offsets(config->consumer_assign, config->topic);
+        err = topics ? rd_kafka_assign(rk, topics) : RD_KAFKA_RESP_ERR__INVALID_ARG;
+    } else {
+        topics = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(topics, config->topic, RD_KAFKA_PARTITION_UA);
+        err = rd_kafka_subscribe(rk, topics);
+    }
+    if (err) {
+        log_message(1, "ERROR", "Failed to %s topic: %s",
+                    strlen(config->consumer_assign) > 0 ? "assign partitions of" : "subscribe to",
+                    rd_kafka_err2str(err));
+        if (topics) {
+            rd_kafka_topic_partition_list_destroy(topics);
+        }
+        free(stats);
+        free(progress);
+        free(lag);
+        free(batch);
+        return 1;
+    }
+    
+    rd_kafka_topic_partition_list_destroy(topics);
+    
+    /* Batched mode drains the consumer group queue directly */
+    if (batch) {
+        queue = rd_kafka_queue_get_consumer(rk);
+        if (!queue) {
+            log_message(1, "ERROR", "Failed to get the consumer queue (is group.id set?)");
+            free(stats);
+            free(progress);
+            free(lag);
+            free(batch);
+            return 1;
+        }
+        log_message(1, "INFO", "Batched consume: up to %d messages per call", config->consumer_batch_size);
+    }
+    
+    /* Worker pool: the polling thread only dispatches */
+    if (config->consumer_workers > 0) {
+        pool = (WorkerPool *)malloc(sizeof(WorkerPool));
+        if (!pool || start_worker_pool(pool, rk, config, stats) != 0) {
+            log_message(1, "ERROR", "Failed to start the consumer worker pool");
+            if (queue) {
+                rd_kafka_queue_destroy(queue);
+            }
+            free(pool);
+            free(stats);
+            free(progress);
+            free(lag);
+            free(batch);
+            return 1;
+        }
+    }
+    
+    if (strlen(config->consumer_assign) > 0) {
+        log_message(1, "INFO", "Assigned partitions %s of topic '%s' (no group membership)",
+                    config->consumer_assign, config->topic);
+    } else {
+        log_message(1, "INFO", "Subscribed to topic '%s'", config->topic);
+    }
+    log_message(1, "INFO", "Waiting for messages... (Press Ctrl+C to stop)");
+    start_ns = get_time_ns();
+    progress->start_ns = start_ns;
+    progress->last_report_ns = start_ns;
+    last_statistics_ns = start_ns;
+    if (run_result) {
+        start_run_result(run_result, "consumer", start_ns);
+    }
+    
+    /* Rebalance churn: another member of the same group, never committing */
+    if (config->consumer_rebalance_churn_sec > 0 && strlen(config->consumer_assign) == 0) {
+        churn_config = *config;
+        strcpy(churn_config.consumer_enable_auto_commit, "false");
+        churn_config.consumer_commit_policy = COMMIT_NONE;
+        if (thread_create(&churn_thread, churn_member_main, &churn_config) == 0) {
+            churn_started = 1;
+        } else {
+            log_message(1, "WARNING", "Failed to start the rebalance churn member");
+        }
+    }
+    
+    if (config->dashboard) {
+        dashboard.config = config;
+        dashboard.mode = "consumer";
+        dashboard.rk = rk;
+        dashboard.consumer_stats = stats;
+        dashboard.pool = pool;
+        start_dashboard(&dashboard);
+    }
+    attach_consumer_metrics(rk, stats);
+    
+    /* Consume messages */
+    while (run && !(stop && ATOMIC_LOAD(stop)) &&
+           (config->message_count == 0 || msg_count < config->message_count)) {
+        /*
+         * Only a non-blocking call that returned something is timed, so the
+         * per-call cost excludes waiting for messages or for a batch to fill.
+         * With nothing queued, wait untimed.
+         */
+        call_ns = get_time_ns();
+        batch_count = consume_call(rk, queue, batch, config->consumer_batch_size, &rkmessage, 0);
+        now_ns = get_time_ns();
+        if (batch_count > 0) {
+            stats->poll_calls++;
+            stats->poll_messages += (long long)batch_count;
+            stats->poll_ns += now_ns - call_ns;
+        } else {
+            stats->empty_polls++;
+            batch_count = consume_call(rk, queue, batch, config->consumer_batch_size, &rkmessage, 1000);
+            now_ns = get_time_ns();
+        }
+        
+        /* Quiet mode reports progress instead of printing messages */
+        if (config->consumer_quiet && report_interval_ns > 0 &&
+            now_ns - progress->last_report_ns >= report_interval_ns) {
+            report_consumer_progress(stats, progress, now_ns);
+        }
+        
+        /* Lag is reported in both modes: it says whether we can catch up */
+        if (report_interval_ns > 0 && now_ns - lag->last_update_ns >= report_interval_ns &&
+            update_consumer_lag(rk, lag, now_ns) == 0 && lag->partitions > 0) {
+            report_consumer_lag(lag);
+        }
+        if (config->statistics_interval_ms > 0 && report_interval_ns > 0 &&
+            now_ns - last_statistics_ns >= report_interval_ns) {
+            log_client_statistics(&context->statistics, "  ", 0);
+            last_statistics_ns = now_ns;
+        }
+        if (run_result) {
+            sample_run_result(run_result, now_ns, ATOMIC_LOAD(&stats->consumed), ATOMIC_LOAD(&stats->bytes),
+                              ATOMIC_LOAD(&stats->errors), &stats->e2e_latency);
+        }
+        
+        messages = batch ? batch : &rkmessage;
+        if (batch_count > 0 && !messages[0]->err) {
+            note_message_flow(context, now_ns);
+        }
+        if (stats->first_message_ns == 0) {
+            for (i = 0; i < (int)batch_count; i++) {
+                if (!messages[i]->err) {
+                    stats->first_message_ns = now_ns - join_ns;
+                    log_message(1, "INFO", "First message after %.1f ms",
+                                (double)stats->first_message_ns / 1e6);
+                    break;
+                }
+            }
+        }
+        for (i = 0; i < (int)batch_count; i++) {
+            if (config->message_count > 0 && msg_count >= config->message_count) {
+                rd_kafka_message_destroy(messages[i]);
+            } else if (pool && !messages[i]->err) {
+                /* The worker handles and destroys it */
+                msg_count++;
+                dispatch_message(pool, messages[i]);
+            } else {
+                handle_consumed_message(config, stats, progress, messages[i], &msg_count, 1);
+                rd_kafka_message_destroy(messages[i]);
+            }
+        }
+        
+        if (pool) {
+            resume_drained_partitions(pool);
+            store_completed_offsets(pool);
+        }
+        if (commit) {
+            maybe_commit(rk, config, commit, ATOMIC_LOAD(&stats->consumed), now_ns);
+        }
+    }
+    
+    stop_dashboard(&dashboard);
+    if (churn_started) {
+        /* Leaves the group at its next check of run */
+        run = 0;
+        thread_join(churn_thread);
+    }
+    if (pool) {
+        log_message(1, "INFO", "Waiting for workers to drain their queues...");
+        stop_worker_pool(pool);
+    }
+    if (commit) {
+        /* Final commit of everything handled */
+        commit_offsets_sync(rk, commit);
+    }
+    if (queue) {
+        rd_kafka_queue_destroy(queue);
+    }
+    
+    now_ns = get_time_ns();
+    update_consumer_lag(rk, lag, now_ns);
+    log_message(1, "INFO", "Consumed %d messages", msg_count);
+    print_consumer_summary(stats, now_ns - start_ns);
+    if (run_result) {
+        finish_run_result(run_result, now_ns - start_ns, stats->consumed, stats->bytes, stats->errors,
+                          &stats->e2e_latency);
+    }
+    print_lag_summary(lag, stats);
+    print_rebalance_summary(context->rebalance);
+    if (config->statistics_interval_ms > 0) {
+        log_client_statistics(&context->statistics, "Last statistics: ", 1);
+    }
+    if (commit) {
+        print_commit_summary(commit, now_ns - start_ns);
+    }
+    if (pool) {
+        print_worker_pool_summary(pool, now_ns - start_ns);
+        free(pool->workers);
+        free(pool);
+    }
+    detach_metrics();
+    free(stats);
+    free(progress);
+    free(lag);
+    free(batch);
+    return 0;
+}
+
+/*
+ * Begin collecting the result of a run that starts now. result->name is
+ * set by the caller; it defaults to the mode.
+ */
+static void start_run_result(RunResult *result, const char *mode, int64_t start_ns) {
+    result->mode = mode;
+    if (result->name[0] == '\0') {
+        strncpy(result->name, mode, sizeof(result->name) - 1);
+    }
+    result->started = time(NULL);
+    result->start_ns = start_ns;
+    result->start_cpu_ns = get_process_cpu_ns();
+    result->last_ns = start_ns;
+    result->last_cpu_ns = result->start_cpu_ns;
+    result->last_messages = 0;
+    result->last_bytes = 0;
+    memset(&result->last_latency, 0, sizeof(result->last_latency));
+    result->sample_count = 0;
+    result->finished = 0;
+}
+
+/*
+ * Add a sample if a second has passed since the last one. The counters are
+ * cumulative; the latency histogram is the run's live one.
+ */
+static void sample_run_result(RunResult *result, int64_t now_ns, long long messages, long long bytes,
+                              long long errors, const LatencyHistogram *latency) {
+    double interval_sec = (double)(now_ns - result->last_ns) / 1e9;
+    int64_t cpu_ns;
+    ResultSample *sample;
+    
+    if (interval_sec < 1.0) {
+        return;
+    }
+    if (result->sample_count == result->sample_capacity) {
+        int capacity = result->sample_capacity > 0 ? result->sample_capacity * 2 : 256;
+        ResultSample *samples = (ResultSample *)realloc(result->samples, (size_t)capacity * sizeof(ResultSample));
+        
+        if (!samples) {
+            return;
+        }
+        result->samples = samples;
+        result->sample_capacity = capacity;
+    }
+    
+    cpu_ns = get_process_cpu_ns();
+    hist_delta(latency, &result->last_latency, &result->interval_latency);
+    sample = &result->samples[result->sample_count++];
+    sample->elapsed_sec = (double)(now_ns - result->start_ns) / 1e9;
+    sample->messages = messages;
+    sample->msgs_per_sec = (double)(messages - result->last_messages) / interval_sec;
+    sample->mb_per_sec = (double)(bytes - result->last_bytes) / (1024.0 * 1024.0) / interval_sec;
+    sample->p99_ms = (double)hist_percentile(&result->interval_latency, 99.0) / 1e6;
+    sample->errors = errors;
+    sample->cpu_pct = (double)(cpu_ns - result->last_cpu_ns) / 1e7 / interval_sec;
+    sample->rss_mb = (double)get_process_rss_bytes(0) / (1024.0 * 1024.0);
+    
+    result->last_ns = now_ns;
+    result->last_cpu_ns = cpu_ns;
+    result->last_messages = messages;
+    result->last_bytes = bytes;
+}
+
+/*
+ * Record the summary of a finished run
+ */
+static void finish_run_result(RunResult *result, int64_t elapsed_ns, long long messages, long long bytes,
+                              long long errors, const LatencyHistogram *latency) {
+    result->elapsed_sec = (double)elapsed_ns / 1e9;
+    result->messages = messages;
+    result->bytes = bytes;
+    result->errors = errors;
+    result->latency_ms[0] = (double)hist_percentile(latency, 50.0) / 1e6;
+    result->latency_ms[1] = (double)hist_percentile(latency, 90.0) / 1e6;
+    result->latency_ms[2] = (double)hist_percentile(latency, 99.0) / 1e6;
+    result->latency_ms[3] = (double)hist_percentile(latency, 99.9) / 1e6;
+    result->latency_ms[4] = (double)ATOMIC_LOAD(&latency->max_value) / 1e6;
+    result->cpu_sec = (double)(get_process_cpu_ns() - result->start_cpu_ns) / 1e9;
+    result->peak_rss_mb = (double)get_process_rss_bytes(1) / (1024.0 * 1024.0);
+    result->finished = 1;
+}
+
+/*
+ * Release the sample series of a run result
+ */
+static void free_run_result(RunResult *result) {
+    free(result->samples);
+    result->samples = NULL;
+    result->sample_count = 0;
+    result->sample_capacity = 0;
+}
+
+/*
+ * Write <result_dir>/<log file name>.json with the configuration and every
+ * finished run's summary and series, and a .csv with the series alone
+ * Returns 0 on success
+ */
+static int write_result_files(const Config *config, const char *command, const RunResult *results,
+                              int result_count) {
+    char base[MAX_FILENAME_LENGTH * 2];
+    char path[MAX_VALUE_LENGTH + MAX_FILENAME_LENGTH * 2 + 8];
+    const char *name = log_file_path;
+    const char *separator;
+    char *extension;
+    FILE *file;
+    int i, j;
+    
+    if (config->result_dir[0] == '\0') {
+        return 0;
+    }
+    
+    /* Same name as the log file, so the two are easy to pair up */
+    for (separator = log_file_path; *separator; separator++) {
+        if (*separator == '/' || *separator == '\\') {
+            name = separator + 1;
+        }
+    }
+    if (*name) {
+        strncpy(base, name, sizeof(base) - 1);
+        base[sizeof(base) - 1] = '\0';
+        extension = strrchr(base, '.');
+        if (extension) {
+            *extension = '\0';
+        }
+    } else {
+        sanitize_filename(base, command, sizeof(base));
+    }
+    mkdir(config->result_dir, 0755);
+    
+    snprintf(path, sizeof(path), "%s/%s.json", config->result_dir, base);
+    file = fopen(path, "w");
+    if (!file) {
+        log_message(1, "WARNING", "Failed to write result file %s", path);
+        return -1;
+    }
+    write_result_json(file, config, command, results, result_count);
+    fclose(file);
+    log_message(1, "INFO", "Result written to %s", path);
+    
+    snprintf(path, sizeof(path), "%s/%s.csv", config->result_dir, base);
+    file = fopen(path, "w");
+    if (!file) {
+        log_message(1, "WARNING", "Failed to write result file %s", path);
+        return -1;
+    }
+    fprintf(file, "run,elapsed_sec,messages,msgs_per_sec,mb_per_sec,p99_ms,errors,cpu_pct,rss_mb\n");
+    for (i = 0; i < result_count; i++) {
+        if (!results[i].finished) {
+            continue;
+        }
+        for (j = 0; j < results[i].sample_count; j++) {
+            const ResultSample *sample = &results[i].samples[j];
+            
+            fprintf(file, "%s,%.3f,%lld,%.1f,%.3f,%.3f,%lld,%.1f,%.1f\n", results[i].name,
+                    sample->elapsed_sec, sample->messages, sample->msgs_per_sec, sample->mb_per_sec,
+                    sample->p99_ms, sample->errors, sample->cpu_pct, sample->rss_mb);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/*
+ * The JSON result document. Summary fields are flat numbers so compare can
+ * read them back with a single pass.
+ */
+static void write_result_json(FILE *file, const Config *config, const char *command,
+                              const RunResult *results, int result_count) {
+    char started[32];
+    int written = 0;
+    int i, j;
+    
+    fprintf(file, "{\n  \"tool\": \"kafka_cli\",\n  \"version\": \"%s\",\n  \"librdkafka\": ", VERSION);
+    write_json_string(file, rd_kafka_version_str());
+    fprintf(file, ",\n  \"command\": ");
+    write_json_string(file, command);
+    fprintf(file, ",\n  \"config\": ");
+    write_config_snapshot(file, config);
+    fprintf(file, ",\n  \"runs\": [");
+    for (i = 0; i < result_count; i++) {
+        const RunResult *result = &results[i];
+        double elapsed_sec = result->elapsed_sec > 0.0 ? result->elapsed_sec : 1e-9;
+        
+        if (!result->finished) {
+            continue;
+        }
+        strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%S", localtime(&result->started));
+        fprintf(file, "%s\n    {\n      \"name\": ", written++ > 0 ? "," : "");
+        write_json_string(file, result->name);
+        fprintf(file, ",\n      \"mode\": \"%s\",\n      \"started\": \"%s\",\n", result->mode, started);
+        fprintf(file, "      \"summary\": {\n");
+        fprintf(file, "        \"elapsed_sec\": %.3f,\n", result->elapsed_sec);
+        fprintf(file, "        \"messages\": %lld,\n", result->messages);
+        fprintf(file, "        \"bytes\": %lld,\n", result->bytes);
+        fprintf(file, "        \"msgs_per_sec\": %.1f,\n", (double)result->messages / elapsed_sec);
+        fprintf(file, "        \"mb_per_sec\": %.3f,\n", (double)result->bytes / (1024.0 * 1024.0) / elapsed_sec);
+        fprintf(file, "        \"latency_p50_ms\": %.3f,\n", result->latency_ms[0]);
+        fprintf(file, "        \"latency_p90_ms\": %.3f,\n", result->latency_ms[1]);
+        fprintf(file, "        \"latency_p99_ms\": %.3f,\n", result->latency_ms[2]);
+        fprintf(file, "        \"latency_p999_ms\": %.3f,\n", result->latency_ms[3]);
+        fprintf(file, "        \"latency_max_ms\": %.3f,\n", result->latency_ms[4]);
+        fprintf(file, "        \"errors\": %lld,\n", result->errors);
+        fprintf(file, "        \"cpu_sec\": %.3f,\n", result->cpu_sec);
+        fprintf(file, "        \"cpu_pct\": %.1f,\n", result->cpu_sec * 100.0 / elapsed_sec);
+        fprintf(file, "        \"cpu_us_per_message\": %.3f,\n",
+                result->messages > 0 ? result->cpu_sec * 1e6 / (double)result->messages : 0.0);
+        fprintf(file, "        \"peak_rss_mb\": %.1f\n", result->peak_rss_mb);
+        fprintf(file, "      },\n      \"series\": [");
+        for (j = 0; j < result->sample_count; j++) {
+            const ResultSample *sample = &result->samples[j];
+            
+            fprintf(file, "%s\n        {\"elapsed_sec\": %.3f, \"messages\": %lld, \"msgs_per_sec\": %.1f, "
+                    "\"mb_per_sec\": %.3f, \"p99_ms\": %.3f, \"errors\": %lld, \"cpu_pct\": %.1f, \"rss_mb\": %.1f}",
+                    j > 0 ? "," : "", sample->elapsed_sec, sample->messages, sample->msgs_per_sec,
+                    sample->mb_per_sec, sample->p99_ms, sample->errors, sample->cpu_pct, sample->rss_mb);
+        }
+        fprintf(file, "%s]\n    }", result->sample_count > 0 ? "\n      " : "");
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+/*
+ * The settings that shape a run's numbers (no certificate paths or passwords)
+ */
+static void write_config_snapshot(FILE *file, const Config *config) {
+    fprintf(file, "{\n    \"brokers\": ");
+    write_json_string(file, config->brokers);
+    fprintf(file, ",\n    \"topic\": ");
+    write_json_string(file, config->topic);
+    fprintf(file, ",\n    \"security_protocol\": ");
+    write_json_string(file, config->security_protocol);
+    fprintf(file, ",\n    \"compression_codec\": ");
+    write_json_string(file, config->compression_codec);
+    fprintf(file, ",\n    \"compression_level\": %d", config->compression_level);
+    fprintf(file, ",\n    \"producer_ack\": %d", config->producer_ack);
+    fprintf(file, ",\n    \"producer_batch_size\": %d", config->producer_batch_size);
+    fprintf(file, ",\n    \"producer_linger_ms\": %d", config->producer_linger_ms);
+    fprintf(file, ",\n    \"producer_max_in_flight\": %d", config->producer_max_in_flight);
+    fprintf(file, ",\n    \"producer_queue_max_messages\": %d", config->producer_queue_max_messages);
+    fprintf(file, ",\n    \"producer_queue_max_kbytes\": %d", config->producer_queue_max_kbytes);
+    fprintf(file, ",\n    \"producer_queue_full_policy\": \"%s\"",
+            queue_full_policy_names[config->producer_queue_full_policy]);
+    fprintf(file, ",\n    \"producer_threads\": %d", config->producer_threads);
+    fprintf(file, ",\n    \"producer_shared_handle\": %d", config->producer_shared_handle);
+    fprintf(file, ",\n    \"producer_message_size\": %d", config->producer_message_size);
+    fprintf(file, ",\n    \"producer_payload_count\": %d", config->producer_payload_count);
+    fprintf(file, ",\n    \"producer_rate_msgs\": %d", config->producer_rate_msgs);
+    fprintf(file, ",\n    \"producer_rate_mb\": %.3f", config->producer_rate_mb);
+    fprintf(file, ",\n    \"producer_duration_sec\": %d", config->producer_duration_sec);
+    fprintf(file, ",\n    \"payload_size_distribution\": \"%s\"",
+            payload_size_distribution_names[config->payload_size_distribution]);
+    fprintf(file, ",\n    \"payload_size_min\": %d", config->payload_size_min);
+    fprintf(file, ",\n    \"payload_size_max\": %d", config->payload_size_max);
+    fprintf(file, ",\n    \"payload_content\": \"%s\"", payload_content_names[config->payload_content]);
+    fprintf(file, ",\n    \"payload_compressibility\": %d", config->payload_compressibility);
+    fprintf(file, ",\n    \"key_distribution\": \"%s\"", key_distribution_names[config->key_distribution]);
+    fprintf(file, ",\n    \"key_space\": %d", config->key_space);
+    fprintf(file, ",\n    \"consumer_group_id\": ");
+    write_json_string(file, config->consumer_group_id);
+    fprintf(file, ",\n    \"consumer_batch_size\": %d", config->consumer_batch_size);
+    fprintf(file, ",\n    \"consumer_workers\": %d", config->consumer_workers);
+    fprintf(file, ",\n    \"consumer_work_us\": %d", config->consumer_work_us);
+    fprintf(file, ",\n    \"consumer_commit_policy\": \"%s\"", commit_policy_names[config->consumer_commit_policy]);
+    fprintf(file, ",\n    \"message_count\": %d", config->message_count);
+    fprintf(file, ",\n    \"statistics_interval_ms\": %d\n  }", config->statistics_interval_ms);
+}
+
+/*
+ * Write a JSON string literal, escaping quotes, backslashes and control bytes
+ */
+static void write_json_string(FILE *file, const char *value) {
+    fputc('"', file);
+    for (; *value; value++) {
+        if (*value == '"' || *value == '\\') {
+            fprintf(file, "\\%c", *value);
+        } else if ((unsigned char)*value < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char)*value);
+        } else {
+            fputc(*value, file);
+        }
+    }
+    fputc('"', file);
+}
+
+/*
+ * Read the run summaries of a result file
+ * Returns 0 on success
+ */
+static int load_result_file(const char *path, ResultFile *result_file) {
+    FILE *file;
+    char *json;
+    long size;
+    
+    memset(result_file, 0, sizeof(*result_file));
+    file = fopen(path, "rb");
+    if (!file) {
+        log_message(1, "ERROR", "Failed to open result file %s", path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    json = size > 0 ? (char *)malloc((size_t)size + 1) : NULL;
+    if (!json || fread(json, 1, (size_t)size, file) != (size_t)size) {
+        log_message(1, "ERROR", "Failed to read result file %s", path);
+        free(json);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    json[size] = '\0';  /* strtod() stops here at the latest */
+    
+    if (parse_result_document(json, (size_t)size, result_file) != 0) {
+        log_message(1, "ERROR", "%s is not valid JSON (unbalanced brackets)", path);
+        free(json);
+        return -1;
+    }
+    free(json);
+    if (result_file->run_count == 0) {
+        log_message(1, "ERROR", "%s has no runs, is it a kafka_cli result file?", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Single pass over a result document in the style of parse_statistics():
+ * every object opened in the runs array starts a run, its "name" string and
+ * the numbers inside its "summary" object are kept
+ * Returns 0 on success, -1 on a closing bracket without an opening one
+ */
+static int parse_result_document(const char *json, size_t len, ResultFile *result_file) {
+    const char *keys[STATS_MAX_DEPTH + 1];
+    size_t key_lengths[STATS_MAX_DEPTH + 1];
+    const char *key = NULL;
+    const char *start;
+    char *end;
+    size_t key_length = 0;
+    size_t i = 0, j;
+    int depth = 0;
+    int in_run, metric;
+    ResultRunSummary *summary = NULL;
+    double value;
+    
+    while (i < len) {
+        in_run = summary && depth >= 3 && key_equals(keys[1], key_lengths[1], "runs");
+        switch (json[i]) {
+        case '{':
+        case '[':
+            if (depth <= STATS_MAX_DEPTH) {
+                keys[depth] = key;
+                key_lengths[depth] = key_length;
             }
-            log_message(1, "INFO", "CA certificate configured: %s", config->ssl_ca_location);
+            depth++;
+            if (depth == 3 && json[i] == '{' && keys[1] && key_equals(keys[1], key_lengths[1], "runs")) {
+                summary = result_file->run_count < MAX_RESULT_RUNS ?
+                          &result_file->runs[result_file->run_count++] : NULL;
+            }
+            key = NULL;
+            i++;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                return -1;
+            }
+            depth--;
+            key = NULL;
+            i++;
+            break;
+        case '"':
+            start = json + i + 1;
+            for (i++; i < len && json[i] != '"'; i++) {
+                if (json[i] == '\\') {
+                    i++;
+                }
+            }
+            j = ++i;
+            while (j < len && isspace((unsigned char)json[j])) {
+                j++;
+            }
+            if (j < len && json[j] == ':') {
+                key = start;
+                key_length = (size_t)(json + i - 1 - start);
+                i = j + 1;
+            } else {
+                /* A string value: only a run's name is of interest */
+                if (in_run && depth == 3 && key && key_equals(key, key_length, "name")) {
+                    size_t length = (size_t)(json + i - 1 - start);
+                    
+                    if (length >= sizeof(summary->name)) {
+                        length = sizeof(summary->name) - 1;
+                    }
+                    memcpy(summary->name, start, length);
+                    summary->name[length] = '\0';
+                }
+                key = NULL;
+            }
+            break;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            value = strtod(json + i, &end);
+            i = end > json + i ? (size_t)(end - json) : i + 1;
+            if (in_run && depth == 4 && key && key_equals(keys[3], key_lengths[3], "summary")) {
+                for (metric = 0; metric < RESULT_METRIC_COUNT; metric++) {
+                    if (key_equals(key, key_length, result_metrics[metric].key)) {
+                        summary->values[metric] = value;
+                        summary->present[metric] = 1;
+                    }
+                }
+            }
+            key = NULL;
+            break;
+        default:
+            i++;
+            break;
         }
-        
-        /* Client Certificate */
-        if (strlen(config->ssl_certificate_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.certificate.location", config->ssl_certificate_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.certificate.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+    }
+    return 0;
+}
+
+/*
+ * Compare the runs of two result files by name and flag every metric that
+ * got worse by more than threshold_pct (any increase for errors)
+ * Returns 0 without regressions, 1 with regressions, 2 if a file is unusable
+ */
+static int run_compare(const char *baseline_path, const char *current_path, double threshold_pct) {
+    ResultFile *baseline, *current;
+    const ResultRunSummary *before, *after;
+    double change, worse;
+    int regressions = 0, compared = 0;
+    int i, j, metric, regression;
+    
+    baseline = (ResultFile *)malloc(sizeof(ResultFile));
+    current = (ResultFile *)malloc(sizeof(ResultFile));
+    if (!baseline || !current ||
+        load_result_file(baseline_path, baseline) != 0 || load_result_file(current_path, current) != 0) {
+        free(baseline);
+        free(current);
+        return 2;
+    }
+    
+    log_message(1, "INFO", "Baseline: %s", baseline_path);
+    log_message(1, "INFO", "Current:  %s", current_path);
+    log_message(1, "INFO", "Regression threshold: %.1f%%", threshold_pct);
+    log_message(1, "INFO", "%-20s %-18s %14s %14s %9s", "Run", "Metric", "Baseline", "Current", "Change");
+    for (i = 0; i < current->run_count; i++) {
+        after = &current->runs[i];
+        before = NULL;
+        for (j = 0; j < baseline->run_count && !before; j++) {
+            if (strcmp(baseline->runs[j].name, after->name) == 0) {
+                before = &baseline->runs[j];
             }
-            log_message(1, "INFO", "Client certificate configured: %s", config->ssl_certificate_location);
+        }
+        if (!before) {
+            log_message(1, "WARNING", "%-20s not in the baseline, skipped", after->name);
+            continue;
         }
         
-        /* Client Key */
-        if (strlen(config->ssl_key_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.key.location", config->ssl_key_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.key.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+        for (metric = 0; metric < RESULT_METRIC_COUNT; metric++) {
+            if (!before->present[metric] || !after->present[metric]) {
+                continue;
             }
-            log_message(1, "INFO", "Client key configured: %s", config->ssl_key_location);
+            change = before->values[metric] != 0.0 ?
+                     (after->values[metric] - before->values[metric]) / before->values[metric] * 100.0 : 0.0;
+            worse = result_metrics[metric].higher_is_better ? -change : change;
+            if (strcmp(result_metrics[metric].key, "errors") == 0) {
+                regression = after->values[metric] > before->values[metric];
+            } else {
+                regression = before->values[metric] != 0.0 && worse > threshold_pct;
+            }
+            regressions += regression;
+            compared++;
+            log_message(1, regression ? "WARNING" : "INFO", "%-20.20s %-18s %14.3f %14.3f %+8.1f%%%s",
+                        after->name, result_metrics[metric].label, before->values[metric],
+                        after->values[metric], change, regression ? "  REGRESSION" : "");
         }
-        
-        /* Key Password (if provided) */
-        if (strlen(config->ssl_key_password) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.key.password", config->ssl_key_password,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.key.password: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+    }
+    for (j = 0; j < baseline->run_count; j++) {
+        for (i = 0; i < current->run_count; i++) {
+            if (strcmp(baseline->runs[j].name, current->runs[i].name) == 0) {
+                break;
             }
-            log_message(1, "INFO", "Key password configured");
         }
+        if (i == current->run_count) {
+            log_message(1, "WARNING", "%-20s missing from the current result", baseline->runs[j].name);
+        }
+    }
+    
+    free(baseline);
+    free(current);
+    if (compared == 0) {
+        log_message(1, "ERROR", "The two result files have no runs in common");
+        return 2;
+    }
+    if (regressions > 0) {
+        log_message(1, "WARNING", "%d regression%s beyond %.1f%%", regressions,
+                    regressions == 1 ? "" : "s", threshold_pct);
+        return 1;
+    }
+    log_message(1, "INFO", "No regressions beyond %.1f%%", threshold_pct);
+    return 0;
+}
+
+/*
+ * Parse "YYYY-MM-DD HH:MM[:SS]" (local time, 'T' separator also accepted)
+ * or a Unix timestamp in milliseconds
+ * Returns 0 on success
+ */
+static int parse_timestamp_ms(const char *value, int64_t *timestamp_ms) {
+    struct tm tm_value;
+    const char *p;
+    time_t seconds;
+    int fields;
+    
+    for (p = value; *p && isdigit((unsigned char)*p); p++) {
+    }
+    if (*p == '\0' && p != value) {
+        *timestamp_ms = strtoll(value, NULL, 10);
+        return 0;
+    }
+    
+    memset(&tm_value, 0, sizeof(tm_value));
+    fields = sscanf(value, "%d-%d-%d%*[ T]%d:%d:%d", &tm_value.tm_year, &tm_value.tm_mon,
+                    &tm_value.tm_mday, &tm_value.tm_hour, &tm_value.tm_min, &tm_value.tm_sec);
+    if (fields < 5) {
+        return -1;
+    }
+    tm_value.tm_year -= 1900;
+    tm_value.tm_mon -= 1;
+    tm_value.tm_isdst = -1;
+    seconds = mktime(&tm_value);
+    if (seconds == (time_t)-1) {
+        return -1;
+    }
+    *timestamp_ms = (int64_t)seconds * 1000;
+    return 0;
+}
+
+/*
+ * Number of partitions of a topic from the broker metadata
+ * Returns -1 (after logging) if the topic is unknown or has no partitions
+ */
+static int get_partition_count(rd_kafka_t *rk, const char *topic) {
+    const struct rd_kafka_metadata *metadata = NULL;
+    rd_kafka_topic_t *rkt;
+    rd_kafka_resp_err_t err;
+    int count;
+    
+    rkt = rd_kafka_topic_new(rk, topic, NULL);
+    err = rd_kafka_metadata(rk, 0, rkt, &metadata, 10000);
+    rd_kafka_topic_destroy(rkt);
+    if (err || metadata->topic_cnt != 1 || metadata->topics[0].err) {
+        log_message(1, "ERROR", "Failed to get metadata for topic '%s': %s", topic,
+                    rd_kafka_err2str(err ? err : metadata->topics[0].err));
+        if (metadata) {
+            rd_kafka_metadata_destroy(metadata);
+        }
+        return -1;
+    }
+    
+    count = metadata->topics[0].partition_cnt;
+    rd_kafka_metadata_destroy(metadata);
+    if (count <= 0) {
+        log_message(1, "ERROR", "Topic '%s' has no partitions", topic);
+        return -1;
+    }
+    return count;
+}
+
+/*
+ * Look up the topic's partitions and turn the time range into an offset
+ * range per partition. The end offset is the first message at or after
+ * end_ms, or the high watermark when end_ms is 0 or beyond the last message.
+ * Returns 0 on success; *partitions is allocated and indexed by partition id
+ */
+static int resolve_export_ranges(rd_kafka_t *rk, const Config *config, int64_t start_ms,
+                                 int64_t end_ms, ExportPartition **partitions, int *partition_count) {
+    rd_kafka_topic_partition_list_t *starts, *ends = NULL;
+    rd_kafka_resp_err_t err;
+    ExportPartition *ranges;
+    int64_t low, high;
+    int count, i;
+    
+    /* Partition ids are 0..N-1 */
+    count = get_partition_count(rk, config->topic);
+    if (count < 0) {
+        return -1;
+    }
+    
+    ranges = (ExportPartition *)calloc((size_t)count, sizeof(ExportPartition));
+    starts = rd_kafka_topic_partition_list_new(count);
+    if (end_ms > 0) {
+        ends = rd_kafka_topic_partition_list_new(count);
+    }
+    if (!ranges || !starts || (end_ms > 0 && !ends)) {
+        log_message(1, "ERROR", "Failed to allocate export ranges");
+        free(ranges);
+        if (starts) rd_kafka_topic_partition_list_destroy(starts);
+        if (ends) rd_kafka_topic_partition_list_destroy(ends);
+        return -1;
+    }
+    
+    /* offsets_for_times takes the timestamp in .offset and returns the offset there */
+    for (i = 0; i < count; i++) {
+        rd_kafka_topic_partition_list_add(starts, config->topic, i);
+        starts->elems[i].offset = start_ms;
+        if (ends) {
+            rd_kafka_topic_partition_list_add(ends, config->topic, i);
+            ends->elems[i].offset = end_ms;
+        }
+    }
+    err = rd_kafka_offsets_for_times(rk, starts, 10000);
+    if (!err && ends) {
+        err = rd_kafka_offsets_for_times(rk, ends, 10000);
+    }
+    if (err) {
+        log_message(1, "ERROR", "Failed to look up offsets by time: %s", rd_kafka_err2str(err));
+        free(ranges);
+        rd_kafka_topic_partition_list_destroy(starts);
+        if (ends) rd_kafka_topic_partition_list_destroy(ends);
+        return -1;
+    }
+    
+    for (i = 0; i < count; i++) {
+        ExportPartition *range = &ranges[i];
         
-        /* Skip certificate verification (for testing only) */
-        if (config->ssl_skip_certificate_verify) {
-            if (rd_kafka_conf_set(conf, "enable.ssl.certificate.verification", "false",
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to disable SSL certificate verification: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
-            }
-            log_message(1, "WARNING", "SSL certificate verification is DISABLED - use only for testing!");
+        range->partition = i;
+        err = rd_kafka_query_watermark_offsets(rk, config->topic, i, &low, &high, 10000);
+        if (err) {
+            log_message(1, "WARNING", "Partition %d: failed to query watermarks (%s), skipping",
+                        i, rd_kafka_err2str(err));
+            range->done = 1;
+            continue;
+        }
+        if (starts->elems[i].err || (ends && ends->elems[i].err)) {
+            log_message(1, "WARNING", "Partition %d: offset lookup failed (%s), skipping", i,
+                        rd_kafka_err2str(starts->elems[i].err ? starts->elems[i].err : ends->elems[i].err));
+            range->done = 1;
+            continue;
         }
+        
+        /* A negative result means no message at or after that time */
+        range->start_offset = starts->elems[i].offset >= 0 ? starts->elems[i].offset : high;
+        range->end_offset = (ends && ends->elems[i].offset >= 0) ? ends->elems[i].offset : high;
+        if (range->start_offset >= range->end_offset) {
+            range->done = 1;
+        }
+        log_message(config->verbose, "DEBUG", "Partition %d: offsets %lld..%lld (watermarks %lld..%lld)",
+                    i, (long long)range->start_offset, (long long)range->end_offset,
+                    (long long)low, (long long)high);
     }
     
-    /* Producer-specific settings */
-    char batch_size_str[32], linger_str[32], acks_str[32];
-    snprintf(batch_size_str, sizeof(batch_size_str), "%d", config->producer_batch_size);
-    snprintf(linger_str, sizeof(linger_str), "%d", config->producer_linger_ms);
-    snprintf(acks_str, sizeof(acks_str), "%d", config->producer_ack);
+    rd_kafka_topic_partition_list_destroy(starts);
+    if (ends) {
+        rd_kafka_topic_partition_list_destroy(ends);
+    }
+    *partitions = ranges;
+    *partition_count = count;
+    return 0;
+}
+
+/*
+ * Write bytes with tab, newline, backslash and non-printable bytes escaped,
+ * so every record stays on one tab-separated line
+ */
+static void write_escaped(FILE *file, const char *data, size_t len) {
+    size_t start = 0, i;
+    unsigned char c;
     
-    rd_kafka_conf_set(conf, "batch.size", batch_size_str, NULL, 0);
-    rd_kafka_conf_set(conf, "linger.ms", linger_str, NULL, 0);
-    rd_kafka_conf_set(conf, "acks", acks_str, NULL, 0);
+    for (i = 0; i < len; i++) {
+        c = (unsigned char)data[i];
+        if (c >= 0x20 && c < 0x7f && c != '\\') {
+            continue;
+        }
+        fwrite(data + start, 1, i - start, file);
+        start = i + 1;
+        if (c == '\t') {
+            fputs("\\t", file);
+        } else if (c == '\n') {
+            fputs("\\n", file);
+        } else if (c == '\r') {
+            fputs("\\r", file);
+        } else if (c == '\\') {
+            fputs("\\\\", file);
+        } else {
+            fprintf(file, "\\x%02x", c);
+        }
+    }
+    fwrite(data + start, 1, len - start, file);
+}
+
+/*
+ * Append one message as "offset<TAB>timestamp_ms<TAB>key<TAB>value"
+ */
+static void write_export_record(ExportPartition *export_partition, const rd_kafka_message_t *rkmessage) {
+    FILE *file = export_partition->file;
     
-    /* Set delivery report callback */
-    rd_kafka_conf_set_dr_msg_cb(conf, dr_msg_cb);
+    fprintf(file, "%lld\t%lld\t", (long long)rkmessage->offset,
+            (long long)rd_kafka_message_timestamp(rkmessage, NULL));
+    write_escaped(file, (const char *)rkmessage->key, rkmessage->key ? rkmessage->key_len : 0);
+    fputc('\t', file);
+    write_escaped(file, (const char *)rkmessage->payload, rkmessage->payload ? rkmessage->len : 0);
+    fputc('\n', file);
+    
+    ATOMIC_ADD(&export_partition->messages, 1);
+    ATOMIC_ADD(&export_partition->bytes, (long long)rkmessage->len);
+}
+
+/*
+ * Finish partitions whose position reached the end offset without a
+ * message at end - 1 (compacted away or a transaction marker)
+ * Returns the number of partitions finished
+ */
+static int update_export_positions(rd_kafka_t *rk, ExportWorker *worker) {
+    rd_kafka_topic_partition_list_t *list;
+    ExportPartition *range;
+    int finished = 0;
+    int i;
     
-    /* Pass config to callback for verbose logging */
-    rd_kafka_conf_set_opaque(conf, (void *)config);
+    list = rd_kafka_topic_partition_list_new(worker->partition_count);
+    for (i = worker->index; i < worker->partition_count; i += worker->thread_count) {
+        if (!worker->partitions[i].done) {
+            rd_kafka_topic_partition_list_add(list, worker->config->topic, i);
+        }
+    }
+    if (list->cnt > 0 && rd_kafka_position(rk, list) == RD_KAFKA_RESP_ERR_NO_ERROR) {
+        for (i = 0; i < list->cnt; i++) {
+            range = &worker->partitions[list->elems[i].partition];
+            if (list->elems[i].offset >= range->end_offset) {
+                range->done = 1;
+                finished++;
+            }
+        }
+    }
+    rd_kafka_topic_partition_list_destroy(list);
+    return finished;
+}
+
+/*
+ * Export thread: assign this thread's partitions at their start offsets
+ * and write messages until every partition reached its end offset
+ */
+static thread_ret_t THREAD_CALL export_worker_main(void *arg) {
+    ExportWorker *worker = (ExportWorker *)arg;
+    const Config *config = worker->config;
+    rd_kafka_topic_partition_list_t *assignment;
+    rd_kafka_message_t *rkmessage;
+    ExportPartition *range;
+    rd_kafka_resp_err_t err;
+    rd_kafka_t *rk;
+    int remaining = 0;
+    int i, partition;
     
-    /* Create producer */
-    rk = rd_kafka_new(RD_KAFKA_PRODUCER, conf, errstr, sizeof(errstr));
+    rk = create_consumer(config);
     if (!rk) {
-        log_message(1, "ERROR", "Failed to create producer: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+        worker->failed = 1;
+        ATOMIC_STORE_RELEASE(&worker->finished, 1);
+        return 0;
     }
     
-    log_message(1, "INFO", "Producer created successfully");
-    return rk;
+    assignment = rd_kafka_topic_partition_list_new(worker->partition_count);
+    for (i = worker->index; i < worker->partition_count; i += worker->thread_count) {
+        if (!worker->partitions[i].done) {
+            rd_kafka_topic_partition_list_add(assignment, config->topic, i);
+            assignment->elems[assignment->cnt - 1].offset = worker->partitions[i].start_offset;
+            remaining++;
+        }
+    }
+    
+    /* Explicit assignment: no group membership, no rebalancing */
+    err = remaining > 0 ? rd_kafka_assign(rk, assignment) : RD_KAFKA_RESP_ERR_NO_ERROR;
+    rd_kafka_topic_partition_list_destroy(assignment);
+    if (err) {
+        log_message(1, "ERROR", "Export thread %d: failed to assign partitions: %s",
+                    worker->index, rd_kafka_err2str(err));
+        worker->failed = 1;
+        remaining = 0;
+    }
+    
+    while (run && remaining > 0) {
+        rkmessage = rd_kafka_consumer_poll(rk, 500);
+        if (!rkmessage) {
+            remaining -= update_export_positions(rk, worker);
+            continue;
+        }
+        
+        partition = (int)rkmessage->partition;
+        if (rkmessage->err) {
+            if (rkmessage->err != RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+                log_message(1, "ERROR", "Export thread %d: %s", worker->index,
+                            rd_kafka_message_errstr(rkmessage));
+            }
+        } else if (partition >= 0 && partition < worker->partition_count &&
+                   partition % worker->thread_count == worker->index &&
+                   !worker->partitions[partition].done) {
+            range = &worker->partitions[partition];
+            if (rkmessage->offset < range->end_offset) {
+                write_export_record(range, rkmessage);
+            }
+            if (rkmessage->offset >= range->end_offset - 1) {
+                /* Range complete: stop fetching this partition */
+                range->done = 1;
+                remaining--;
+                set_partition_paused(rk, config->topic, partition, 1);
+                log_message(config->verbose, "DEBUG", "Partition %d exported: %lld messages",
+                            partition, range->messages);
+            }
+        }
+        rd_kafka_message_destroy(rkmessage);
+    }
+    
+    rd_kafka_consumer_close(rk);
+    destroy_consumer(rk);
+    ATOMIC_STORE_RELEASE(&worker->finished, 1);
+    return 0;
 }
 
 /*
- * Create Kafka consumer with mTLS configuration
+ * Export every message between export_start_time and export_end_time,
+ * reading partitions in parallel and writing one file per partition
+ * Returns 0 on success
  */
-static rd_kafka_t* create_consumer(const Config *config) {
+static int run_export(const Config *config) {
+    Config export_config;
+    ExportPartition *partitions = NULL;
+    ExportWorker *workers;
+    RunResult *run_result = NULL;
     rd_kafka_t *rk;
-    rd_kafka_conf_t *conf;
-    char errstr[512];
-    char timeout_str[32];
+    char sanitized_topic[256];
+    char filepath[MAX_VALUE_LENGTH + 256 + 16]; /* Directory, topic, "-<partition>.tsv" */
+    int64_t start_ms, end_ms = 0, start_ns, now_ns, last_report_ns;
+    long long expected = 0, messages, last_messages = 0, bytes;
+    int partition_count = 0, thread_count, started = 0, active;
+    int failed = 0;
+    int i;
     
-    conf = rd_kafka_conf_new();
+    if (parse_timestamp_ms(config->export_start_time, &start_ms) != 0) {
+        log_message(1, "ERROR", "export_start_time '%s' is not 'YYYY-MM-DD HH:MM:SS' or epoch ms",
+                    config->export_start_time);
+        return 1;
+    }
+    if (strlen(config->export_end_time) > 0 &&
+        parse_timestamp_ms(config->export_end_time, &end_ms) != 0) {
+        log_message(1, "ERROR", "export_end_time '%s' is not 'YYYY-MM-DD HH:MM:SS' or epoch ms",
+                    config->export_end_time);
+        return 1;
+    }
+    if (end_ms > 0 && end_ms <= start_ms) {
+        log_message(1, "ERROR", "export_end_time must be after export_start_time");
+        return 1;
+    }
     
-    /* Enable librdkafka debug logging if verbose mode */
-    if (config->verbose) {
-        if (rd_kafka_conf_set(conf, "debug", "all",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "WARNING", "Failed to set debug: %s", errstr);
+    /* Plain reader: explicit offsets, nothing committed */
+    export_config = *config;
+    strcpy(export_config.consumer_enable_auto_commit, "false");
+    export_config.consumer_commit_policy = COMMIT_NONE;
+    
+    rk = create_consumer(&export_config);
+    if (!rk) {
+        return 1;
+    }
+    if (resolve_export_ranges(rk, &export_config, start_ms, end_ms, &partitions, &partition_count) != 0) {
+        destroy_consumer(rk);
+        return 1;
+    }
+    destroy_consumer(rk);
+    
+    /* One file per partition with messages in range */
+#ifdef _WIN32
+    CreateDirectory(config->export_output_dir, NULL);
+#else
+    mkdir(config->export_output_dir, 0755);
+#endif
+    sanitize_filename(sanitized_topic, config->topic, sizeof(sanitized_topic));
+    for (i = 0; i < partition_count; i++) {
+        if (partitions[i].done) {
+            continue;
         }
-        if (rd_kafka_conf_set(conf, "log_level", "7",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "WARNING", "Failed to set log_level: %s", errstr);
+        expected += partitions[i].end_offset - partitions[i].start_offset;
+#ifdef _WIN32
+        snprintf(filepath, sizeof(filepath), "%s\\%s-%d.tsv", config->export_output_dir, sanitized_topic, i);
+#else
+        snprintf(filepath, sizeof(filepath), "%s/%s-%d.tsv", config->export_output_dir, sanitized_topic, i);
+#endif
+        partitions[i].file = fopen(filepath, "wb");
+        if (!partitions[i].file) {
+            log_message(1, "ERROR", "Failed to create %s", filepath);
+            failed = 1;
+            break;
         }
     }
     
-    /* Set bootstrap servers */
-    if (rd_kafka_conf_set(conf, "bootstrap.servers", config->brokers,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set bootstrap.servers: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    thread_count = config->export_threads > 0 ? config->export_threads : 1;
+    if (thread_count > partition_count) {
+        thread_count = partition_count;
+    }
+    workers = (ExportWorker *)calloc((size_t)thread_count, sizeof(ExportWorker));
+    if (!workers) {
+        failed = 1;
+    }
+    if (config->result_dir[0] != '\0') {
+        run_result = (RunResult *)calloc(1, sizeof(RunResult));
+        if (run_result) {
+            strcpy(run_result->name, "export");
+        }
     }
     
-    /* Configure mTLS authentication */
-    if (strcmp(config->security_protocol, "SSL") == 0) {
-        log_message(1, "INFO", "Configuring mTLS authentication...");
-        
-        if (rd_kafka_conf_set(conf, "security.protocol", "SSL",
-                              errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-            log_message(1, "ERROR", "Failed to set security.protocol: %s", errstr);
-            rd_kafka_conf_destroy(conf);
-            return NULL;
+    if (!failed) {
+        log_message(1, "INFO", "Exporting up to %lld messages from %d partitions of '%s' "
+                    "with %d threads to %s/", expected, partition_count, config->topic,
+                    thread_count, config->export_output_dir);
+        start_ns = get_time_ns();
+        if (run_result) {
+            start_run_result(run_result, "consumer", start_ns);
         }
-        
-        /* CA Certificate */
-        if (strlen(config->ssl_ca_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.ca.location", config->ssl_ca_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.ca.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+        for (i = 0; i < thread_count; i++) {
+            workers[i].config = &export_config;
+            workers[i].index = i;
+            workers[i].thread_count = thread_count;
+            workers[i].partitions = partitions;
+            workers[i].partition_count = partition_count;
+            if (thread_create(&workers[i].thread, export_worker_main, &workers[i]) != 0) {
+                log_message(1, "ERROR", "Failed to start export thread %d", i);
+                failed = 1;
+                run = 0;
+                break;
             }
-            log_message(1, "INFO", "CA certificate configured: %s", config->ssl_ca_location);
+            started++;
         }
         
-        /* Client Certificate */
-        if (strlen(config->ssl_certificate_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.certificate.location", config->ssl_certificate_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.certificate.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+        /* Progress from the per-partition counters */
+        last_report_ns = start_ns;
+        do {
+            sleep_ms(100);
+            active = 0;
+            for (i = 0; i < started; i++) {
+                if (!ATOMIC_LOAD_ACQUIRE(&workers[i].finished)) {
+                    active++;
+                }
             }
-            log_message(1, "INFO", "Client certificate configured: %s", config->ssl_certificate_location);
-        }
-        
-        /* Client Key */
-        if (strlen(config->ssl_key_location) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.key.location", config->ssl_key_location,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.key.location: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+            now_ns = get_time_ns();
+            messages = 0;
+            bytes = 0;
+            for (i = 0; i < partition_count; i++) {
+                messages += ATOMIC_LOAD(&partitions[i].messages);
+                bytes += ATOMIC_LOAD(&partitions[i].bytes);
             }
-            log_message(1, "INFO", "Client key configured: %s", config->ssl_key_location);
-        }
-        
-        /* Key Password (if provided) */
-        if (strlen(config->ssl_key_password) > 0) {
-            if (rd_kafka_conf_set(conf, "ssl.key.password", config->ssl_key_password,
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to set ssl.key.password: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+            if (run_result) {
+                sample_run_result(run_result, now_ns, messages, bytes, 0, &no_latency);
             }
-            log_message(1, "INFO", "Key password configured");
+            if (active > 0 && config->report_interval_sec > 0 &&
+                now_ns - last_report_ns >= (int64_t)config->report_interval_sec * 1000000000LL) {
+                log_message(1, "INFO", "[%.1f s] %lld of ~%lld messages exported, %.1f msg/s",
+                            (double)(now_ns - start_ns) / 1e9, messages, expected,
+                            (double)(messages - last_messages) * 1e9 / (double)(now_ns - last_report_ns));
+                last_messages = messages;
+                last_report_ns = now_ns;
+            }
+        } while (active > 0);
+        
+        for (i = 0; i < started; i++) {
+            thread_join(workers[i].thread);
+            failed |= workers[i].failed;
         }
         
-        /* Skip certificate verification (for testing only) */
-        if (config->ssl_skip_certificate_verify) {
-            if (rd_kafka_conf_set(conf, "enable.ssl.certificate.verification", "false",
-                                  errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-                log_message(1, "ERROR", "Failed to disable SSL certificate verification: %s", errstr);
-                rd_kafka_conf_destroy(conf);
-                return NULL;
+        messages = 0;
+        bytes = 0;
+        log_message(1, "INFO", "=== Export Summary ===");
+        for (i = 0; i < partition_count; i++) {
+            if (!partitions[i].file) {
+                continue;
             }
-            log_message(1, "WARNING", "SSL certificate verification is DISABLED - use only for testing!");
+            messages += partitions[i].messages;
+            bytes += partitions[i].bytes;
+            log_message(1, "INFO", "  Partition %d: offsets %lld..%lld, %lld messages, %.3f MB%s",
+                        i, (long long)partitions[i].start_offset, (long long)partitions[i].end_offset - 1,
+                        partitions[i].messages, (double)partitions[i].bytes / (1024.0 * 1024.0),
+                        partitions[i].done ? "" : " (incomplete)");
+        }
+        now_ns = get_time_ns();
+        log_message(1, "INFO", "Exported %lld messages, %.3f MB in %.3f s (%.1f msg/s, %.3f MB/s)",
+                    messages, (double)bytes / (1024.0 * 1024.0), (double)(now_ns - start_ns) / 1e9,
+                    (double)messages * 1e9 / (double)(now_ns - start_ns),
+                    (double)bytes / (1024.0 * 1024.0) * 1e9 / (double)(now_ns - start_ns));
+        log_message(1, "INFO", "======================");
+        if (run_result) {
+            finish_run_result(run_result, now_ns - start_ns, messages, bytes, 0, &no_latency);
+            write_result_files(config, "export", run_result, 1);
         }
     }
     
-    /* Consumer-specific settings */
-    if (rd_kafka_conf_set(conf, "group.id", config->consumer_group_id,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set group.id: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    for (i = 0; i < partition_count; i++) {
+        if (partitions[i].file) {
+            fclose(partitions[i].file);
+        }
     }
-    
-    if (rd_kafka_conf_set(conf, "auto.offset.reset", config->consumer_auto_offset_reset,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set auto.offset.reset: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    if (run_result) {
+        free_run_result(run_result);
+        free(run_result);
     }
+    free(workers);
+    free(partitions);
+    return failed ? 1 : 0;
+}
+
+/*
+ * Group-scale member: its own handle from create_consumer(), subscribed in
+ * the shared group, counting (and optionally burning CPU on) every message
+ * until stopped
+ */
+static thread_ret_t THREAD_CALL group_member_main(void *arg) {
+    GroupMember *member = (GroupMember *)arg;
+    const Config *config = member->config;
+    rd_kafka_topic_partition_list_t *topics;
+    rd_kafka_message_t *rkmessage;
+    ClientContext *context;
+    rd_kafka_t *rk;
+    long long events, last_events = 0;
+    int64_t now_ns;
     
-    snprintf(timeout_str, sizeof(timeout_str), "%d", config->consumer_session_timeout_ms);
-    if (rd_kafka_conf_set(conf, "session.timeout.ms", timeout_str,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set session.timeout.ms: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    rk = create_consumer(config);
+    if (!rk) {
+        member->failed = 1;
+        ATOMIC_STORE(&member->left_ns, get_time_ns());
+        ATOMIC_STORE_RELEASE(&member->finished, 1);
+        return 0;
     }
+    context = (ClientContext *)rd_kafka_opaque(rk);
+    snprintf(context->name, sizeof(context->name), "member %d", member->id);
     
-    /* Enable/disable auto commit */
-    if (rd_kafka_conf_set(conf, "enable.auto.commit", config->consumer_enable_auto_commit,
-                          errstr, sizeof(errstr)) != RD_KAFKA_CONF_OK) {
-        log_message(1, "ERROR", "Failed to set enable.auto.commit: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
-    }
-    log_message(1, "INFO", "Auto commit enabled: %s", config->consumer_enable_auto_commit);
+    topics = rd_kafka_topic_partition_list_new(1);
+    rd_kafka_topic_partition_list_add(topics, config->topic, RD_KAFKA_PARTITION_UA);
+    rd_kafka_subscribe(rk, topics);
+    rd_kafka_topic_partition_list_destroy(topics);
     
-    /* Create consumer */
-    rk = rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr, sizeof(errstr));
-    if (!rk) {
-        log_message(1, "ERROR", "Failed to create consumer: %s", errstr);
-        rd_kafka_conf_destroy(conf);
-        return NULL;
+    while (run && !ATOMIC_LOAD_ACQUIRE(&member->stop)) {
+        rkmessage = rd_kafka_consumer_poll(rk, 100);
+        now_ns = get_time_ns();
+        if (rkmessage) {
+            if (!rkmessage->err) {
+                if (config->consumer_work_us > 0) {
+                    burn_cpu_us(config->consumer_work_us);
+                }
+                ATOMIC_ADD(&member->messages, 1);
+                ATOMIC_ADD(&member->bytes, (long long)rkmessage->len);
+                ATOMIC_STORE(&member->last_message_ns, now_ns);
+            }
+            rd_kafka_message_destroy(rkmessage);
+        }
+        
+        /* The rebalance callback runs inside poll on this thread */
+        events = context->rebalance->assign_events + context->rebalance->revoke_events;
+        if (events != last_events) {
+            last_events = events;
+            ATOMIC_STORE(&member->last_rebalance_ns, now_ns);
+        }
+        ATOMIC_STORE(&member->assigned, context->rebalance->assigned);
     }
     
-    log_message(1, "INFO", "Consumer created successfully (Group ID: %s)", config->consumer_group_id);
-    return rk;
+    rd_kafka_consumer_close(rk);
+    destroy_consumer(rk);
+    ATOMIC_STORE(&member->assigned, 0);
+    ATOMIC_STORE(&member->left_ns, get_time_ns());
+    ATOMIC_STORE_RELEASE(&member->finished, 1);
+    return 0;
 }
 
 /*
- * Produce messages to Kafka
+ * Start the next group member
+ * Returns 0 on success
  */
-static int produce_messages(rd_kafka_t *rk, const Config *config) {
-    rd_kafka_resp_err_t err;
-    char message[1024];
-    int i;
-    
-    log_message(1, "INFO", "Starting to produce %d messages to topic '%s'...",
-                config->message_count, config->topic);
+static int start_group_member(GroupMember *members, int *member_count, const Config *config) {
+    GroupMember *member;
     
-    for (i = 0; i < config->message_count; i++) {
-        snprintf(message, sizeof(message), 
-                 "Test message %d from Kafka CLI at %ld", i + 1, (long)time(NULL));
-        
-        /* Produce message */
-        err = rd_kafka_producev(
-            rk,
-            RD_KAFKA_V_TOPIC(config->topic),
-            RD_KAFKA_V_VALUE(message, strlen(message)),
-            RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
-            RD_KAFKA_V_KEY(NULL, 0),
-            RD_KAFKA_V_END
-        );
-        
-        if (err) {
-            log_message(1, "ERROR", "Failed to produce message %d: %s",
-                        i + 1, rd_kafka_err2str(err));
-        } else {
-            log_message(config->verbose, "INFO", "Produced message %d/%d: %s",
-                        i + 1, config->message_count, message);
-        }
-        
-        /* Poll for delivery reports */
-        rd_kafka_poll(rk, 0);
-        
-        /* Small delay between messages */
-#ifdef _WIN32
-        Sleep(10);
-#else
-        usleep(10000);
-#endif
+    if (*member_count >= MAX_GROUP_MEMBERS) {
+        log_message(1, "WARNING", "Not adding a member: at most %d members per run", MAX_GROUP_MEMBERS);
+        return -1;
     }
-    
-    /* Wait for all messages to be delivered */
-    log_message(1, "INFO", "Flushing messages...");
-    rd_kafka_flush(rk, 10000);
-    
-    log_message(1, "INFO", "Produced %d messages successfully", config->message_count);
+    member = &members[*member_count];
+    member->config = config;
+    member->id = *member_count + 1;
+    member->joined_ns = get_time_ns();
+    if (thread_create(&member->thread, group_member_main, member) != 0) {
+        log_message(1, "ERROR", "Failed to start group member %d", member->id);
+        return -1;
+    }
+    (*member_count)++;
     return 0;
 }
 
 /*
- * Signal handler to stop consumer
+ * The group is steady when every member has been through a rebalance since
+ * the membership change at since_ns, all partitions are owned, and every
+ * member that owns partitions has received a message since its last rebalance
  */
-static void stop_consumer(int sig) {
-    log_message(1, "INFO", "Received signal %d, shutting down...", sig);
-    run = 0;
-    if (global_kafka_handle) {
-        rd_kafka_consumer_close(global_kafka_handle);
+static int group_is_steady(GroupMember *members, int member_count, int partition_count, int64_t since_ns) {
+    int owned = 0;
+    int i, assigned;
+    
+    for (i = 0; i < member_count; i++) {
+        if (ATOMIC_LOAD(&members[i].stop)) {
+            continue;
+        }
+        if (ATOMIC_LOAD(&members[i].last_rebalance_ns) < since_ns) {
+            return 0;
+        }
+        assigned = ATOMIC_LOAD(&members[i].assigned);
+        owned += assigned;
+        if (assigned > 0 &&
+            ATOMIC_LOAD(&members[i].last_message_ns) <= ATOMIC_LOAD(&members[i].last_rebalance_ns)) {
+            return 0;
+        }
     }
+    return owned == partition_count;
 }
 
 /*
- * Consume messages from Kafka
+ * Run group_members consumers in one group, each on its own thread, and
+ * change the membership as group_scale_schedule says. Reports per-member
+ * and aggregate throughput, the partition balance, and for every
+ * membership phase the time until the group was steady again.
  */
-static int consume_messages(rd_kafka_t *rk, const Config *config) {
-    rd_kafka_topic_partition_list_t *topics;
-    rd_kafka_resp_err_t err;
-    rd_kafka_message_t *rkmessage;
-    int msg_count = 0;
+static int run_group_scale(const Config *config) {
+    Config member_config;
+    GroupMember *members;
+    RunResult *run_result = NULL;
+    GroupPhase phases[MAX_GROUP_PHASES];
+    int change_sec[MAX_GROUP_PHASES];
+    int change_delta[MAX_GROUP_PHASES];
+    char entries[MAX_VALUE_LENGTH];
+    char *entry, *delta, *end;
+    rd_kafka_t *rk;
+    int64_t start_ns, now_ns, last_report_ns, duration_ns;
+    long long total, last_total = 0, messages, bytes;
+    long long last_messages[MAX_GROUP_MEMBERS];
+    int change_count = 0, next_change = 0, phase_count = 0;
+    int partition_count, member_count = 0, alive, assigned, min_assigned, max_assigned;
+    int failed = 0;
+    int i, j;
     
-    global_kafka_handle = rk;
+    /* "sec:+N" adds N members, "sec:-N" removes the N newest */
+    strncpy(entries, config->group_scale_schedule, sizeof(entries) - 1);
+    entries[sizeof(entries) - 1] = '\0';
+    for (entry = strtok(entries, ", "); entry; entry = strtok(NULL, ", ")) {
+        delta = strchr(entry, ':');
+        if (delta) {
+            *delta++ = '\0';
+        }
+        if (change_count == MAX_GROUP_PHASES - 1 || !delta) {
+            log_message(1, "ERROR", "group_scale_schedule: invalid or too many entries at '%s'", entry);
+            return 1;
+        }
+        change_sec[change_count] = (int)strtol(entry, &end, 10);
+        if (end == entry || *end != '\0' || change_sec[change_count] < 0 ||
+            (change_count > 0 && change_sec[change_count] < change_sec[change_count - 1])) {
+            log_message(1, "ERROR", "group_scale_schedule: invalid time '%s' (seconds, ascending)", entry);
+            return 1;
+        }
+        change_delta[change_count] = (int)strtol(delta, &end, 10);
+        if (end == delta || *end != '\0' || change_delta[change_count] == 0) {
+            log_message(1, "ERROR", "group_scale_schedule: invalid member change '%s' (+N or -N)", delta);
+            return 1;
+        }
+        change_count++;
+    }
+    if (config->group_members <= 0 || config->group_members > MAX_GROUP_MEMBERS) {
+        log_message(1, "ERROR", "group_members must be between 1 and %d", MAX_GROUP_MEMBERS);
+        return 1;
+    }
     
-    /* Subscribe to topic */
-    topics = rd_kafka_topic_partition_list_new(1);
-    rd_kafka_topic_partition_list_add(topics, config->topic, RD_KAFKA_PARTITION_UA);
+    /* Members count and commit through auto commit only */
+    member_config = *config;
+    member_config.consumer_commit_policy = COMMIT_NONE;
+    member_config.consumer_rebalance_churn_sec = 0;
     
-    err = rd_kafka_subscribe(rk, topics);
-    if (err) {
-        log_message(1, "ERROR", "Failed to subscribe to topic: %s", rd_kafka_err2str(err));
-        rd_kafka_topic_partition_list_destroy(topics);
+    rk = create_consumer(&member_config);
+    if (!rk) {
+        return 1;
+    }
+    partition_count = get_partition_count(rk, config->topic);
+    destroy_consumer(rk);
+    if (partition_count < 0) {
         return 1;
     }
     
-    rd_kafka_topic_partition_list_destroy(topics);
+    members = (GroupMember *)calloc(MAX_GROUP_MEMBERS, sizeof(GroupMember));
+    if (!members) {
+        log_message(1, "ERROR", "Failed to allocate group members");
+        return 1;
+    }
+    memset(last_messages, 0, sizeof(last_messages));
+    if (config->result_dir[0] != '\0') {
+        run_result = (RunResult *)calloc(1, sizeof(RunResult));
+        if (run_result) {
+            strcpy(run_result->name, "group-scale");
+        }
+    }
     
-    log_message(1, "INFO", "Subscribed to topic '%s'", config->topic);
-    log_message(1, "INFO", "Waiting for messages... (Press Ctrl+C to stop)");
+    log_message(1, "INFO", "Starting %d consumers in group '%s' on %d partitions of '%s'",
+                config->group_members, config->consumer_group_id, partition_count, config->topic);
+    start_ns = get_time_ns();
+    last_report_ns = start_ns;
+    duration_ns = (int64_t)config->group_duration_sec * 1000000000LL;
+    if (run_result) {
+        start_run_result(run_result, "consumer", start_ns);
+    }
+    for (i = 0; i < config->group_members; i++) {
+        if (start_group_member(members, &member_count, &member_config) != 0) {
+            failed = 1;
+            run = 0;
+            break;
+        }
+    }
+    phases[0].members = member_count;
+    phases[0].start_ns = start_ns;
+    phases[0].steady_ns = 0;
+    phase_count = 1;
     
-    /* Consume messages */
-    while (run && (config->message_count == 0 || msg_count < config->message_count)) {
-        rkmessage = rd_kafka_consumer_poll(rk, 1000);
+    while (run && (duration_ns == 0 || get_time_ns() - start_ns < duration_ns)) {
+        sleep_ms(100);
+        now_ns = get_time_ns();
+        total = 0;
+        bytes = 0;
+        alive = 0;
+        for (i = 0; i < member_count; i++) {
+            total += ATOMIC_LOAD(&members[i].messages);
+            bytes += ATOMIC_LOAD(&members[i].bytes);
+            if (!ATOMIC_LOAD(&members[i].stop)) {
+                alive++;
+            }
+        }
+        if (run_result) {
+            sample_run_result(run_result, now_ns, total, bytes, 0, &no_latency);
+        }
         
-        if (!rkmessage) {
-            /* Timeout - no message */
-            continue;
+        if (phases[phase_count - 1].steady_ns == 0 &&
+            group_is_steady(members, member_count, partition_count, phases[phase_count - 1].start_ns)) {
+            phases[phase_count - 1].steady_ns = now_ns;
+            phases[phase_count - 1].steady_messages = total;
+            log_message(1, "INFO", "[%.1f s] Group steady with %d members after %.3f s",
+                        (double)(now_ns - start_ns) / 1e9, alive,
+                        (double)(now_ns - phases[phase_count - 1].start_ns) / 1e9);
         }
         
-        if (rkmessage->err) {
-            if (rkmessage->err == RD_KAFKA_RESP_ERR__PARTITION_EOF) {
-                log_message(config->verbose, "DEBUG", "Reached end of partition");
+        /* Membership changes due now start a new phase */
+        if (next_change < change_count &&
+            now_ns - start_ns >= (int64_t)change_sec[next_change] * 1000000000LL) {
+            if (change_delta[next_change] > 0) {
+                for (j = 0; j < change_delta[next_change]; j++) {
+                    if (start_group_member(members, &member_count, &member_config) == 0) {
+                        alive++;
+                    }
+                }
             } else {
-                log_message(1, "ERROR", "Consumer error: %s",
-                            rd_kafka_message_errstr(rkmessage));
+                for (i = member_count - 1, j = 0; i >= 0 && j < -change_delta[next_change] && alive > 1; i--) {
+                    if (!ATOMIC_LOAD(&members[i].stop)) {
+                        ATOMIC_STORE_RELEASE(&members[i].stop, 1);
+                        alive--;
+                        j++;
+                    }
+                }
             }
-        } else {
-            /* Valid message received */
-            msg_count++;
-            log_message(1, "INFO", "Received message %d:", msg_count);
-            log_message(1, "INFO", "  Topic: %s", rd_kafka_topic_name(rkmessage->rkt));
-            log_message(1, "INFO", "  Partition: %d", (int)rkmessage->partition);
-            log_message(1, "INFO", "  Offset: %lld", (long long)rkmessage->offset);
-            log_message(1, "INFO", "  Key: %.*s",
-                        (int)rkmessage->key_len, (char *)rkmessage->key);
-            log_message(1, "INFO", "  Value: %.*s",
-                        (int)rkmessage->len, (char *)rkmessage->payload);
-            
-            /* Store offset */
-            rd_kafka_offset_store(rkmessage->rkt, rkmessage->partition, rkmessage->offset);
+            log_message(1, "INFO", "[%.1f s] Membership change %+d: %d members",
+                        (double)(now_ns - start_ns) / 1e9, change_delta[next_change], alive);
+            phases[phase_count - 1].end_ns = now_ns;
+            phases[phase_count - 1].end_messages = total;
+            phases[phase_count].members = alive;
+            phases[phase_count].start_ns = now_ns;
+            phases[phase_count].steady_ns = 0;
+            phase_count++;
+            next_change++;
         }
         
-        rd_kafka_message_destroy(rkmessage);
+        if (config->report_interval_sec > 0 &&
+            now_ns - last_report_ns >= (int64_t)config->report_interval_sec * 1000000000LL) {
+            min_assigned = partition_count;
+            max_assigned = 0;
+            for (i = 0; i < member_count; i++) {
+                if (ATOMIC_LOAD(&members[i].stop)) {
+                    continue;
+                }
+                assigned = ATOMIC_LOAD(&members[i].assigned);
+                messages = ATOMIC_LOAD(&members[i].messages);
+                if (assigned < min_assigned) min_assigned = assigned;
+                if (assigned > max_assigned) max_assigned = assigned;
+                log_message(1, "INFO", "  member %d: %d partitions, %.1f msg/s", members[i].id, assigned,
+                            (double)(messages - last_messages[i]) * 1e9 / (double)(now_ns - last_report_ns));
+                last_messages[i] = messages;
+            }
+            log_message(1, "INFO", "[%.1f s] %d members: %.1f msg/s total, %d-%d partitions per member",
+                        (double)(now_ns - start_ns) / 1e9, alive,
+                        (double)(total - last_total) * 1e9 / (double)(now_ns - last_report_ns),
+                        min_assigned, max_assigned);
+            last_total = total;
+            last_report_ns = now_ns;
+        }
     }
     
-    log_message(1, "INFO", "Consumed %d messages", msg_count);
-    return 0;
+    /* Members leave on run = 0 or stop */
+    now_ns = get_time_ns();
+    total = 0;
+    bytes = 0;
+    for (i = 0; i < member_count; i++) {
+        total += ATOMIC_LOAD(&members[i].messages);
+        bytes += ATOMIC_LOAD(&members[i].bytes);
+    }
+    phases[phase_count - 1].end_ns = now_ns;
+    phases[phase_count - 1].end_messages = total;
+    log_message(1, "INFO", "Stopping %d group members...", member_count);
+    for (i = 0; i < member_count; i++) {
+        ATOMIC_STORE_RELEASE(&members[i].stop, 1);
+    }
+    for (i = 0; i < member_count; i++) {
+        thread_join(members[i].thread);
+        failed |= members[i].failed;
+    }
+    
+    log_message(1, "INFO", "=== Group Scaling Summary ===");
+    for (i = 0; i < member_count; i++) {
+        log_message(1, "INFO", "  Member %d: %lld messages, %.3f MB, %.1f msg/s over %.1f s in the group",
+                    members[i].id, members[i].messages, (double)members[i].bytes / (1024.0 * 1024.0),
+                    (double)members[i].messages * 1e9 / (double)(members[i].left_ns - members[i].joined_ns),
+                    (double)(members[i].left_ns - members[i].joined_ns) / 1e9);
+    }
+    for (i = 0; i < phase_count; i++) {
+        if (phases[i].steady_ns == 0) {
+            log_message(1, "INFO", "  %d members: not steady within %.1f s", phases[i].members,
+                        (double)(phases[i].end_ns - phases[i].start_ns) / 1e9);
+        } else if (phases[i].end_ns > phases[i].steady_ns) {
+            log_message(1, "INFO", "  %d members: steady after %.3f s, then %.1f msg/s (%.1f per member)",
+                        phases[i].members, (double)(phases[i].steady_ns - phases[i].start_ns) / 1e9,
+                        (double)(phases[i].end_messages - phases[i].steady_messages) * 1e9 /
+                        (double)(phases[i].end_ns - phases[i].steady_ns),
+                        (double)(phases[i].end_messages - phases[i].steady_messages) * 1e9 /
+                        (double)(phases[i].end_ns - phases[i].steady_ns) / phases[i].members);
+        }
+    }
+    log_message(1, "INFO", "Consumed %lld messages in %.3f s (%.1f msg/s) with up to %d members",
+                total, (double)(now_ns - start_ns) / 1e9,
+                (double)total * 1e9 / (double)(now_ns - start_ns), member_count);
+    log_message(1, "INFO", "=============================");
+    
+    if (run_result) {
+        finish_run_result(run_result, now_ns - start_ns, total, bytes, 0, &no_latency);
+        write_result_files(config, "group-scale", run_result, 1);
+        free_run_result(run_result);
+        free(run_result);
+    }
+    free(members);
+    return failed ? 1 : 0;
 }
 
 /*
@@ -1282,9 +8878,21 @@ int main(int argc, char **argv) {
     int i;
     int is_producer = 0;
     int is_consumer = 0;
+    int is_codec_bench = 0;
+    int is_sweep = 0;
+    int is_export = 0;
+    int is_group_scale = 0;
+    int is_mock_bench = 0;
     char tui_ini_file[MAX_FILENAME_LENGTH];
     int tui_mode = 0;
     int use_tui = 0;
+    int cli_message_count = -1;
+    int cli_rate_msgs = -1;
+    int cli_quiet = 0;
+    int cli_dashboard = 0;
+    RunResult run_result;
+    RunResult *result = NULL;
+    int failed;
     
     /* Check if we should use TUI (no arguments provided) */
     if (argc == 1) {
@@ -1321,13 +8929,41 @@ int main(int argc, char **argv) {
             } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
                 config_file = argv[++i];
             } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
-                config.message_count = atoi(argv[++i]);
+                cli_message_count = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+                cli_rate_msgs = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-q") == 0) {
+                cli_quiet = 1;
+            } else if (strcmp(argv[i], "-d") == 0) {
+                cli_dashboard = 1;
             } else if (strcmp(argv[i], "produce") == 0) {
                 is_producer = 1;
                 command = "produce";
             } else if (strcmp(argv[i], "consume") == 0) {
                 is_consumer = 1;
                 command = "consume";
+            } else if (strcmp(argv[i], "codec-bench") == 0) {
+                is_codec_bench = 1;
+                command = "codec-bench";
+            } else if (strcmp(argv[i], "sweep") == 0) {
+                is_sweep = 1;
+                command = "sweep";
+            } else if (strcmp(argv[i], "export") == 0) {
+                is_export = 1;
+                command = "export";
+            } else if (strcmp(argv[i], "group-scale") == 0) {
+                is_group_scale = 1;
+                command = "group-scale";
+            } else if (strcmp(argv[i], "mock-bench") == 0) {
+                is_mock_bench = 1;
+                command = "mock-bench";
+            } else if (strcmp(argv[i], "compare") == 0) {
+                /* Works on result files alone: no configuration, broker or log file */
+                if (i + 2 >= argc) {
+                    print_usage(argv[0]);
+                    return 2;
+                }
+                return run_compare(argv[i + 1], argv[i + 2], i + 3 < argc ? atof(argv[i + 3]) : 5.0);
             }
         }
     }
@@ -1357,13 +8993,27 @@ int main(int argc, char **argv) {
         }
     }
     
+    /* Command line values take precedence over the config file */
+    if (cli_message_count >= 0) {
+        config.message_count = cli_message_count;
+    }
+    if (cli_rate_msgs >= 0) {
+        config.producer_rate_msgs = cli_rate_msgs;
+    }
+    if (cli_quiet) {
+        config.consumer_quiet = 1;
+    }
+    if (cli_dashboard) {
+        config.dashboard = 1;
+    }
+    
     /* Initialize log file */
     init_log_file(config.topic, command);
     
     print_config(&config);
     
-    /* Validate mTLS configuration */
-    if (strcmp(config.security_protocol, "SSL") == 0) {
+    /* Validate mTLS configuration (the mock cluster is plaintext on loopback) */
+    if (strcmp(config.security_protocol, "SSL") == 0 && !is_mock_bench) {
         if (strlen(config.ssl_ca_location) == 0) {
             log_message(1, "ERROR", "mTLS is enabled but ssl_ca_location is not set");
             close_log_file();
@@ -1384,23 +9034,62 @@ int main(int argc, char **argv) {
         }
     }
     
+    start_metrics_exporter(&config);
+    memset(&run_result, 0, sizeof(run_result));
+    strncpy(run_result.name, command, sizeof(run_result.name) - 1);
+    if (config.result_dir[0] != '\0') {
+        result = &run_result;
+    }
+    
     /* Setup signal handler for consumer */
-    if (is_consumer) {
+    if (is_consumer || is_export || is_group_scale) {
         signal(SIGINT, stop_consumer);
         signal(SIGTERM, stop_consumer);
     }
     
     /* Create Kafka client */
     if (is_producer) {
-        rk = create_producer(&config);
-        if (!rk) {
+        /* Produce messages (the engine creates and destroys its own handles) */
+        failed = produce_messages(&config, NULL, result) != 0;
+        if (run_result.finished) {
+            write_result_files(&config, command, &run_result, 1);
+        }
+        free_run_result(&run_result);
+        if (failed) {
+            close_log_file();
+            wait_for_key_press();
+            return 1;
+        }
+    } else if (is_codec_bench) {
+        if (run_codec_benchmark(&config) != 0) {
+            close_log_file();
+            wait_for_key_press();
+            return 1;
+        }
+    } else if (is_sweep) {
+        if (run_parameter_sweep(&config) != 0) {
+            close_log_file();
+            wait_for_key_press();
+            return 1;
+        }
+    } else if (is_export) {
+        if (run_export(&config) != 0) {
+            close_log_file();
+            wait_for_key_press();
+            return 1;
+        }
+    } else if (is_group_scale) {
+        if (run_group_scale(&config) != 0) {
+            close_log_file();
+            wait_for_key_press();
+            return 1;
+        }
+    } else if (is_mock_bench) {
+        if (run_mock_benchmark(&config) != 0) {
             close_log_file();
             wait_for_key_press();
             return 1;
         }
-        
-        /* Produce messages */
-        produce_messages(rk, &config);
     } else if (is_consumer) {
         rk = create_consumer(&config);
         if (!rk) {
@@ -1410,11 +9099,17 @@ int main(int argc, char **argv) {
         }
         
         /* Consume messages */
-        consume_messages(rk, &config);
+        consume_messages(rk, &config, NULL, result);
+        if (run_result.finished) {
+            write_result_files(&config, command, &run_result, 1);
+        }
+        free_run_result(&run_result);
         
         /* Close consumer */
         log_message(1, "INFO", "Closing consumer...");
         rd_kafka_consumer_close(rk);
+        destroy_consumer(rk);
+        rk = NULL;
     }
     
     /* Destroy Kafka handle */